@@ -0,0 +1,25 @@
+#!/bin/bash
+
+## =================================================================
+## BUSTUB PAGE SIZE BENCHMARK
+##
+## Builds page_size_benchmark_test once per supported page size and
+## prints one CSV matrix of insert / scan / point lookup throughput.
+##
+## Usage: build_support/run_page_size_benchmark.sh [build_root]
+## =================================================================
+
+set -o errexit
+
+SOURCE_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+BUILD_ROOT="${1:-${SOURCE_DIR}/build_page_size}"
+
+for page_size in 4096 8192 16384 32768; do
+  build_dir="${BUILD_ROOT}/${page_size}"
+  mkdir -p "${build_dir}"
+  (cd "${build_dir}" && cmake -DCMAKE_BUILD_TYPE=Release -DBUSTUB_PAGE_SIZE="${page_size}" "${SOURCE_DIR}" > /dev/null)
+  make -C "${build_dir}" -j"$(nproc)" page_size_benchmark_test > /dev/null
+  (cd "${build_dir}" && ./test/page_size_benchmark_test --gtest_also_run_disabled_tests \
+      --gtest_filter='PageSizeBenchmark.*' | grep -E '^(page_size|[0-9]+,)') | \
+    if [ "${page_size}" = 4096 ]; then cat; else grep -v '^page_size'; fi
+done
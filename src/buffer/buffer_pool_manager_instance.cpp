@@ -12,6 +12,7 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <iostream>
 #include "common/macros.h"
@@ -69,6 +70,7 @@ bool BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) {
   
   frame_id = it->second;
   pages_[frame_id].is_dirty_ = false;  //ˢ̾Ͳ dirtyˡ 
+  FlushLogForPage(&pages_[frame_id]);
   disk_manager_->WritePage(page_id, pages_[frame_id].data_);    // WritePage ˢ̺ʽĽˢ
 
   latch_.unlock();
@@ -86,6 +88,7 @@ void BufferPoolManagerInstance::FlushAllPgsImp() {
   {
 
     pages_[cur.second].is_dirty_ = false;
+    FlushLogForPage(&pages_[cur.second]);
     disk_manager_->WritePage(cur.first , pages_[cur.second].data_);
   }
   latch_.unlock();
@@ -107,7 +110,7 @@ Page* BufferPoolManagerInstance::NewPgImp(page_id_t *page_id){
   }
   else      //ڿҳ Ҫ㷨̭һҳ
   {
-    bool res = replacer_->Victim(&new_frame_id);
+    bool res = PickVictim(&new_frame_id);
     if(res == false)
     {
       latch_.unlock();
@@ -121,6 +124,9 @@ Page* BufferPoolManagerInstance::NewPgImp(page_id_t *page_id){
   {
     page_id_t flush_page_id = pages_[new_frame_id].page_id_;
     pages_[new_frame_id].is_dirty_ = false;
+    if (FlushLogForPage(&pages_[new_frame_id])) {
+      num_forced_log_flushes_++;
+    }
     disk_manager_->WritePage(flush_page_id,  pages_[new_frame_id].data_);
   }
   
@@ -129,6 +135,7 @@ Page* BufferPoolManagerInstance::NewPgImp(page_id_t *page_id){
   pages_[new_frame_id].page_id_ = *page_id;
   pages_[new_frame_id].ResetMemory();
   pages_[new_frame_id].pin_count_ = 1;
+  ResetRecLSN(&pages_[new_frame_id]);
   replacer_->Pin(new_frame_id);
   latch_.unlock();
   return &pages_[new_frame_id];
@@ -151,6 +158,9 @@ Page* BufferPoolManagerInstance::FetchPgImp(page_id_t page_id){
   {
     frame_id = it->second;      
     Page *res = &pages_[frame_id];    //  pages_ ǻеʵҳλ飬ڴŴӴжҳ棬ŵľһһpages
+    if (res->pin_count_ == 0 && !res->is_dirty_) {
+      ResetRecLSN(res);
+    }
     res->pin_count_++;
     replacer_->Pin(frame_id);     
 
@@ -169,14 +179,15 @@ Page* BufferPoolManagerInstance::FetchPgImp(page_id_t page_id){
     disk_manager_->ReadPage(page_id , res->data_);    // ReadPage() - ָҳݶڴ 
     res->pin_count_ = 1;
     res->page_id_ = page_id;
-    replacer_->Pin(page_id);    
+    ResetRecLSN(res);
+    replacer_->Pin(frame_id);    
 
     latch_.unlock();
     return res;
   }
   else      //ڿҳ,replaceеLUR ȥһҳ
   {
-    bool ret = replacer_->Victim(&frame_id);
+    bool ret = PickVictim(&frame_id);
     if(ret == false)
     {
       latch_.unlock();
@@ -186,6 +197,9 @@ Page* BufferPoolManagerInstance::FetchPgImp(page_id_t page_id){
     if(pages_[frame_id].IsDirty())    //4 ҳģдش̡  (ҳݸˣûд档ڴӺʹǲһġ) 
     {
       page_id_t flush_page_id = pages_[frame_id].page_id_;    // õҳ page_id,ΪбֻÿpageӦframe_id,
+      if (FlushLogForPage(&pages_[frame_id])) {
+        num_forced_log_flushes_++;
+      }
       disk_manager_->WritePage(flush_page_id , pages_[frame_id].data_);  //  ָҳдļɻҳͬ
     }
     page_table_.erase(pages_[frame_id].page_id_);   // page_tableɾframeӦҳ
@@ -196,6 +210,7 @@ Page* BufferPoolManagerInstance::FetchPgImp(page_id_t page_id){
   pages_[frame_id].is_dirty_ = false; 
   pages_[frame_id].page_id_ = page_id;
   pages_[frame_id].pin_count_ = 1;
+  ResetRecLSN(&pages_[frame_id]);
   disk_manager_->ReadPage(page_id, pages_[frame_id].data_);
   latch_.unlock();
   return &pages_[frame_id];
@@ -235,6 +250,7 @@ bool BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) {
   {
     page_id_t flush_page_id = pages_[frame_id].page_id_;
     pages_[frame_id].is_dirty_ = false;
+    FlushLogForPage(&pages_[frame_id]);
     disk_manager_->WritePage(flush_page_id, pages_[frame_id].data_);
   }
   //û,page_table_ɾҳӳ䣬òλҳpage_id ΪINVALID_PAGE_ID󣬽λID
@@ -266,6 +282,7 @@ bool BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty){
   frame_id = page_table_[page_id];        //õӦƿframe_id
   if(pages_[frame_id].pin_count_ <=0)
   {
+    latch_.unlock();
     return false;
   }      
 
@@ -279,6 +296,7 @@ bool BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty){
   {
     replacer_->Unpin(frame_id);   // ҳLRUȴ̭
   }
+  latch_.unlock();
   return true;
   
 }
@@ -290,6 +308,51 @@ page_id_t BufferPoolManagerInstance::AllocatePage() {
   return next_page_id;
 }
 
+bool BufferPoolManagerInstance::FlushLogForPage(Page *page) {
+  if (enable_logging && log_manager_ != nullptr && page->GetLSN() > log_manager_->GetPersistentLSN()) {
+    log_manager_->FlushUntil(page->GetLSN());
+    return true;
+  }
+  return false;
+}
+
+bool BufferPoolManagerInstance::PickVictim(frame_id_t *frame_id) {
+  if (!enable_logging || log_manager_ == nullptr) {
+    return replacer_->Victim(frame_id);
+  }
+  const lsn_t persistent_lsn = log_manager_->GetPersistentLSN();
+  lsn_t skipped_lsn = INVALID_LSN;
+  bool found = replacer_->PreferredVictim(frame_id, [&](frame_id_t candidate) {
+    Page *page = &pages_[candidate];
+    if (!page->is_dirty_ || page->GetLSN() <= persistent_lsn) {
+      return true;
+    }
+    skipped_lsn = std::max(skipped_lsn, page->GetLSN());
+    return false;
+  });
+  // by the time the frames that were passed over are evicted, their log records are hopefully on disk
+  if (skipped_lsn != INVALID_LSN) {
+    log_manager_->RequestFlush(skipped_lsn);
+  }
+  return found;
+}
+
+void BufferPoolManagerInstance::ResetRecLSN(Page *page) {
+  page->rec_lsn_ = log_manager_ == nullptr ? INVALID_LSN : log_manager_->GetNextLSN();
+}
+
+std::vector<std::pair<page_id_t, lsn_t>> BufferPoolManagerInstance::GetDirtyPageTable() {
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_page_table;
+  std::scoped_lock lock(latch_);
+  for (const auto &[page_id, frame_id] : page_table_) {
+    const Page &page = pages_[frame_id];
+    if (page.is_dirty_ || page.pin_count_ > 0) {
+      dirty_page_table.emplace_back(page_id, page.rec_lsn_);
+    }
+  }
+  return dirty_page_table;
+}
+
 void BufferPoolManagerInstance::ValidatePageId(const page_id_t page_id) const {
   assert(page_id % num_instances_ == instance_index_);  // allocated pages mod back to this BPI
 }
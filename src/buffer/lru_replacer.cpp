@@ -52,6 +52,36 @@ bool LRUReplacer::Victim(frame_id_t *frame_id){
 
 
 
+bool LRUReplacer::PreferredVictim(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &prefer) {
+    m_mutex.lock();
+
+    if(m_hash.empty() == true)
+    {
+        m_mutex.unlock();
+        return false;
+    }
+
+    // walk from the least recently used frame on, fall back to it if no frame is preferred
+    ListNode *cur = head;
+    while(cur != nullptr && !prefer(cur->val))
+    {
+        cur = cur->next;
+    }
+    if(cur == nullptr)
+    {
+        cur = head;
+    }
+
+    *frame_id = cur->val;
+    m_hash.erase(cur->val);
+    DelelteNode(cur);
+
+    m_mutex.unlock();
+    return true;
+}
+
+
+
 //ĳڴ֡(frame)̶ڴ, LRṶ(ҲֱӴLRUɾframe_id ,ڴеframe_id ӦpageܰȫĴڻУ)
 void LRUReplacer::Pin(frame_id_t frame_id) {
     m_mutex.lock();
@@ -47,6 +47,23 @@ size_t ParallelBufferPoolManager::GetPoolSize() {
   
 }
 
+std::vector<std::pair<page_id_t, lsn_t>> ParallelBufferPoolManager::GetDirtyPageTable() {
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_page_table;
+  for (auto *instance : instances_) {
+    auto instance_table = instance->GetDirtyPageTable();
+    dirty_page_table.insert(dirty_page_table.end(), instance_table.begin(), instance_table.end());
+  }
+  return dirty_page_table;
+}
+
+uint64_t ParallelBufferPoolManager::GetNumForcedLogFlushes() {
+  uint64_t num_forced_log_flushes = 0;
+  for (auto *instance : instances_) {
+    num_forced_log_flushes += instance->GetNumForcedLogFlushes();
+  }
+  return num_forced_log_flushes;
+}
+
 
 
 //BufferPoolManagerҳidʹô˷
@@ -1,11 +1,78 @@
 #include "catalog/table_generator.h"
 
 #include <algorithm>
+#include <cmath>
 #include <random>
 #include <vector>
 
 namespace bustub {
 
+namespace {
+
+/**
+ * Draws from 0 to n - 1, i with probability proportional to 1 / (i + 1)^theta for 0 < theta < 1. This is the generator
+ * of Gray et al., "Quickly Generating Billion-Record Synthetic Databases", which YCSB uses as well.
+ */
+class ZipfGenerator {
+ public:
+  ZipfGenerator(uint64_t n, double theta)
+      : n_(n), theta_(theta), alpha_(1.0 / (1.0 - theta)), zetan_(Zeta(n, theta)) {
+    eta_ = (1.0 - std::pow(2.0 / static_cast<double>(n), 1.0 - theta)) / (1.0 - Zeta(2, theta) / zetan_);
+  }
+
+  template <typename Engine>
+  uint64_t operator()(Engine *engine) {
+    double u = std::uniform_real_distribution<double>(0.0, 1.0)(*engine);
+    double uz = u * zetan_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + std::pow(0.5, theta_)) {
+      return 1;
+    }
+    auto key = static_cast<uint64_t>(static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+    return std::min(key, n_ - 1);
+  }
+
+  /** @return the theta of a Zipf distribution */
+  static double Theta(TableGenerator::Dist dist) {
+    switch (dist) {
+      case TableGenerator::Dist::Zipf_50:
+        return 0.50;
+      case TableGenerator::Dist::Zipf_75:
+        return 0.75;
+      case TableGenerator::Dist::Zipf_95:
+        return 0.95;
+      case TableGenerator::Dist::Zipf_99:
+        return 0.99;
+      default:
+        UNREACHABLE("Not a Zipf distribution");
+    }
+  }
+
+  static bool IsZipf(TableGenerator::Dist dist) {
+    return dist == TableGenerator::Dist::Zipf_50 || dist == TableGenerator::Dist::Zipf_75 ||
+           dist == TableGenerator::Dist::Zipf_95 || dist == TableGenerator::Dist::Zipf_99;
+  }
+
+ private:
+  static double Zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; i++) {
+      sum += 1.0 / std::pow(static_cast<double>(i), theta);
+    }
+    return sum;
+  }
+
+  uint64_t n_;
+  double theta_;
+  double alpha_;
+  double zetan_;
+  double eta_;
+};
+
+}  // namespace
+
 template <typename CppType>
 std::vector<Value> TableGenerator::GenNumericValues(ColumnInsertMeta *col_meta, uint32_t count) {
   std::vector<Value> values{};
@@ -33,6 +100,14 @@ std::vector<Value> TableGenerator::GenNumericValues(ColumnInsertMeta *col_meta,
   }
 
   std::default_random_engine generator;
+  if (ZipfGenerator::IsZipf(col_meta->dist_)) {
+    // the hot values are the ones close to min
+    ZipfGenerator zipf(col_meta->max_ - col_meta->min_ + 1, ZipfGenerator::Theta(col_meta->dist_));
+    for (uint32_t i = 0; i < count; i++) {
+      values.emplace_back(Value(col_meta->type_, static_cast<CppType>(col_meta->min_ + zipf(&generator))));
+    }
+    return values;
+  }
   // TODO(Amadou): Break up in two branches if this is too weird.
   std::conditional_t<std::is_integral_v<CppType>, std::uniform_int_distribution<CppType>,
                      std::uniform_real_distribution<CppType>>
@@ -43,6 +118,28 @@ std::vector<Value> TableGenerator::GenNumericValues(ColumnInsertMeta *col_meta,
   return values;
 }
 
+std::vector<uint64_t> TableGenerator::GenerateKeys(Dist dist, uint64_t num_keys, uint32_t count, uint32_t seed) {
+  std::vector<uint64_t> keys;
+  keys.reserve(count);
+  std::default_random_engine generator(seed);
+  if (ZipfGenerator::IsZipf(dist)) {
+    ZipfGenerator zipf(num_keys, ZipfGenerator::Theta(dist));
+    for (uint32_t i = 0; i < count; i++) {
+      keys.push_back(zipf(&generator));
+    }
+  } else if (dist == Dist::Uniform) {
+    std::uniform_int_distribution<uint64_t> distribution(0, num_keys - 1);
+    for (uint32_t i = 0; i < count; i++) {
+      keys.push_back(distribution(generator));
+    }
+  } else {
+    for (uint32_t i = 0; i < count; i++) {
+      keys.push_back(i % num_keys);
+    }
+  }
+  return keys;
+}
+
 std::vector<Value> TableGenerator::MakeValues(ColumnInsertMeta *col_meta, uint32_t count) {
   std::vector<Value> values;
   switch (col_meta->type_) {
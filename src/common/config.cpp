@@ -18,6 +18,12 @@ std::atomic<bool> enable_logging(false);
 
 std::chrono::duration<int64_t> log_timeout = std::chrono::seconds(1);
 
+std::chrono::milliseconds async_commit_delay = std::chrono::milliseconds(10);
+
+int64_t log_segment_size = 16 * 1024 * 1024;
+
 std::chrono::milliseconds cycle_detection_interval = std::chrono::milliseconds(50);
 
+size_t lock_escalation_threshold = 5000;
+
 }  // namespace bustub
@@ -0,0 +1,82 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lock_contention.cpp
+//
+// Identification: src/concurrency/lock_contention.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "concurrency/lock_contention.h"
+
+#include <sstream>
+
+namespace bustub {
+
+namespace {
+
+const char *AbortReasonName(AbortReason reason) {
+  switch (reason) {
+    case AbortReason::LOCK_ON_SHRINKING:
+      return "LOCK_ON_SHRINKING";
+    case AbortReason::UNLOCK_ON_SHRINKING:
+      return "UNLOCK_ON_SHRINKING";
+    case AbortReason::UPGRADE_CONFLICT:
+      return "UPGRADE_CONFLICT";
+    case AbortReason::DEADLOCK:
+      return "DEADLOCK";
+    case AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED:
+      return "LOCKSHARED_ON_READ_UNCOMMITTED";
+    case AbortReason::WRITE_CONFLICT:
+      return "WRITE_CONFLICT";
+  }
+  return "UNKNOWN";
+}
+
+/** Print the non-empty buckets of a Log2Histogram, e.g. "[4, 8): 12". */
+void PrintHistogram(std::ostringstream *os, const char *name, const std::vector<uint64_t> &buckets) {
+  *os << name << ":\n";
+  for (size_t i = 0; i < buckets.size(); i++) {
+    if (buckets[i] == 0) {
+      continue;
+    }
+    uint64_t low = i == 0 ? 0 : uint64_t{1} << (i - 1);
+    if (i == 0) {
+      *os << "  0: ";
+    } else if (i + 1 == buckets.size()) {
+      *os << "  >= " << low << ": ";
+    } else {
+      *os << "  [" << low << ", " << (uint64_t{1} << i) << "): ";
+    }
+    *os << buckets[i] << "\n";
+  }
+}
+
+}  // namespace
+
+std::string LockContentionSnapshot::ToString() const {
+  std::ostringstream os;
+  os << "requests: " << num_requests_ << "\n";
+  os << "waits: " << num_waits_ << "\n";
+  os << "total_wait_us: " << total_wait_us_ << "\n";
+  PrintHistogram(&os, "wait_us", wait_us_histogram_);
+  PrintHistogram(&os, "queue_length", queue_length_histogram_);
+  os << "hot_rows:\n";
+  for (const auto &row : hot_rows_) {
+    os << "  " << row.first.ToString() << ": " << row.second << "\n";
+  }
+  os << "hot_tables:\n";
+  for (const auto &table : hot_tables_) {
+    os << "  " << table.first << ": " << table.second << "\n";
+  }
+  os << "aborts:\n";
+  for (const auto &abort : aborts_) {
+    os << "  " << AbortReasonName(abort.first) << ": " << abort.second << "\n";
+  }
+  return os.str();
+}
+
+}  // namespace bustub
@@ -12,327 +12,733 @@
 
 #include "concurrency/lock_manager.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "concurrency/key_range_lock.h"
+
 namespace bustub {
 
-//IDԽ ֤Խ£  /ֱָIDϴһͽСһ
+namespace {
 
+uint64_t MicrosSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
 
+/**
+ * Depth-first search for a cycle through txn_id, the edges of every transaction are sorted.
+ * @param[out] youngest the youngest transaction on the cycle
+ */
+bool FindCycle(const std::unordered_map<txn_id_t, std::vector<txn_id_t>> &graph, txn_id_t txn_id,
+               std::unordered_set<txn_id_t> *visited, std::vector<txn_id_t> *path, txn_id_t *youngest) {
+  visited->insert(txn_id);
+  path->push_back(txn_id);
+  auto edges = graph.find(txn_id);
+  if (edges != graph.end()) {
+    for (txn_id_t next : edges->second) {
+      auto on_path = std::find(path->begin(), path->end(), next);
+      if (on_path != path->end()) {
+        *youngest = *std::max_element(on_path, path->end());
+        return true;
+      }
+      if (visited->count(next) == 0 && FindCycle(graph, next, visited, path, youngest)) {
+        return true;
+      }
+    }
+  }
+  path->pop_back();
+  return false;
+}
 
-//txnԪIDΪridĶ
-bool LockManager::LockShared(Transaction *txn, const RID &rid) {
+/** Compatibility matrix, indexed by two LockModes. */
+constexpr bool COMPATIBLE[5][5] = {
+    // IS     IX     S      SIX    X
+    {true, true, true, true, false},      // IS
+    {true, true, false, false, false},    // IX
+    {true, false, true, false, false},    // S
+    {true, false, false, false, false},   // SIX
+    {false, false, false, false, false},  // X
+};
+
+}  // namespace
+
+LockManager::LockManager(size_t num_shards, DeadlockPolicy policy) : policy_(policy) {
+  shards_.reserve(num_shards);
+  for (size_t i = 0; i < num_shards; i++) {
+    shards_.emplace_back(std::make_unique<LockTableShard>());
+  }
+  if (policy_ == DeadlockPolicy::DETECTION) {
+    enable_cycle_detection_ = true;
+    cycle_detection_thread_ = new std::thread([this] {
+      while (enable_cycle_detection_) {
+        std::this_thread::sleep_for(cycle_detection_interval);
+        RunCycleDetection();
+      }
+    });
+  }
+}
 
-  //ǰжϣ״̬ΪABORTʱֱӷؼ
-  if (txn->GetState() == TransactionState::ABORTED) 
-  {
+LockManager::~LockManager() {
+  if (cycle_detection_thread_ != nullptr) {
+    enable_cycle_detection_ = false;
+    cycle_detection_thread_->join();
+    delete cycle_detection_thread_;
+  }
+}
+
+bool LockManager::LockShared(Transaction *txn, const RID &rid, table_oid_t oid, bool escalate) {
+  if (!CheckCanLock(txn, LockMode::SHARED)) {
     return false;
   }
-  //ǰ״̬ΪʱûȡABORT׳쳣
-  if (txn->GetState() == TransactionState::SHRINKING) 
+  if (oid != INVALID_TABLE_OID && IsTableLocked(txn, oid, LockMode::SHARED)) {
+    return true;
+  }
   {
-    txn->SetState(TransactionState::ABORTED);
-    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
+    LockTableShard *shard = GetShard(rid);
+    std::unique_lock<std::mutex> lock(shard->latch_);
+    LockRequestQueue *queue = &shard->lock_table_[rid];
+    LockRequest *request = Enqueue(shard, queue, txn, LockMode::SHARED);
+    txn->GetSharedLockSet()->emplace(rid);
+    WaitForGrant(shard, queue, request, &rid, oid, &lock);
+  }
+  CountRowLock(txn, rid, oid, LockMode::SHARED, escalate);
+  return true;
+}
+
+bool LockManager::LockExclusive(Transaction *txn, const RID &rid, table_oid_t oid, bool escalate) {
+  if (!CheckCanLock(txn, LockMode::EXCLUSIVE)) {
+    return false;
+  }
+  if (oid != INVALID_TABLE_OID && IsTableLocked(txn, oid, LockMode::EXCLUSIVE)) {
+    return true;
   }
-  //ĸ뼶READ_UNCOMMITTEDδύʱ䲻ӦȡRUҪݣԻȡABORT׳쳣
-  if (txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED) 
   {
-    txn->SetState(TransactionState::ABORTED);
-    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED);
+    LockTableShard *shard = GetShard(rid);
+    std::unique_lock<std::mutex> lock(shard->latch_);
+    LockRequestQueue *queue = &shard->lock_table_[rid];
+    LockRequest *request = Enqueue(shard, queue, txn, LockMode::EXCLUSIVE);
+    txn->GetExclusiveLockSet()->emplace(rid);
+    WaitForGrant(shard, queue, request, &rid, oid, &lock);
+  }
+  CountRowLock(txn, rid, oid, LockMode::EXCLUSIVE, escalate);
+  return true;
+}
+
+bool LockManager::LockUpgrade(Transaction *txn, const RID &rid, table_oid_t oid, bool escalate) {
+  if (!CheckCanLock(txn, LockMode::EXCLUSIVE)) {
+    return false;
+  }
+  if (oid != INVALID_TABLE_OID && IsTableLocked(txn, oid, LockMode::EXCLUSIVE)) {
+    return true;
   }
-  
-
-  txn->SetState(TransactionState::GROWING);   //ǰжͨ򽫵ǰ״̬ΪGROWING(һ׶)ûݽṹ
-  std::unique_lock<std::mutex> lk(latch_);
-
-  auto &lock_request_queue = lock_table_[rid];    // õRIDӦ lock_tableԪIDΪΪֵĹϣ
-  auto &request_queue = lock_request_queue.request_queue_;  //õкپõгԱ
-  
-  auto &cv = lock_request_queue.cv_;      //
-  auto txn_id = txn->GetTransactionId();
-  
-  
-  request_queue.emplace_back(txn_id, LockMode::SHARED);    //ȡӦԪIDмسԱ󣬽ǰСŵһһ࣬
-  txn->GetSharedLockSet()->emplace(rid);      //ڸ󱻼ʱӦGetSharedLockSet()ԪIDĳϣʹøɱʱܽӶɾ
-  txn_table_[txn_id] = txn;
-  
-
-  //Wound Wait : Kill all low priority transaction ߵȵͣ  ͵ȸߣ
-  //УѭжǷӶǰûдִУ
-  //Ϊ˱Ҫ鵱ǰǷʹ󣬶X˵, ǰײʱźϷ
-  //ڹ(S)ҪӶôҪѶдabortڶ󣬿Թ档
-  //ɱκͨеcvȴʹñɱ˳С
-  bool can_grant = true;
-  bool is_kill = false;
-
-  for (auto &request : request_queue)     //ÿһ
   {
-    if (request.lock_mode_ == LockMode::EXCLUSIVE)    //ǰͷд
-    {
-      if (request.txn_id_ > txn_id)      //ǰͷдҵǰͷҪᣬɱǰ
-      {
-        txn_table_[request.txn_id_]->SetState(TransactionState::ABORTED);   //ֱֹͷ
-        is_kill = true;
-      } 
-      else      //can_grantΪfalseʾ񽫱
-      {
-        can_grant = false;
-      }
+    LockTableShard *shard = GetShard(rid);
+    std::unique_lock<std::mutex> lock(shard->latch_);
+    auto queue = shard->lock_table_.find(rid);
+    if (queue == shard->lock_table_.end()) {
+      return false;
     }
-
-    if (request.txn_id_ == txn_id) 
-    {
-      request.granted_ = can_grant;
-      break;
+    LockRequest *request = queue->second.request_queue_.Find(txn);
+    if (request == nullptr) {
+      return false;
     }
+    UpgradeRequest(shard, &queue->second, request, LockMode::EXCLUSIVE, &rid, oid, &lock);
+    txn->GetSharedLockSet()->erase(rid);
+    txn->GetExclusiveLockSet()->emplace(rid);
+  }
+  // under REPEATABLE_READ and SERIALIZABLE the shared lock was counted already
+  if (!txn->HoldsSharedLocks()) {
+    CountRowLock(txn, rid, oid, LockMode::EXCLUSIVE, escalate);
   }
+  return true;
+}
 
-  if (is_kill)    // ȷʵɱ, Ҫnotify_all() ,ɱһʱѸȴе
-  {
-    cv.notify_all();
+bool LockManager::Unlock(Transaction *txn, const RID &rid) {
+  if (txn->GetState() == TransactionState::GROWING && txn->HoldsSharedLocks()) {
+    txn->SetState(TransactionState::SHRINKING);
   }
+  txn->GetSharedLockSet()->erase(rid);
+  txn->GetExclusiveLockSet()->erase(rid);
 
-  //Wait the lock
-  //ҸܽɱѭȴѭУcvwaitԭӵͷ
-  //ÿε䱻ʱ飺
-  //1. Ƿɱ׳쳣
-  //2. ڸ֮ǰǷڻд״̬ΪABORT򽫸granted_Ϊ棬ء
-  while (!can_grant)  
-  {
-    for (auto &request : request_queue) 
-    {
-      if (request.lock_mode_ == LockMode::EXCLUSIVE && txn_table_[request.txn_id_]->GetState() != TransactionState::ABORTED) 
-      {
-        break;
-      }
-      if (request.txn_id_ == txn_id) 
-      {
-        can_grant = true;
-        request.granted_ = true;
-      }
-    }
+  LockTableShard *shard = GetShard(rid);
+  std::scoped_lock lock(shard->latch_);
+  return EraseRequest(shard, &shard->lock_table_, rid, txn);
+}
 
-    if (!can_grant) 
-    {
-      cv.wait(lk);
-    }
+bool LockManager::LockTable(Transaction *txn, table_oid_t oid, LockMode lock_mode) {
+  if (!CheckCanLock(txn, lock_mode)) {
+    return false;
+  }
+  auto table_locks = txn->GetTableLockSet();
+  auto held = table_locks->find(oid);
+  if (held != table_locks->end() && Covers(held->second, lock_mode)) {
+    return true;
+  }
 
-    if (txn->GetState() == TransactionState::ABORTED) 
-    {
-      throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
-    }
+  LockTableShard *shard = GetTableShard(oid);
+  std::unique_lock<std::mutex> lock(shard->latch_);
+  LockRequestQueue *queue = &shard->table_lock_table_[oid];
+  if (held == table_locks->end()) {
+    LockRequest *request = Enqueue(shard, queue, txn, lock_mode);
+    table_locks->emplace(oid, lock_mode);
+    WaitForGrant(shard, queue, request, nullptr, oid, &lock);
+    return true;
   }
+
+  // SHARED and INTENTION_EXCLUSIVE are the only modes where neither covers the other
+  LockMode upgraded = Covers(lock_mode, held->second) ? lock_mode : LockMode::SHARED_INTENTION_EXCLUSIVE;
+  UpgradeRequest(shard, queue, queue->request_queue_.Find(txn), upgraded, nullptr, oid, &lock);
+  held->second = upgraded;
   return true;
 }
 
+bool LockManager::UnlockTable(Transaction *txn, table_oid_t oid) {
+  if (txn->GetState() == TransactionState::GROWING && txn->HoldsSharedLocks()) {
+    txn->SetState(TransactionState::SHRINKING);
+  }
+  txn->GetTableLockSet()->erase(oid);
 
+  LockTableShard *shard = GetTableShard(oid);
+  std::scoped_lock lock(shard->latch_);
+  return EraseRequest(shard, &shard->table_lock_table_, oid, txn);
+}
 
+bool LockManager::IsWriteLocked(Transaction *txn, const RID &rid, table_oid_t oid) {
+  auto held_by_other = [txn](const LockRequestQueue &queue) {
+    return std::any_of(queue.request_queue_.begin(), queue.request_queue_.end(), [txn](const LockRequest &request) {
+      return request.granted_ && request.lock_mode_ == LockMode::EXCLUSIVE && request.txn_ != txn;
+    });
+  };
+  {
+    LockTableShard *shard = GetShard(rid);
+    std::scoped_lock lock(shard->latch_);
+    auto queue = shard->lock_table_.find(rid);
+    if (queue != shard->lock_table_.end() && held_by_other(queue->second)) {
+      return true;
+    }
+  }
+  if (oid == INVALID_TABLE_OID) {
+    return false;
+  }
+  LockTableShard *shard = GetTableShard(oid);
+  std::scoped_lock lock(shard->latch_);
+  auto queue = shard->table_lock_table_.find(oid);
+  return queue != shard->table_lock_table_.end() && held_by_other(queue->second);
+}
 
+LockContentionSnapshot LockManager::GetContentionSnapshot(size_t top_k) {
+  LockContentionSnapshot snapshot;
+  // a row hashes to one shard, but a table gets waits in the shards of all its rows
+  std::unordered_map<RID, uint64_t> hot_rows;
+  std::unordered_map<table_oid_t, uint64_t> hot_tables;
+  for (auto &shard : shards_) {
+    std::scoped_lock lock(shard->latch_);
+    const LockContention &contention = shard->contention_;
+    snapshot.num_requests_ += contention.num_requests_;
+    snapshot.num_waits_ += contention.num_waits_;
+    snapshot.total_wait_us_ += contention.total_wait_us_;
+    contention.wait_times_.AddTo(&snapshot.wait_us_histogram_);
+    contention.queue_lengths_.AddTo(&snapshot.queue_length_histogram_);
+    for (const auto &counter : contention.hot_rows_.GetCounters()) {
+      hot_rows[counter.first] += counter.second;
+    }
+    for (const auto &counter : contention.hot_tables_.GetCounters()) {
+      hot_tables[counter.first] += counter.second;
+    }
+  }
+  {
+    std::scoped_lock lock(waiting_latch_);
+    snapshot.num_waits_ += external_contention_.num_waits_;
+    snapshot.total_wait_us_ += external_contention_.total_wait_us_;
+    external_contention_.wait_times_.AddTo(&snapshot.wait_us_histogram_);
+  }
+  {
+    std::scoped_lock lock(aborts_latch_);
+    snapshot.aborts_ = aborts_;
+  }
 
+  auto most_first = [](const auto &a, const auto &b) { return a.second > b.second; };
+  snapshot.hot_rows_.assign(hot_rows.begin(), hot_rows.end());
+  std::sort(snapshot.hot_rows_.begin(), snapshot.hot_rows_.end(), most_first);
+  snapshot.hot_rows_.resize(std::min(top_k, snapshot.hot_rows_.size()));
+  snapshot.hot_tables_.assign(hot_tables.begin(), hot_tables.end());
+  std::sort(snapshot.hot_tables_.begin(), snapshot.hot_tables_.end(), most_first);
+  snapshot.hot_tables_.resize(std::min(top_k, snapshot.hot_tables_.size()));
+  return snapshot;
+}
 
+void LockManager::ResetContention() {
+  for (auto &shard : shards_) {
+    std::scoped_lock lock(shard->latch_);
+    shard->contention_.Clear();
+  }
+  {
+    std::scoped_lock lock(waiting_latch_);
+    external_contention_.Clear();
+  }
+  std::scoped_lock lock(aborts_latch_);
+  aborts_.clear();
+}
 
+bool LockManager::IsTableLocked(Transaction *txn, table_oid_t oid, LockMode lock_mode) {
+  auto table_locks = txn->GetTableLockSet();
+  auto held = table_locks->find(oid);
+  return held != table_locks->end() && Covers(held->second, lock_mode);
+}
 
-//txnԻԪIDΪridԪд
-bool LockManager::LockExclusive(Transaction *txn, const RID &rid) {
+bool LockManager::Covers(LockMode held, LockMode wanted) {
+  if (held == wanted || held == LockMode::EXCLUSIVE) {
+    return true;
+  }
+  switch (held) {
+    case LockMode::SHARED_INTENTION_EXCLUSIVE:
+      return wanted != LockMode::EXCLUSIVE;
+    case LockMode::SHARED:
+    case LockMode::INTENTION_EXCLUSIVE:
+      return wanted == LockMode::INTENTION_SHARED;
+    default:
+      return false;
+  }
+}
 
-  //ǰü飬統ǰ״̬ΪABORTؼ٣統ǰ׶Σ״̬ΪABORT׳쳣
-  if (txn->GetState() == TransactionState::ABORTED) 
-  {
+bool LockManager::Compatible(LockMode a, LockMode b) { return COMPATIBLE[static_cast<int>(a)][static_cast<int>(b)]; }
+
+bool LockManager::CheckCanLock(Transaction *txn, LockMode lock_mode) {
+  if (txn->GetState() == TransactionState::ABORTED) {
     return false;
   }
-  if (txn->GetState() == TransactionState::SHRINKING) 
-  {
+  if (txn->GetState() == TransactionState::SHRINKING) {
     txn->SetState(TransactionState::ABORTED);
+    CountAbort(AbortReason::LOCK_ON_SHRINKING);
     throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
   }
+  if (txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED && lock_mode != LockMode::INTENTION_EXCLUSIVE &&
+      lock_mode != LockMode::EXCLUSIVE) {
+    txn->SetState(TransactionState::ABORTED);
+    CountAbort(AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED);
+  }
+  return true;
+}
 
-  ///״̬ȡУУԼӵϡ
-  //ѯǷн󣬵ȡдʱеκһ󶼽ȼʱɱ
-  //ڲɱ񽫱ɱһʱѸȴе
+void LockManager::CountAbort(AbortReason reason, uint64_t count) {
+  std::scoped_lock lock(aborts_latch_);
+  aborts_[reason] += count;
+}
 
-  txn->SetState(TransactionState::GROWING);   
-  std::unique_lock<std::mutex> lk(latch_);
+LockManager::LockRequest *LockManager::Enqueue(LockTableShard *shard, LockRequestQueue *queue, Transaction *txn,
+                                               LockMode lock_mode) {
+  LockRequest *request = shard->NewRequest(txn, lock_mode);
+  shard->contention_.RecordRequest(queue->request_queue_.Size());
+  queue->request_queue_.PushBack(request);
+  return request;
+}
 
-  auto &lock_request_queue = lock_table_[rid];
-  auto &request_queue = lock_request_queue.request_queue_;
-  auto &cv = lock_request_queue.cv_;
-  auto txn_id = txn->GetTransactionId();
+void LockManager::CountRowLock(Transaction *txn, const RID &rid, table_oid_t oid, LockMode lock_mode,
+                               bool escalate) {
+  // the other isolation levels give shared locks up right away
+  if (oid == INVALID_TABLE_OID ||
+      (lock_mode == LockMode::SHARED && !txn->HoldsSharedLocks())) {
+    return;
+  }
+  (*txn->GetTableRowLocks())[oid].push_back(rid);
+  if (escalate) {
+    EscalateIfDue(txn, oid);
+  }
+}
 
-  request_queue.emplace_back(txn_id, LockMode::EXCLUSIVE);
-  txn->GetExclusiveLockSet()->emplace(rid);
-  txn_table_[txn_id] = txn;
+void LockManager::EscalateIfDue(Transaction *txn, table_oid_t oid) {
+  auto row_locks = txn->GetTableRowLocks();
+  auto rows = row_locks->find(oid);
+  if (lock_escalation_threshold != 0 && rows != row_locks->end() && rows->second.size() > lock_escalation_threshold) {
+    Escalate(txn, oid);
+  }
+}
 
-  //Wound Wait
-  //УѭжǷдǰûждִУ
-  bool can_grant = true;
-  bool is_kill = false;
-  for (auto &request : request_queue)     //
-  {
-    if (request.txn_id_ == txn_id)    //ͷľǵǰID
-    {
-      request.granted_ = can_grant;       //ͬ⵱ǰid
-      break;
+void LockManager::Escalate(Transaction *txn, table_oid_t oid) {
+  auto row_locks = txn->GetTableRowLocks();
+  const std::vector<RID> &rows = row_locks->at(oid);
+  bool exclusive =
+      std::any_of(rows.begin(), rows.end(), [txn](const RID &rid) { return txn->IsExclusiveLocked(rid); });
+  // the row locks stay until the table lock is granted, it may have to wait or get wounded meanwhile
+  if (!LockTable(txn, oid, exclusive ? LockMode::EXCLUSIVE : LockMode::SHARED)) {
+    return;
+  }
+  for (const RID &rid : rows) {
+    if (!txn->IsSharedLocked(rid) && !txn->IsExclusiveLocked(rid)) {
+      continue;
     }
-    if (request.txn_id_ > txn_id)    //ڵҪᣬɱ
-    {    
-      txn_table_[request.txn_id_]->SetState(TransactionState::ABORTED);
-      is_kill = true;
-    } 
-    else    //
-    {
-      can_grant = false;
+    txn->GetSharedLockSet()->erase(rid);
+    txn->GetExclusiveLockSet()->erase(rid);
+    LockTableShard *shard = GetShard(rid);
+    std::scoped_lock lock(shard->latch_);
+    EraseRequest(shard, &shard->lock_table_, rid, txn);
+  }
+  row_locks->erase(oid);
+  num_escalations_++;
+}
+
+void LockManager::WoundYounger(LockRequestQueue *queue, LockRequest *request, std::vector<txn_id_t> *wounded) {
+  for (LockRequest *other = queue->request_queue_.Front(); other != request; other = other->next_) {
+    if (Compatible(request->lock_mode_, other->lock_mode_)) {
+      continue;
+    }
+    // a committed transaction only has its locks left to release
+    TransactionState state = other->txn_->GetState();
+    if (other->txn_id_ > request->txn_id_ && state != TransactionState::ABORTED &&
+        state != TransactionState::COMMITTED) {
+      other->txn_->SetState(TransactionState::ABORTED);
+      CountAbort(AbortReason::DEADLOCK);
+      wounded->push_back(other->txn_id_);
     }
   }
-  
-  if (is_kill) 
-  {
-    cv.notify_all();
+  if (!wounded->empty()) {
+    // the requests behind the wounded ones may not have to wait for them anymore
+    WakeGrantable(queue);
   }
+}
 
-
-  //Wait lock   89089909
-  /*
-  ȴãÿ񱻻ʱǷɱ类ɱ׳쳣δɱǰǷδɱ
-  ûgranted_Ϊ档
-  */      
-  while (!can_grant) 
-  {
-    auto it = request_queue.begin();
-    while (txn_table_[it->txn_id_]->GetState() == TransactionState::ABORTED) 
+void LockManager::WakeAborted(const std::vector<txn_id_t> &aborted) {
+  for (txn_id_t txn_id : aborted) {
+    LockTableShard *shard;
+    RangeLockTable *range_locks = nullptr;
     {
-      ++it;
+      std::scoped_lock waiting_lock(waiting_latch_);
+      auto external = external_waits_.find(txn_id);
+      if (external != external_waits_.end()) {
+        range_locks = external->second.table_;
+      }
+      auto iter = waiting_for_.find(txn_id);
+      if (iter == waiting_for_.end()) {
+        shard = nullptr;
+      } else {
+        shard = iter->second.first;
+      }
     }
-    if (it->txn_id_ == txn_id) 
-    {
-      can_grant = true;
-      it->granted_ = true;
+    if (range_locks != nullptr) {
+      // the table outlives its waiters, Wake() takes its latch, so it cannot slip in before the wait
+      range_locks->Wake();
     }
-    if (!can_grant)
-    {
-      cv.wait(lk);
+    if (shard == nullptr) {
+      continue;
     }
-    if (txn->GetState() == TransactionState::ABORTED) 
-    {
-      throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+    // the waiter leaves waiting_for_ under its shard latch: if it is still there, so is its queue, and the notify
+    // cannot slip in between its state check and its wait
+    std::scoped_lock lock(shard->latch_);
+    std::scoped_lock waiting_lock(waiting_latch_);
+    auto iter = waiting_for_.find(txn_id);
+    if (iter != waiting_for_.end() && iter->second.first == shard) {
+      iter->second.second->cv_.notify_one();
     }
   }
-  return true;
-
+}
 
-  txn->GetExclusiveLockSet()->emplace(rid);
-  return true;
+void LockManager::SetExternalWait(Transaction *txn, RangeLockTable *table, std::vector<txn_id_t> holders) {
+  std::scoped_lock waiting_lock(waiting_latch_);
+  auto [wait, inserted] = external_waits_.try_emplace(txn->GetTransactionId(), ExternalWait{txn, table, {}});
+  wait->second.holders_ = std::move(holders);
+  if (inserted) {
+    external_contention_.RecordWait(nullptr, INVALID_TABLE_OID);
+  }
 }
 
+void LockManager::EndExternalWait(Transaction *txn, uint64_t wait_us) {
+  std::scoped_lock waiting_lock(waiting_latch_);
+  external_waits_.erase(txn->GetTransactionId());
+  external_contention_.RecordWaitTime(wait_us);
+}
 
+bool LockManager::CanGrant(LockRequestQueue *queue, LockRequest *request) {
+  for (LockRequest *other = queue->request_queue_.Front(); other != request; other = other->next_) {
+    if (other->txn_->GetState() != TransactionState::ABORTED && !Compatible(request->lock_mode_, other->lock_mode_)) {
+      return false;
+    }
+  }
+  return true;
+}
 
+bool LockManager::CanUpgrade(LockRequestQueue *queue, LockRequest *request, LockMode lock_mode) {
+  return std::none_of(queue->request_queue_.begin(), queue->request_queue_.end(), [=](const LockRequest &other) {
+    return other.granted_ && &other != request && other.txn_->GetState() != TransactionState::ABORTED &&
+           !Compatible(lock_mode, other.lock_mode_);
+  });
+}
 
+void LockManager::WakeGrantable(LockRequestQueue *queue) {
+  for (LockRequest &request : queue->request_queue_) {
+    if (!request.granted_ && CanGrant(queue, &request)) {
+      request.cv_.notify_one();
+    } else if (request.txn_id_ == queue->upgrading_ && CanUpgrade(queue, &request, queue->upgrading_mode_)) {
+      request.cv_.notify_one();
+    }
+  }
+}
 
-/*
-ΪдڼдҪ֤ǰûжô󣬾ͻụȴԷ
-ˣΪжǷڶά־upgrading_г
-еĶΪдѭжǷӸдǰûдֻΨһһö
-*/
-bool LockManager::LockUpgrade(Transaction *txn, const RID &rid) {
+template <typename Key>
+bool LockManager::EraseRequest(LockTableShard *shard, std::unordered_map<Key, LockRequestQueue> *lock_table,
+                               const Key &key, Transaction *txn) {
+  auto queue = lock_table->find(key);
+  if (queue == lock_table->end()) {
+    return false;
+  }
+  LockRequest *request = queue->second.request_queue_.Find(txn);
+  if (request == nullptr) {
+    return false;
+  }
+  // any mode that lets the transaction write: a table SHARED lock reads all rows without row locks, so an IX or SIX on
+  // the table stands for row writes as much as an EXCLUSIVE on a row does
+  if (request->granted_ && Covers(request->lock_mode_, LockMode::INTENTION_EXCLUSIVE) &&
+      txn->GetState() == TransactionState::COMMITTED) {
+    shard->released_commit_lsn_ = std::max(shard->released_commit_lsn_, txn->GetPrevLSN());
+  }
+  queue->second.request_queue_.Remove(request);
+  shard->FreeRequest(request);
+  if (queue->second.request_queue_.empty()) {
+    // nobody waits on the queue, otherwise its request would still be there
+    lock_table->erase(queue);
+  } else {
+    WakeGrantable(&queue->second);
+  }
+  return true;
+}
 
+void LockManager::WaitForGrant(LockTableShard *shard, LockRequestQueue *queue, LockRequest *request, const RID *rid,
+                               table_oid_t oid, std::unique_lock<std::mutex> *lock) {
+  std::vector<txn_id_t> wounded;
+  if (policy_ == DeadlockPolicy::WOUND_WAIT) {
+    WoundYounger(queue, request, &wounded);
+  }
+  if (!wounded.empty()) {
+    // our request stays in the queue, so the queue does not go away while the latch is dropped
+    lock->unlock();
+    WakeAborted(wounded);
+    lock->lock();
+  }
 
-  //жϵǰǷɱԼԪǷѾڵȴɱ׳쳣
-  //ͨ飬򽫵ǰеupgrading_ΪǰIDʾöдһȴ
-  if (txn->GetState() == TransactionState::ABORTED) 
-  {
-    return false;
+  if (CanGrant(queue, request)) {
+    request->granted_ = true;
+    request->txn_->AddCommitDependency(shard->released_commit_lsn_);
+    return;
   }
-  std::unique_lock<std::mutex> lk(latch_);
-  auto &lock_request_queue = lock_table_[rid];
-  if (lock_request_queue.upgrading_ != INVALID_TXN_ID) 
-  {
+  // the clock is only read on the slow path, a granted request costs the profile two counters
+  shard->contention_.RecordWait(rid, oid);
+  auto start = std::chrono::steady_clock::now();
+  while (!CanGrant(queue, request)) {
+    if (!WaitOnRequest(shard, request, lock)) {
+      shard->contention_.RecordWaitTime(MicrosSince(start));
+      throw TransactionAbortException(request->txn_id_, AbortReason::DEADLOCK);
+    }
+  }
+  shard->contention_.RecordWaitTime(MicrosSince(start));
+  request->granted_ = true;
+  request->txn_->AddCommitDependency(shard->released_commit_lsn_);
+}
+
+void LockManager::UpgradeRequest(LockTableShard *shard, LockRequestQueue *queue, LockRequest *request,
+                                 LockMode lock_mode, const RID *rid, table_oid_t oid,
+                                 std::unique_lock<std::mutex> *lock) {
+  Transaction *txn = request->txn_;
+  if (queue->upgrading_ != INVALID_TXN_ID) {
     txn->SetState(TransactionState::ABORTED);
+    CountAbort(AbortReason::UPGRADE_CONFLICT);
     throw TransactionAbortException(txn->GetTransactionId(), AbortReason::UPGRADE_CONFLICT);
   }
-
-  auto &request_queue = lock_request_queue.request_queue_;
-  auto &cv = lock_request_queue.cv_;
-  auto txn_id = txn->GetTransactionId();
-  lock_request_queue.upgrading_ = txn_id;
-
-//Wound WaitвδἰйظΪｫÿλѳΪһдȡÿ䳢ʱɱǰ
-//巽Ϊÿ񱻻ʱȼǷɱȻǰȼϵɱȼϸcan_grantΪ٣ʾ佫֮ɱһcan_grantΪΪlock_mode_upgrading_ʼ
-//ɹʱӵϡ
-  bool can_grant = false;
-  while (!can_grant) 
-  {
-    auto it = request_queue.begin();
-    auto target = it;
-    can_grant = true;
-    bool is_kill = false;
-    while (it != request_queue.end() && it->granted_) 
-    {
-      if (it->txn_id_ == txn_id) 
-      {
-        target = it;
-      } else if (it->txn_id_ > txn_id) 
-      {
-        txn_table_[it->txn_id_]->SetState(TransactionState::ABORTED);
-        is_kill = true;
-      } 
-      else 
-      {
+  queue->upgrading_ = txn->GetTransactionId();
+  queue->upgrading_mode_ = lock_mode;
+
+  bool waited = false;
+  std::chrono::steady_clock::time_point start;
+  while (true) {
+    bool can_grant = true;
+    std::vector<txn_id_t> wounded;
+    for (auto &other : queue->request_queue_) {
+      if (!other.granted_ || other.txn_ == txn || Compatible(lock_mode, other.lock_mode_)) {
+        continue;
+      }
+      TransactionState state = other.txn_->GetState();
+      if (state == TransactionState::ABORTED) {
+        continue;
+      }
+      if (policy_ == DeadlockPolicy::WOUND_WAIT && other.txn_id_ > request->txn_id_ &&
+          state != TransactionState::COMMITTED) {
+        other.txn_->SetState(TransactionState::ABORTED);
+        CountAbort(AbortReason::DEADLOCK);
+        wounded.push_back(other.txn_id_);
+      } else {
         can_grant = false;
       }
-      ++it;
     }
-    if (is_kill) 
-    {
-      cv.notify_all();
+    if (!wounded.empty()) {
+      WakeGrantable(queue);
+      lock->unlock();
+      WakeAborted(wounded);
+      lock->lock();
     }
-    if (!can_grant) 
-    {
-      cv.wait(lk);
-    } 
-    else 
-    {
-      target->lock_mode_ = LockMode::EXCLUSIVE;
-      lock_request_queue.upgrading_ = INVALID_TXN_ID;
+    if (can_grant) {
+      break;
     }
-    if (txn->GetState() == TransactionState::ABORTED) 
-    {
+    if (!waited) {
+      shard->contention_.RecordWait(rid, oid);
+      start = std::chrono::steady_clock::now();
+      waited = true;
+    }
+    if (!WaitOnRequest(shard, request, lock)) {
+      queue->upgrading_ = INVALID_TXN_ID;
+      shard->contention_.RecordWaitTime(MicrosSince(start));
       throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
     }
   }
+  if (waited) {
+    shard->contention_.RecordWaitTime(MicrosSince(start));
+  }
+  request->lock_mode_ = lock_mode;
+  queue->upgrading_ = INVALID_TXN_ID;
+  txn->AddCommitDependency(shard->released_commit_lsn_);
+}
 
-  txn->GetSharedLockSet()->erase(rid);
-  txn->GetExclusiveLockSet()->emplace(rid);
-  return true;
+bool LockManager::WaitOnRequest(LockTableShard *shard, LockRequest *request, std::unique_lock<std::mutex> *lock) {
+  Transaction *txn = request->txn_;
+  {
+    std::scoped_lock waiting_lock(waiting_latch_);
+    waiting_for_[txn->GetTransactionId()] = {shard, request};
+  }
+  // checked after registering, a wound from here on finds us in waiting_for_ and notifies the request
+  if (txn->GetState() != TransactionState::ABORTED) {
+    request->cv_.wait(*lock);
+  }
+  {
+    std::scoped_lock waiting_lock(waiting_latch_);
+    waiting_for_.erase(txn->GetTransactionId());
+  }
+  return txn->GetState() != TransactionState::ABORTED;
 }
 
+void LockManager::AddEdge(txn_id_t t1, txn_id_t t2) {
+  auto &edges = waits_for_[t1];
+  if (std::find(edges.begin(), edges.end(), t2) == edges.end()) {
+    edges.push_back(t2);
+  }
+}
 
+void LockManager::RemoveEdge(txn_id_t t1, txn_id_t t2) {
+  auto edges = waits_for_.find(t1);
+  if (edges == waits_for_.end()) {
+    return;
+  }
+  edges->second.erase(std::remove(edges->second.begin(), edges->second.end(), t2), edges->second.end());
+  if (edges->second.empty()) {
+    waits_for_.erase(edges);
+  }
+}
 
-//뼶ΪREAD_COMMITʱõĶʹϺͷţ˸񲻷2PL
-//Ϊ˳ļԣΪREAD_COMMITCOMMITABORT֮ǰʼձGROWING״̬񣬽ڵUnlockʱתΪSHRINKING״̬
-//ͷʱвɾӦȻ񣬲ɾ
-bool LockManager::Unlock(Transaction *txn, const RID &rid) {
+bool LockManager::HasCycle(txn_id_t *txn_id) {
+  std::vector<txn_id_t> txns;
+  for (auto &edges : waits_for_) {
+    txns.push_back(edges.first);
+    std::sort(edges.second.begin(), edges.second.end());
+  }
+  std::sort(txns.begin(), txns.end());
+  std::unordered_set<txn_id_t> visited;
+  std::vector<txn_id_t> path;
+  for (txn_id_t start : txns) {
+    if (visited.count(start) == 0 && FindCycle(waits_for_, start, &visited, &path, txn_id)) {
+      return true;
+    }
+  }
+  return false;
+}
 
-  if (txn->GetState() == TransactionState::GROWING && txn->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ) 
-  {
-    txn->SetState(TransactionState::SHRINKING);
+std::vector<std::pair<txn_id_t, txn_id_t>> LockManager::GetEdgeList() {
+  std::vector<std::pair<txn_id_t, txn_id_t>> edge_list;
+  for (const auto &edges : waits_for_) {
+    for (txn_id_t t2 : edges.second) {
+      edge_list.emplace_back(edges.first, t2);
+    }
   }
+  return edge_list;
+}
 
-  std::unique_lock<std::mutex> lk(latch_);
-  auto &lock_request_queue = lock_table_[rid];
-  auto &request_queue = lock_request_queue.request_queue_;
-  auto &cv = lock_request_queue.cv_;
-  auto txn_id = txn->GetTransactionId();
-  auto it = request_queue.begin();
-  while (it->txn_id_ != txn_id) 
+void LockManager::RunCycleDetection() {
+  std::vector<txn_id_t> aborted;
   {
-    ++it;
+    std::scoped_lock graph_lock(waits_for_latch_);
+    std::unordered_map<txn_id_t, Transaction *> waiters;
+    BuildWaitsForGraph(&waiters);
+    txn_id_t victim;
+    while (HasCycle(&victim)) {
+      // the victim waits in a deadlock, so it is stuck in the lock manager and alive until we wake it
+      waiters.at(victim)->SetState(TransactionState::ABORTED);
+      aborted.push_back(victim);
+      waits_for_.erase(victim);
+      for (auto &edges : waits_for_) {
+        edges.second.erase(std::remove(edges.second.begin(), edges.second.end(), victim), edges.second.end());
+      }
+    }
+    waits_for_.clear();
+  }
+  num_deadlock_aborts_ += aborted.size();
+  if (!aborted.empty()) {
+    CountAbort(AbortReason::DEADLOCK, aborted.size());
   }
+  WakeAborted(aborted);
+}
 
-  request_queue.erase(it);
-  cv.notify_all();                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                        
-  txn->GetSharedLockSet()->erase(rid);
-  txn->GetExclusiveLockSet()->erase(rid);
-  return true;
+void LockManager::BuildWaitsForGraph(std::unordered_map<txn_id_t, Transaction *> *waiters) {
+  waits_for_.clear();
+  auto add_edges = [&](LockRequestQueue *queue) {
+    for (auto request = queue->request_queue_.begin(); request != queue->request_queue_.end(); ++request) {
+      if (request->txn_->GetState() == TransactionState::ABORTED) {
+        continue;
+      }
+      if (!request->granted_) {
+        // FIFO: a waiting request waits for every conflicting request before it
+        waiters->emplace(request->txn_id_, request->txn_);
+        for (auto other = queue->request_queue_.begin(); other != request; ++other) {
+          if (other->txn_->GetState() != TransactionState::ABORTED &&
+              !Compatible(request->lock_mode_, other->lock_mode_)) {
+            AddEdge(request->txn_id_, other->txn_id_);
+          }
+        }
+      } else if (request->txn_id_ == queue->upgrading_) {
+        waiters->emplace(request->txn_id_, request->txn_);
+        for (const auto &other : queue->request_queue_) {
+          if (other.granted_ && other.txn_ != request->txn_ && other.txn_->GetState() != TransactionState::ABORTED &&
+              !Compatible(queue->upgrading_mode_, other.lock_mode_)) {
+            AddEdge(request->txn_id_, other.txn_id_);
+          }
+        }
+      }
+    }
+  };
+
+  // all shards at once, in order, so the graph has no edges that never existed at the same time
+  std::vector<std::unique_lock<std::mutex>> locks;
+  locks.reserve(shards_.size());
+  for (auto &shard : shards_) {
+    locks.emplace_back(shard->latch_);
+  }
+  for (auto &shard : shards_) {
+    for (auto &entry : shard->lock_table_) {
+      add_edges(&entry.second);
+    }
+    for (auto &entry : shard->table_lock_table_) {
+      add_edges(&entry.second);
+    }
+  }
+  // the range locks of the indexes, a cycle may run through them and the row locks
+  std::scoped_lock waiting_lock(waiting_latch_);
+  for (const auto &[txn_id, wait] : external_waits_) {
+    if (wait.txn_->GetState() == TransactionState::ABORTED) {
+      continue;
+    }
+    waiters->emplace(txn_id, wait.txn_);
+    for (txn_id_t holder : wait.holders_) {
+      AddEdge(txn_id, holder);
+    }
+  }
 }
 
 }  // namespace bustub
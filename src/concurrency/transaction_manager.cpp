@@ -12,31 +12,68 @@
 
 #include "concurrency/transaction_manager.h"
 
+#include <algorithm>
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "catalog/catalog.h"
 #include "storage/table/table_heap.h"
 
 namespace bustub {
 
-std::unordered_map<txn_id_t, Transaction *> TransactionManager::txn_map = {};
-std::shared_mutex TransactionManager::txn_map_mutex = {};
+TransactionRegistry TransactionManager::txn_registry = {};
+std::atomic<uint64_t> TransactionManager::next_instance_id = {1};
 
-Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level) {
-  // Acquire the global transaction latch in shared mode.
-  global_txn_latch_.RLock();
+Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level,
+                                       ConcurrencyControl concurrency_control) {
+  // Enter the transaction epoch, this only touches the slot of our thread.
+  txn_epoch_latch_.Enter();
 
   if (txn == nullptr) {
-    txn = new Transaction(next_txn_id_++, isolation_level);
+    txn = new Transaction(NextTxnId(), isolation_level);
   }
-  txn_map_mutex.lock();
-  txn_map[txn->GetTransactionId()] = txn;
-  txn_map_mutex.unlock();
+  txn->SetConcurrencyControl(concurrency_control);
+  txn->SetVersionStore(&version_store_);
+  version_store_.Begin(txn);
+
+  if (enable_logging) {
+    {
+      // the lower bound is taken under the latch, so a checkpoint that misses the transaction logs its BEGIN first
+      ActiveTxnShard *shard = GetActiveTxnShard(txn->GetTransactionId());
+      std::scoped_lock lock(shard->latch_);
+      shard->first_lsns_[txn->GetTransactionId()] = log_manager_->GetNextLSN();
+    }
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::BEGIN);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+  }
+  txn_registry.Insert(txn);
   return txn;
 }
 
-void TransactionManager::Commit(Transaction *txn) {
+bool TransactionManager::Commit(Transaction *txn) {
+  if (txn->GetConcurrencyControl() == ConcurrencyControl::OPTIMISTIC) {
+    if (!Validate(txn)) {
+      Abort(txn);
+      return false;
+    }
+    // from here on the table heap writes in place, under the locks Validate() took
+    txn->SetState(TransactionState::COMMITTED);
+    auto buffered_write_set = txn->GetBufferedWriteSet();
+    for (const auto &item : *buffered_write_set) {
+      bool installed = item.wtype_ == WType::DELETE ? item.table_->MarkDelete(item.rid_, txn)
+                                                    : item.table_->UpdateTuple(item.tuple_, item.rid_, txn);
+      if (!installed) {
+        // the new row did not fit into its page
+        Abort(txn);
+        return false;
+      }
+    }
+    buffered_write_set->clear();
+    txn->GetReadSet()->clear();
+  }
+
   txn->SetState(TransactionState::COMMITTED);
 
   // Perform all deletes before we commit.
@@ -45,37 +82,81 @@ void TransactionManager::Commit(Transaction *txn) {
     auto &item = write_set->back();
     auto table = item.table_;
     if (item.wtype_ == WType::DELETE) {
-      // Note that this also releases the lock when holding the page latch.
+      // the row lock is released with the others, after the COMMIT record whose LSN the next holder depends on
       table->ApplyDelete(item.rid_, txn);
     }
     write_set->pop_back();
   }
   write_set->clear();
 
-  // Release all the locks.
-  ReleaseLocks(txn);
-  // Release the global transaction latch.
-  global_txn_latch_.RUnlock();
+  bool released = false;
+  if (enable_logging) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::COMMIT);
+    lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+    txn->SetPrevLSN(lsn);
+    RemoveActiveTransaction(txn->GetTransactionId());
+    // a transaction that read without locks may have seen the writes of any early release before its commit
+    if (txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT ||
+        txn->GetConcurrencyControl() == ConcurrencyControl::OPTIMISTIC) {
+      txn->AddCommitDependency(early_release_lsn_);
+    }
+    if (early_lock_release_) {
+      // the COMMIT record is in the log buffer, so nothing can keep us from committing anymore: let the others at our
+      // rows while the log is written, the lock manager makes those that get them depend on our COMMIT record
+      lsn_t early_release_lsn = early_release_lsn_;
+      while (early_release_lsn < lsn && !early_release_lsn_.compare_exchange_weak(early_release_lsn, lsn)) {
+      }
+      version_store_.Commit(txn);
+      ReleaseLocks(txn);
+      released = true;
+    }
+    if (async_commit_ || txn->IsAsyncCommit()) {
+      log_manager_->FlushAsync(lsn, txn->GetTransactionId());
+    } else {
+      // group commit, wait until the flush thread of our log partition has written our COMMIT record, and the other
+      // partitions the COMMIT records we depend on
+      log_manager_->FlushUntil(lsn, txn->GetTransactionId(), txn->GetCommitDependency());
+    }
+  }
+  if (!released) {
+    // new snapshots see the writes from now on, the locks keep other writers off until they do
+    version_store_.Commit(txn);
+
+    // Release all the locks.
+    ReleaseLocks(txn);
+  }
+  txn_registry.Erase(txn);
+  // Exit the transaction epoch.
+  txn_epoch_latch_.Exit();
+  return true;
 }
 
 void TransactionManager::Abort(Transaction *txn) {
   txn->SetState(TransactionState::ABORTED);
+  // buffered writes never reached the tables
+  txn->GetBufferedWriteSet()->clear();
+  txn->GetReadSet()->clear();
   // Rollback before releasing the lock.
   auto table_write_set = txn->GetWriteSet();
+  std::vector<RID> written_rids;
   while (!table_write_set->empty()) {
     auto &item = table_write_set->back();
     auto table = item.table_;
     if (item.wtype_ == WType::DELETE) {
       table->RollbackDelete(item.rid_, txn);
     } else if (item.wtype_ == WType::INSERT) {
-      // Note that this also releases the lock when holding the page latch.
       table->ApplyDelete(item.rid_, txn);
     } else if (item.wtype_ == WType::UPDATE) {
       table->UpdateTuple(item.tuple_, item.rid_, txn);
     }
+    written_rids.push_back(item.rid_);
     table_write_set->pop_back();
   }
   table_write_set->clear();
+  // until now snapshots saw the versions from before the transaction, now the pages hold them again
+  for (const RID &rid : written_rids) {
+    version_store_.RemoveVersions(rid, txn);
+  }
   // Rollback index updates
   auto index_write_set = txn->GetIndexWriteSet();
   while (!index_write_set->empty()) {
@@ -102,14 +183,96 @@ void TransactionManager::Abort(Transaction *txn) {
   table_write_set->clear();
   index_write_set->clear();
 
+  if (enable_logging) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ABORT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+    RemoveActiveTransaction(txn->GetTransactionId());
+  }
+  version_store_.Abort(txn);
+
   // Release all the locks.
   ReleaseLocks(txn);
-  // Release the global transaction latch.
-  global_txn_latch_.RUnlock();
+  txn_registry.Erase(txn);
+  // Exit the transaction epoch.
+  txn_epoch_latch_.Exit();
+}
+
+bool TransactionManager::Validate(Transaction *txn) {
+  // tables and rows in a fixed order, two validating transactions do not wait for each other the other way around
+  std::map<table_oid_t, TableHeap *> tables;
+  for (const auto &item : *txn->GetBufferedWriteSet()) {
+    tables.emplace(item.table_->GetOid(), item.table_);
+  }
+  for (const auto &item : *txn->GetWriteSet()) {
+    tables.emplace(item.table_->GetOid(), item.table_);
+  }
+  std::vector<std::pair<RID, TableHeap *>> rows;
+  for (const auto &item : *txn->GetBufferedWriteSet()) {
+    rows.emplace_back(item.rid_, item.table_);
+  }
+  std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) { return a.first.Get() < b.first.Get(); });
+  rows.erase(std::unique(rows.begin(), rows.end(), [](const auto &a, const auto &b) { return a.first == b.first; }),
+             rows.end());
+
+  try {
+    for (const auto &table : tables) {
+      if (table.first != INVALID_TABLE_OID &&
+          !lock_manager_->LockTable(txn, table.first, LockMode::INTENTION_EXCLUSIVE)) {
+        return false;
+      }
+    }
+    for (const auto &row : rows) {
+      if (!txn->IsExclusiveLocked(row.first) &&
+          !(txn->IsSharedLocked(row.first) ? lock_manager_->LockUpgrade(txn, row.first, row.second->GetOid())
+                                           : lock_manager_->LockExclusive(txn, row.first, row.second->GetOid()))) {
+        return false;
+      }
+    }
+  } catch (TransactionAbortException &) {
+    return false;
+  }
+
+  // the write locks stay until the end of the commit, a transaction that read our rows cannot validate before that
+  return std::all_of(txn->GetReadSet()->begin(), txn->GetReadSet()->end(),
+                     [txn](const auto &read) { return read.second.table_->ValidateRead(read.second, txn); });
+}
+
+std::vector<std::pair<txn_id_t, lsn_t>> TransactionManager::GetActiveTransactionTable() {
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txn_table;
+  for (auto &shard : active_txn_shards_) {
+    std::scoped_lock lock(shard.latch_);
+    active_txn_table.insert(active_txn_table.end(), shard.first_lsns_.begin(), shard.first_lsns_.end());
+  }
+  return active_txn_table;
+}
+
+void TransactionManager::RemoveActiveTransaction(txn_id_t txn_id) {
+  ActiveTxnShard *shard = GetActiveTxnShard(txn_id);
+  std::scoped_lock lock(shard->latch_);
+  shard->first_lsns_.erase(txn_id);
+}
+
+txn_id_t TransactionManager::NextTxnId() {
+  if (lock_manager_->GetDeadlockPolicy() == DeadlockPolicy::WOUND_WAIT) {
+    // an idle thread would hand out old ids from its batch, and its transactions would wound the younger ones
+    return next_txn_id_++;
+  }
+  struct IdBatch {
+    uint64_t instance_id_;
+    txn_id_t next_;
+    txn_id_t end_;
+  };
+  thread_local IdBatch batch{0, 0, 0};
+  if (batch.instance_id_ != instance_id_ || batch.next_ == batch.end_) {
+    batch.instance_id_ = instance_id_;
+    batch.next_ = next_txn_id_.fetch_add(TXN_ID_BATCH_SIZE);
+    batch.end_ = batch.next_ + TXN_ID_BATCH_SIZE;
+  }
+  return batch.next_++;
 }
 
-void TransactionManager::BlockAllTransactions() { global_txn_latch_.WLock(); }
+void TransactionManager::BlockAllTransactions() { txn_epoch_latch_.Quiesce(); }
 
-void TransactionManager::ResumeTransactions() { global_txn_latch_.WUnlock(); }
+void TransactionManager::ResumeTransactions() { txn_epoch_latch_.Resume(); }
 
 }  // namespace bustub
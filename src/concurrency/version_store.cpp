@@ -0,0 +1,190 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.cpp
+//
+// Identification: src/concurrency/version_store.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "concurrency/version_store.h"
+
+namespace bustub {
+
+VersionStore::VersionStore(size_t num_shards) {
+  for (size_t i = 0; i < num_shards; i++) {
+    shards_.emplace_back(std::make_unique<VersionShard>());
+  }
+}
+
+void VersionStore::Begin(Transaction *txn) {
+  if (txn->GetIsolationLevel() != IsolationLevel::SNAPSHOT) {
+    txn->SetVersionMode(VersionMode::UNDECIDED);
+    return;
+  }
+  txn->SetVersionMode(VersionMode::KEEP_VERSIONS);
+  // the writers that started before us keep no versions, the snapshot can only be taken once they are done
+  num_snapshots_++;
+  std::unique_lock lock(ts_latch_);
+  unversioned_done_.wait(lock, [&] { return num_unversioned_writers_ == 0; });
+  txn->SetReadTs(last_commit_ts_);
+  active_snapshots_.insert(last_commit_ts_);
+}
+
+bool VersionStore::KeepsVersions(Transaction *txn) {
+  if (txn->GetVersionMode() == VersionMode::UNDECIDED) {
+    // a beginning snapshot counts itself before it looks at the writers and we count ourselves before we look at the
+    // snapshots, so either we see it and keep versions or it sees us and waits for us
+    num_unversioned_writers_++;
+    if (num_snapshots_ == 0) {
+      txn->SetVersionMode(VersionMode::NO_VERSIONS);
+    } else {
+      EndUnversionedWrites();
+      txn->SetVersionMode(VersionMode::KEEP_VERSIONS);
+    }
+  }
+  return txn->GetVersionMode() == VersionMode::KEEP_VERSIONS;
+}
+
+void VersionStore::EndUnversionedWrites() {
+  if (--num_unversioned_writers_ == 0 && num_snapshots_ > 0) {
+    std::scoped_lock lock(ts_latch_);
+    unversioned_done_.notify_all();
+  }
+}
+
+void VersionStore::Commit(Transaction *txn) {
+  if (txn->GetVersionMode() != VersionMode::KEEP_VERSIONS) {
+    // no version waits for a commit timestamp, the pages show the writes to every snapshot taken from now on
+    if (txn->GetVersionMode() == VersionMode::NO_VERSIONS) {
+      EndUnversionedWrites();
+    }
+    return;
+  }
+  bool collect;
+  {
+    // the versions learn the timestamp before the clock moves, a snapshot that includes the commit sees them stamped
+    std::scoped_lock lock(ts_latch_);
+    txn->GetCommitTs()->store(last_commit_ts_ + 1);
+    last_commit_ts_++;
+    if (txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT) {
+      active_snapshots_.erase(active_snapshots_.find(txn->GetReadTs()));
+      num_snapshots_--;
+    }
+    collect = ++num_commits_ % VERSION_GC_INTERVAL == 0;
+  }
+  if (collect) {
+    GarbageCollect();
+  }
+}
+
+void VersionStore::Abort(Transaction *txn) {
+  if (txn->GetVersionMode() == VersionMode::NO_VERSIONS) {
+    // the rollback is on the pages already
+    EndUnversionedWrites();
+  } else if (txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT) {
+    std::scoped_lock lock(ts_latch_);
+    active_snapshots_.erase(active_snapshots_.find(txn->GetReadTs()));
+    num_snapshots_--;
+  }
+}
+
+void VersionStore::AddVersion(const RID &rid, Transaction *txn, const Tuple *old_tuple) {
+  timestamp_t watermark = GetWatermark();
+  VersionShard *shard = GetShard(rid);
+  std::scoped_lock lock(shard->latch_);
+  auto &chain = shard->chains_[rid];
+  Prune(&chain, watermark);
+  chain.push_back(Version{old_tuple != nullptr ? *old_tuple : Tuple{}, old_tuple != nullptr, txn->GetTransactionId(),
+                          txn->GetCommitTs()});
+}
+
+void VersionStore::RemoveVersions(const RID &rid, Transaction *txn) {
+  VersionShard *shard = GetShard(rid);
+  std::scoped_lock lock(shard->latch_);
+  auto chain = shard->chains_.find(rid);
+  if (chain == shard->chains_.end()) {
+    return;
+  }
+  // the lock on the row kept other writers off, so the versions of the transaction are the newest ones
+  while (!chain->second.empty() && chain->second.back().writer_ == txn->GetTransactionId()) {
+    chain->second.pop_back();
+  }
+  if (chain->second.empty()) {
+    shard->chains_.erase(chain);
+  }
+}
+
+bool VersionStore::GetVisibleVersion(const RID &rid, Transaction *txn, Tuple *tuple, bool exists) {
+  VersionShard *shard = GetShard(rid);
+  std::scoped_lock lock(shard->latch_);
+  auto chain = shard->chains_.find(rid);
+  if (chain == shard->chains_.end()) {
+    return exists;
+  }
+  // undo the writes the snapshot does not see, newest first
+  for (auto version = chain->second.rbegin(); version != chain->second.rend(); ++version) {
+    if (version->writer_ == txn->GetTransactionId() || *version->commit_ts_ <= txn->GetReadTs()) {
+      break;
+    }
+    exists = version->exists_;
+    if (exists) {
+      *tuple = version->tuple_;
+    }
+  }
+  return exists;
+}
+
+bool VersionStore::HasWriteConflict(const RID &rid, Transaction *txn) {
+  VersionShard *shard = GetShard(rid);
+  std::scoped_lock lock(shard->latch_);
+  auto chain = shard->chains_.find(rid);
+  if (chain == shard->chains_.end()) {
+    return false;
+  }
+  // the newest write is the only one that can be newer than the snapshot, earlier ones committed before it
+  const Version &newest = chain->second.back();
+  return newest.writer_ != txn->GetTransactionId() && *newest.commit_ts_ > txn->GetReadTs();
+}
+
+void VersionStore::GarbageCollect() {
+  timestamp_t watermark = GetWatermark();
+  for (auto &shard : shards_) {
+    std::scoped_lock lock(shard->latch_);
+    for (auto chain = shard->chains_.begin(); chain != shard->chains_.end();) {
+      Prune(&chain->second, watermark);
+      chain = chain->second.empty() ? shard->chains_.erase(chain) : std::next(chain);
+    }
+  }
+}
+
+size_t VersionStore::GetNumVersions() {
+  size_t num_versions = 0;
+  for (auto &shard : shards_) {
+    std::scoped_lock lock(shard->latch_);
+    for (const auto &chain : shard->chains_) {
+      num_versions += chain.second.size();
+    }
+  }
+  return num_versions;
+}
+
+timestamp_t VersionStore::GetWatermark() {
+  std::scoped_lock lock(ts_latch_);
+  return active_snapshots_.empty() ? last_commit_ts_ : *active_snapshots_.begin();
+}
+
+void VersionStore::Prune(std::vector<Version> *chain, timestamp_t watermark) {
+  // every snapshot sees the newest write that committed at or before the watermark, and stops its walk there
+  for (auto version = chain->rbegin(); version != chain->rend(); ++version) {
+    if (*version->commit_ts_ <= watermark) {
+      chain->erase(chain->begin(), version.base());
+      return;
+    }
+  }
+}
+
+}  // namespace bustub
@@ -28,7 +28,7 @@ DeleteExecutor::DeleteExecutor(ExecutorContext *exec_ctx, const DeletePlanNode *
 
 
 void DeleteExecutor::Init() {
-
+    LockTable(plan_->TableOid(), WriteLockMode(plan_->TableOid(), plan_->GetChildPlan()));
     child_executor_->Init();
 
 }
@@ -11,12 +11,126 @@
 //===----------------------------------------------------------------------===//
 #include "execution/executors/index_scan_executor.h"
 
+#include "concurrency/transaction_manager.h"
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_expression.h"
+#include "execution/expressions/constant_value_expression.h"
+
 namespace bustub {
 IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanPlanNode *plan)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx), plan_(plan) {}
+
+void IndexScanExecutor::Init() {
+  Catalog *catalog = exec_ctx_->GetCatalog();
+  index_info_ = catalog->GetIndex(plan_->GetIndexOid());
+  table_info_ = catalog->GetTable(index_info_->table_name_);
+
+  // the scan reads only the rows it finds in the index, they are locked one by one under IS like in a sequential scan
+  // under READ_COMMITTED, the range lock of a SERIALIZABLE scan keeps out the rows it did not find
+  Transaction *txn = exec_ctx_->GetTransaction();
+  if (txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED &&
+      txn->GetIsolationLevel() != IsolationLevel::SNAPSHOT) {
+    LockTable(table_info_->oid_, LockMode::INTENTION_SHARED);
+  }
+  rids_.clear();
+  next_ = 0;
+  SetScanRange();
+  index_info_->index_->ScanRange(low_key_ ? &*low_key_ : nullptr, high_key_ ? &*high_key_ : nullptr, &rids_, txn);
+}
+
+void IndexScanExecutor::SetScanRange() {
+  low_key_.reset();
+  high_key_.reset();
+  const auto *comparison = dynamic_cast<const ComparisonExpression *>(plan_->GetPredicate());
+  const auto &key_attrs = index_info_->index_->GetKeyAttrs();
+  if (comparison == nullptr || key_attrs.size() != 1) {
+    return;
+  }
+
+  // the predicate is evaluated against the output schema, its column has to be the key column of the table
+  ComparisonType comp_type = comparison->GetComparisonType();
+  const auto *column = dynamic_cast<const ColumnValueExpression *>(comparison->GetChildAt(0));
+  const auto *constant = dynamic_cast<const ConstantValueExpression *>(comparison->GetChildAt(1));
+  if (column == nullptr || constant == nullptr) {
+    column = dynamic_cast<const ColumnValueExpression *>(comparison->GetChildAt(1));
+    constant = dynamic_cast<const ConstantValueExpression *>(comparison->GetChildAt(0));
+    if (column == nullptr || constant == nullptr) {
+      return;
+    }
+    // constant < column is column > constant
+    switch (comp_type) {
+      case ComparisonType::LessThan:
+        comp_type = ComparisonType::GreaterThan;
+        break;
+      case ComparisonType::LessThanOrEqual:
+        comp_type = ComparisonType::GreaterThanOrEqual;
+        break;
+      case ComparisonType::GreaterThan:
+        comp_type = ComparisonType::LessThan;
+        break;
+      case ComparisonType::GreaterThanOrEqual:
+        comp_type = ComparisonType::LessThanOrEqual;
+        break;
+      default:
+        break;
+    }
+  }
+  const auto *table_column =
+      dynamic_cast<const ColumnValueExpression *>(GetOutputSchema()->GetColumn(column->GetColIdx()).GetExpr());
+  if (table_column == nullptr || table_column->GetColIdx() != key_attrs[0]) {
+    return;
+  }
 
-void IndexScanExecutor::Init() {}
+  // the bounds of the index are inclusive, a strict comparison scans its constant too and the predicate drops it
+  const Schema *key_schema = index_info_->index_->GetKeySchema();
+  Value value = constant->Evaluate(nullptr, nullptr).CastAs(key_schema->GetColumn(0).GetType());
+  Tuple key{std::vector<Value>{value}, key_schema};
+  switch (comp_type) {
+    case ComparisonType::Equal:
+      low_key_ = key;
+      high_key_ = key;
+      break;
+    case ComparisonType::LessThan:
+    case ComparisonType::LessThanOrEqual:
+      high_key_ = key;
+      break;
+    case ComparisonType::GreaterThan:
+    case ComparisonType::GreaterThanOrEqual:
+      low_key_ = key;
+      break;
+    default:
+      break;
+  }
+}
 
-bool IndexScanExecutor::Next(Tuple *tuple, RID *rid) { return false; }
+bool IndexScanExecutor::Next(Tuple *tuple, RID *rid) {
+  Transaction *txn = exec_ctx_->GetTransaction();
+  LockManager *lock_mgr = exec_ctx_->GetLockManager();
+  const Schema *out_schema = GetOutputSchema();
+  while (next_ < rids_.size()) {
+    *rid = rids_[next_++];
+    Tuple table_tuple;
+    // TableHeap::GetTuple() takes the row S lock, the row may be gone since the index was read
+    if (!table_info_->table_->GetTuple(*rid, &table_tuple, txn)) {
+      if (txn->GetState() == TransactionState::ABORTED) {
+        throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+      }
+      continue;
+    }
+    std::vector<Value> values;
+    for (const auto &col : out_schema->GetColumns()) {
+      values.emplace_back(col.GetExpr()->Evaluate(&table_tuple, &table_info_->schema_));
+    }
+    *tuple = Tuple(values, out_schema);
+    if (txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED && txn->IsSharedLocked(*rid)) {
+      lock_mgr->Unlock(txn, *rid);
+    }
+    const auto *predicate = plan_->GetPredicate();
+    if (predicate == nullptr || predicate->Evaluate(tuple, out_schema).GetAs<bool>()) {
+      return true;
+    }
+  }
+  return false;
+}
 
 }  // namespace bustub
@@ -39,6 +39,7 @@ InsertExecutor::InsertExecutor(ExecutorContext *exec_ctx, const InsertPlanNode *
 
 //ԪԴΪƻڵʱִжӦƻڵInit()
 void InsertExecutor::Init() {
+    LockTable(plan_->TableOid(), LockMode::INTENTION_EXCLUSIVE);
 
     if(!is_raw_)
     {
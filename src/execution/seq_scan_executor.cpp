@@ -12,6 +12,8 @@
 
 #include "execution/executors/seq_scan_executor.h"
 
+#include "concurrency/transaction_manager.h"
+
 namespace bustub {
 
 
@@ -30,6 +32,17 @@ SeqScanExecutor::SeqScanExecutor(ExecutorContext *exec_ctx, const SeqScanPlanNod
 
 //ִмƻڵĳʼ趨ĵʹòѯƻ±
 void SeqScanExecutor::Init() {
+    // the scan reads every row: under REPEATABLE_READ one table S lock stands in for the row S locks it would hold
+    // until commit anyway, READ_COMMITTED keeps its short row locks under IS so that writers can go on, SNAPSHOT reads
+    // older versions where writers are busy and locks nothing, and neither does an optimistic transaction, its commit
+    // validates what it read
+    Transaction *txn = exec_ctx_->GetTransaction();
+    if (txn->HoldsSharedLocks()) {
+        LockTable(plan_->GetTableOid(), LockMode::SHARED);
+    } else if (txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED) {
+        LockTable(plan_->GetTableOid(), LockMode::INTENTION_SHARED);
+    }
+    table_locked_ = LockManager::IsTableLocked(txn, plan_->GetTableOid(), LockMode::SHARED);
     iter_ = table_info_->table_->Begin(exec_ctx_->GetTransaction());
     end_ = table_info_->table_->End();
 }
@@ -55,9 +68,13 @@ bool SeqScanExecutor::Next(Tuple *tuple, RID *rid) {
     {
         Tuple table_tuple = *iter_;
         *rid = table_tuple.GetRid();
-        if (txn->GetSharedLockSet()->count(*rid) == 0U && txn->GetExclusiveLockSet()->count(*rid) == 0U) 
+        if (!table_locked_ && txn->GetSharedLockSet()->count(*rid) == 0U &&
+            txn->GetExclusiveLockSet()->count(*rid) == 0U) 
         {
-            if (txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED && !lock_mgr->LockShared(txn, *rid)) 
+            if (txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED &&
+                txn->GetIsolationLevel() != IsolationLevel::SNAPSHOT &&
+                txn->GetConcurrencyControl() != ConcurrencyControl::OPTIMISTIC &&
+                !lock_mgr->LockShared(txn, *rid, plan_->GetTableOid())) 
             {
                 txn_mgr->Abort(txn);
             }
@@ -72,7 +89,7 @@ bool SeqScanExecutor::Next(Tuple *tuple, RID *rid) {
         if (predicate == nullptr || predicate->Evaluate(tuple, out_schema).GetAs<bool>()) 
         {
             ++iter_;
-            if (txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED) 
+            if (txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED && txn->IsSharedLocked(*rid)) 
             {
                 lock_mgr->Unlock(txn, *rid);
             }
@@ -27,7 +27,7 @@ UpdateExecutor::UpdateExecutor(ExecutorContext *exec_ctx, const UpdatePlanNode *
 
 
 void UpdateExecutor::Init() {
-
+  LockTable(plan_->TableOid(), WriteLockMode(plan_->TableOid(), plan_->GetChildPlan()));
   child_executor_->Init();
 }
 
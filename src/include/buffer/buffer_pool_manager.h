@@ -15,6 +15,8 @@
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
@@ -87,6 +89,16 @@ class BufferPoolManager {
   /** @return size of the buffer pool */
   virtual size_t GetPoolSize() = 0;
 
+  /**
+   * Collect the dirty page table for a fuzzy checkpoint. Pinned pages are included even if they are clean, they may be
+   * changed at any moment.
+   * @return the recovery LSN of every page that is dirty or pinned
+   */
+  virtual std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPageTable() = 0;
+
+  /** @return the number of evictions that had to wait until the log was flushed up to the LSN of the evicted page */
+  virtual uint64_t GetNumForcedLogFlushes() = 0;
+
  protected:
   /**
    * Grading function. Do not modify!
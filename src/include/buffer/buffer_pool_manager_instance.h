@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
@@ -64,6 +65,14 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** @return size of the buffer pool */
   size_t GetPoolSize() override { return pool_size_; }
 
+  /**
+   * Collect the dirty page table for a fuzzy checkpoint.
+   * @return the recovery LSN of every page that is dirty or pinned
+   */
+  std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPageTable() override;
+
+  uint64_t GetNumForcedLogFlushes() override { return num_forced_log_flushes_; }
+
 
 
 
@@ -210,6 +219,29 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   void ValidatePageId(page_id_t page_id) const;
 
+  /**
+   * Write-ahead rule: before a page is written back, force the log up to the page's LSN if it is not persistent yet.
+   * Caller must hold latch_.
+   * @param page the page about to be written to disk
+   * @return true if the log had to be flushed
+   */
+  bool FlushLogForPage(Page *page);
+
+  /**
+   * Pick a frame to evict from the replacer. With logging, frames whose page can be written back without flushing the
+   * log first are preferred, and the flush threads are woken up for the ones that were passed over. Caller must hold
+   * latch_.
+   * @param[out] frame_id the frame to evict
+   * @return false if all frames are pinned
+   */
+  bool PickVictim(frame_id_t *frame_id);
+
+  /**
+   * Start a new recovery LSN for a page that was clean and unpinned, its next change is logged after this call.
+   * Caller must hold latch_.
+   */
+  void ResetRecLSN(Page *page);
+
 
 
 
@@ -230,7 +262,7 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   DiskManager *disk_manager_ __attribute__((__unused__));   // 磁盘管理器，提供从磁盘读入页面及写入页面的接口；
 
   /** Pointer to the log manager. */
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
 
   /** Page table for keeping track of buffer pool pages. */
   std::unordered_map<page_id_t, frame_id_t> page_table_;    // 保存磁盘页面IDpage_id和槽位IDframe_id_t的映射； 
@@ -243,5 +275,7 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   
   /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
   std::mutex latch_;
+  /** Number of evictions that had to flush the log, see FlushLogForPage(). */
+  std::atomic<uint64_t> num_forced_log_flushes_{0};
 };
 }  // namespace bustub
\ No newline at end of file
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <functional>
 #include <list>
 #include <mutex>  // NOLINT
 #include <vector>
@@ -44,6 +45,9 @@ public:
 
     auto Victim(frame_id_t *frame_id) -> bool override;       //ʹõҳ棬ȥҳݴ洢 *frame_idУΪʱFalse򷵻True
 
+    // the least recently used frame that prefer accepts, the least recently used one if it accepts none
+    auto PreferredVictim(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &prefer) -> bool override;
+
     void Pin(frame_id_t frame_id) override;   
 
     void Unpin(frame_id_t frame_id) override;
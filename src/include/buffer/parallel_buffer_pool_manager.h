@@ -50,6 +50,12 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   /** @return size of the buffer pool */
   size_t GetPoolSize() override;
 
+  /** @return the dirty page tables of all instances */
+  std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPageTable() override;
+
+  /** @return the number of forced log flushes of all instances */
+  uint64_t GetNumForcedLogFlushes() override;
+
  protected:
 
 
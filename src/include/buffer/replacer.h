@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include "common/config.h"
 
 namespace bustub {
@@ -31,6 +33,17 @@ class Replacer {
    */
   virtual bool Victim(frame_id_t *frame_id) = 0;
 
+  /**
+   * Remove the first frame in replacement order that prefer accepts. If it accepts none, remove the frame Victim()
+   * would remove. Replacers that do not implement a preference always do the latter.
+   * @param[out] frame_id id of frame that was removed
+   * @param prefer tells whether a frame is a good victim
+   * @return true if a victim frame was found, false otherwise
+   */
+  virtual bool PreferredVictim(frame_id_t *frame_id, const std::function<bool(frame_id_t)> & /*prefer*/) {
+    return Victim(frame_id);
+  }
+
   /**
    * Pins a frame, indicating that it should not be victimized until it is unpinned.
    * @param frame_id the id of the frame to pin
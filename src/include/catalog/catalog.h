@@ -21,6 +21,7 @@
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/schema.h"
 #include "container/hash/hash_function.h"
+#include "storage/index/b_plus_tree_index.h"
 #include "storage/index/extendible_hash_table_index.h"
 #include "storage/index/index.h"
 #include "storage/table/table_heap.h"
@@ -144,12 +145,12 @@ class Catalog {
       return NULL_TABLE_INFO;
     }
 
-    // Construct the table heap
-    auto table = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, txn);
-
     // Fetch the table OID for the new table
     const auto table_oid = next_table_oid_.fetch_add(1);
 
+    // Construct the table heap
+    auto table = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, txn, table_oid);
+
     // Construct the table information
     auto meta = std::make_unique<TableInfo>(schema, table_name, std::move(table), table_oid);
     auto *tmp = meta.get();
@@ -212,51 +213,34 @@ class Catalog {
   IndexInfo *CreateIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
                          const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
                          std::size_t keysize, HashFunction<KeyType> hash_function) {
-    // Reject the creation request for nonexistent table
-    if (table_names_.find(table_name) == table_names_.end()) {
-      return NULL_INDEX_INFO;
-    }
-
-    // If the table exists, an entry for the table should already be present in index_names_
-    BUSTUB_ASSERT((index_names_.find(table_name) != index_names_.end()), "Broken Invariant");
-
-    // Determine if the requested index already exists for this table
-    auto &table_indexes = index_names_.find(table_name)->second;
-    if (table_indexes.find(index_name) != table_indexes.end()) {
-      // The requested index already exists for this table
-      return NULL_INDEX_INFO;
-    }
-
-    // Construct index metdata
-    auto meta = std::make_unique<IndexMetadata>(index_name, table_name, &schema, key_attrs);
-
-    // Construct the index, take ownership of metadata
-    // TODO(Kyle): We should update the API for CreateIndex
-    // to allow specification of the index type itself, not
-    // just the key, value, and comparator types
-    auto index = std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_,
-                                                                                               hash_function);
-
-    // Populate the index with all tuples in table heap
-    auto *table_meta = GetTable(table_name);
-    auto *heap = table_meta->table_.get();
-    for (auto tuple = heap->Begin(txn); tuple != heap->End(); ++tuple) {
-      index->InsertEntry(tuple->KeyFromTuple(schema, key_schema, key_attrs), tuple->GetRid(), txn);
-    }
-
-    // Get the next OID for the new index
-    const auto index_oid = next_index_oid_.fetch_add(1);
-
-    // Construct index information; IndexInfo takes ownership of the Index itself
-    auto index_info =
-        std::make_unique<IndexInfo>(key_schema, index_name, std::move(index), index_oid, table_name, keysize);
-    auto *tmp = index_info.get();
-
-    // Update internal tracking
-    indexes_.emplace(index_oid, std::move(index_info));
-    table_indexes.emplace(index_name, index_oid);
+    return AddIndex(txn, index_name, table_name, schema, key_schema, key_attrs, keysize,
+                    [&](std::unique_ptr<IndexMetadata> &&meta) {
+                      return std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(
+                          std::move(meta), bpm_, hash_function);
+                    });
+  }
 
-    return tmp;
+  /**
+   * Create a new B+ tree index, populate existing data of the table and return its metadata. The index locks its keys
+   * in the lock manager of the catalog, so that SERIALIZABLE scans of it see no phantoms.
+   * @param txn The transaction in which the table is being created
+   * @param index_name The name of the new index
+   * @param table_name The name of the table
+   * @param schema The schema of the table
+   * @param key_schema The schema of the key
+   * @param key_attrs Key attributes
+   * @param keysize Size of the key
+   * @return A (non-owning) pointer to the metadata of the new table
+   */
+  template <class KeyType, class ValueType, class KeyComparator>
+  IndexInfo *CreateBPlusTreeIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
+                                  const Schema &schema, const Schema &key_schema,
+                                  const std::vector<uint32_t> &key_attrs, std::size_t keysize) {
+    return AddIndex(txn, index_name, table_name, schema, key_schema, key_attrs, keysize,
+                    [&](std::unique_ptr<IndexMetadata> &&meta) {
+                      return std::make_unique<BPlusTreeIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_,
+                                                                                                 lock_manager_);
+                    });
   }
 
   /**
@@ -346,6 +330,58 @@ class Catalog {
 
 
  private:
+  /**
+   * Create an index with make_index, populate existing data of the table and return its metadata, see CreateIndex().
+   * @param make_index Constructs the index from an owning pointer to its metadata
+   */
+  template <class MakeIndex>
+  IndexInfo *AddIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
+                      const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
+                      std::size_t keysize, MakeIndex make_index) {
+    // Reject the creation request for nonexistent table
+    if (table_names_.find(table_name) == table_names_.end()) {
+      return NULL_INDEX_INFO;
+    }
+
+    // If the table exists, an entry for the table should already be present in index_names_
+    BUSTUB_ASSERT((index_names_.find(table_name) != index_names_.end()), "Broken Invariant");
+
+    // Determine if the requested index already exists for this table
+    auto &table_indexes = index_names_.find(table_name)->second;
+    if (table_indexes.find(index_name) != table_indexes.end()) {
+      // The requested index already exists for this table
+      return NULL_INDEX_INFO;
+    }
+
+    // Construct index metdata
+    auto meta = std::make_unique<IndexMetadata>(index_name, table_name, &schema, key_attrs);
+
+    // Construct the index, take ownership of metadata
+    auto index = make_index(std::move(meta));
+
+    // Populate the index with all tuples in table heap
+    auto *table_meta = GetTable(table_name);
+    auto *heap = table_meta->table_.get();
+    for (auto tuple = heap->Begin(txn); tuple != heap->End(); ++tuple) {
+      index->InsertEntry(tuple->KeyFromTuple(schema, key_schema, key_attrs), tuple->GetRid(), txn);
+    }
+
+    // Get the next OID for the new index
+    const auto index_oid = next_index_oid_.fetch_add(1);
+
+    // Construct index information; IndexInfo takes ownership of the Index itself
+    auto index_info =
+        std::make_unique<IndexInfo>(key_schema, index_name, std::move(index), index_oid, table_name, keysize);
+    auto *tmp = index_info.get();
+
+    // Update internal tracking
+    indexes_.emplace(index_oid, std::move(index_info));
+    table_indexes.emplace(index_name, index_oid);
+
+    return tmp;
+  }
+
+
   [[maybe_unused]] BufferPoolManager *bpm_;
   [[maybe_unused]] LockManager *lock_manager_;
   [[maybe_unused]] LogManager *log_manager_;
@@ -21,6 +21,9 @@ static constexpr uint32_t TEST_VARLEN_SIZE = 10;
 
 class TableGenerator {
  public:
+  /** Enumeration to characterize the distribution of values in a given column */
+  enum class Dist : uint8_t { Uniform, Zipf_50, Zipf_75, Zipf_95, Zipf_99, Serial, Cyclic };
+
   /**
    * Constructor
    */
@@ -31,9 +34,18 @@ class TableGenerator {
    */
   void GenerateTestTables();
 
+  /**
+   * Generate a sequence of keys, e.g. the rows a workload accesses. Under Zipf_<n> key i comes up with probability
+   * proportional to 1 / (i + 1)^0.<n>, so the low keys are hot.
+   * @param dist the distribution of the keys
+   * @param num_keys the keys are drawn from 0 to num_keys - 1
+   * @param count the number of keys to generate
+   * @param seed the seed of the random number generator
+   * @return the keys
+   */
+  static std::vector<uint64_t> GenerateKeys(Dist dist, uint64_t num_keys, uint32_t count, uint32_t seed = 0);
+
  private:
-  /** Enumeration to characterize the distribution of values in a given column */
-  enum class Dist : uint8_t { Uniform, Zipf_50, Zipf_75, Zipf_95, Zipf_99, Serial, Cyclic };
 
   /**
    * Metadata about the data for a given column. Specifically, the type of the
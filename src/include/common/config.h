@@ -0,0 +1,72 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// config.h
+//
+// Identification: src/include/common/config.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstddef>
+#include <cstdint>
+
+namespace bustub {
+
+/** Cycle detection is performed every CYCLE_DETECTION_INTERVAL milliseconds. */
+extern std::chrono::milliseconds cycle_detection_interval;
+
+/**
+ * A transaction that holds more than LOCK_ESCALATION_THRESHOLD row locks on one table locks the whole table instead,
+ * see LockManager. 0 turns escalation off.
+ */
+extern size_t lock_escalation_threshold;
+
+/** True if logging should be enabled, false otherwise. */
+extern std::atomic<bool> enable_logging;
+
+/** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
+extern std::chrono::duration<int64_t> log_timeout;
+
+/** The COMMIT record of an asynchronous commit is flushed to disk at most ASYNC_COMMIT_DELAY after the commit. */
+extern std::chrono::milliseconds async_commit_delay;
+
+/** Size of a log segment file, see DiskManager. A segment must hold at least one full log buffer. */
+extern int64_t log_segment_size;
+
+/**
+ * The page size is chosen at build time, e.g. cmake -DBUSTUB_PAGE_SIZE=16384 ..
+ * Every page layout derives its capacity from PAGE_SIZE, so changing it only requires a rebuild (and a fresh db file).
+ */
+#ifndef BUSTUB_PAGE_SIZE
+#define BUSTUB_PAGE_SIZE 4096
+#endif
+
+static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
+static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
+static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
+static constexpr int HEADER_PAGE_ID = 0;                                      // the header page id
+static constexpr int PAGE_SIZE = BUSTUB_PAGE_SIZE;                            // size of a data page in byte
+static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
+static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
+static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr uint64_t INVALID_TIMESTAMP = UINT64_MAX;                     // timestamp of an uncommitted write
+
+static_assert(PAGE_SIZE == 4096 || PAGE_SIZE == 8192 || PAGE_SIZE == 16384 || PAGE_SIZE == 32768,
+              "BUSTUB_PAGE_SIZE must be one of 4096, 8192, 16384 or 32768");
+
+using frame_id_t = int32_t;    // frame id type
+using page_id_t = int32_t;     // page id type
+using txn_id_t = int32_t;      // transaction id type
+using lsn_t = int32_t;         // log sequence number type
+using timestamp_t = uint64_t;  // commit timestamp type
+using slot_offset_t = size_t;  // slot offset type
+using oid_t = uint16_t;
+
+}  // namespace bustub
@@ -0,0 +1,118 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// epoch_latch.h
+//
+// Identification: src/include/common/epoch_latch.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * EpochLatch lets many threads run sections that one thread can wait to drain, like the read and write side of a
+ * ReaderWriterLatch, without a shared counter on the read side.
+ *
+ * A thread entering a section counts itself in the slot of its thread, a cache line of its own, and checks the epoch,
+ * which is odd while a thread quiesces. The quiescing thread makes the epoch odd first and then waits until the slots
+ * add up to zero: a section that entered before sees the even epoch and is counted, one that enters after sees the
+ * odd epoch and backs off until Resume(). A section may exit on another thread than it entered, only the sum of the
+ * slots matters.
+ */
+class EpochLatch {
+ public:
+  /** The number of slots, threads beyond that share them. */
+  static constexpr size_t NUM_SLOTS = 64;
+
+  EpochLatch() = default;
+  ~EpochLatch() = default;
+
+  DISALLOW_COPY(EpochLatch);
+
+  /**
+   * Enter a section, wait while a thread quiesces.
+   */
+  void Enter() {
+    std::atomic<int64_t> *active = &slots_[ThreadSlot()].active_;
+    while (true) {
+      active->fetch_add(1);
+      uint64_t epoch = epoch_.load();
+      if (epoch % 2 == 0) {
+        return;
+      }
+      active->fetch_sub(1);
+      std::unique_lock<std::mutex> latch(mutex_);
+      resumed_.wait(latch, [this, epoch] { return epoch_.load() != epoch; });
+    }
+  }
+
+  /**
+   * Exit a section, on any thread.
+   */
+  void Exit() { slots_[ThreadSlot()].active_.fetch_sub(1); }
+
+  /**
+   * Keep new sections from entering and wait until the running ones exited.
+   */
+  void Quiesce() {
+    {
+      std::unique_lock<std::mutex> latch(mutex_);
+      resumed_.wait(latch, [this] { return epoch_.load() % 2 == 0; });
+      epoch_.fetch_add(1);
+    }
+    while (NumActive() != 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  /**
+   * Let sections enter again.
+   */
+  void Resume() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    epoch_.fetch_add(1);
+    resumed_.notify_all();
+  }
+
+ private:
+  struct alignas(64) Slot {
+    std::atomic<int64_t> active_{0};
+  };
+
+  /** @return the slot of the calling thread, the threads take the slots round robin */
+  static size_t ThreadSlot() {
+    static std::atomic<size_t> next_slot{0};
+    thread_local size_t slot = next_slot.fetch_add(1) % NUM_SLOTS;
+    return slot;
+  }
+
+  int64_t NumActive() const {
+    int64_t active = 0;
+    for (const auto &slot : slots_) {
+      active += slot.active_.load();
+    }
+    return active;
+  }
+
+  std::array<Slot, NUM_SLOTS> slots_;
+  /** Odd while a thread quiesces, read by every Enter() but only written by Quiesce() and Resume(). */
+  alignas(64) std::atomic<uint64_t> epoch_{0};
+  std::mutex mutex_;
+  std::condition_variable resumed_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,186 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// key_range_lock.h
+//
+// Identification: src/include/concurrency/key_range_lock.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
+#include <optional>
+#include <vector>
+
+#include "concurrency/lock_manager.h"
+#include "concurrency/transaction.h"
+
+namespace bustub {
+
+/** The range locks of one index, without its key type, so that TransactionManager can release them. */
+class RangeLockTable {
+ public:
+  virtual ~RangeLockTable() = default;
+
+  /** Release every range lock of the transaction in this table. */
+  virtual void UnlockAll(Transaction *txn) = 0;
+
+  /** Wake the transactions waiting in this table, so that those the lock manager aborted see it. */
+  virtual void Wake() = 0;
+};
+
+/**
+ * KeyRangeLockTable locks intervals of the keys of an index, so that a SERIALIZABLE scan sees no phantoms: the scan
+ * locks the range it reads SHARED, a writer locks the key it inserts or deletes EXCLUSIVE, and they wait for each other
+ * only if the key falls into the range. Writers to other ranges go on.
+ *
+ * The locks are kept in a list per index and are checked against each other on every request, an index has few
+ * transactions scanning or writing it at a time. They follow the DeadlockPolicy of the lock manager. Under WOUND_WAIT
+ * an older transaction aborts the younger ones whose locks it conflicts with, and wakes them wherever they wait.
+ * Under DETECTION it waits, and the lock manager puts the wait into its waits-for graph, see
+ * LockManager::SetExternalWait(), so that it finds the cycles that run through range locks and row locks alike. Either
+ * way a transaction the lock manager aborts while it waits here is woken through Wake().
+ */
+template <typename KeyType, typename KeyComparator>
+class KeyRangeLockTable : public RangeLockTable {
+ public:
+  /**
+   * @param comparator the order of the keys
+   * @param lock_manager decides the deadlock policy, sees the waits, and wakes the transactions wounded here
+   */
+  KeyRangeLockTable(const KeyComparator &comparator, LockManager *lock_manager)
+      : comparator_(comparator), lock_manager_(lock_manager) {}
+
+  /**
+   * Lock the keys from low to high, both included.
+   * @param low the first key, nullptr for no lower bound
+   * @param high the last key, nullptr for no upper bound
+   * @param lock_mode SHARED or EXCLUSIVE
+   * @return false if the transaction is already aborted
+   * @throw TransactionAbortException if the transaction is shrinking or is aborted while it waits
+   */
+  bool LockRange(Transaction *txn, const KeyType *low, const KeyType *high, LockMode lock_mode) {
+    if (txn->GetState() == TransactionState::ABORTED) {
+      return false;
+    }
+    if (txn->GetState() == TransactionState::SHRINKING) {
+      txn->SetState(TransactionState::ABORTED);
+      lock_manager_->CountAbort(AbortReason::LOCK_ON_SHRINKING);
+      throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
+    }
+    RangeLock range{txn, lock_mode, Bound(low), Bound(high)};
+    bool wound = lock_manager_->GetDeadlockPolicy() == DeadlockPolicy::WOUND_WAIT;
+
+    std::unique_lock<std::mutex> lock(latch_);
+    std::optional<std::chrono::steady_clock::time_point> wait_start;
+    while (true) {
+      std::vector<txn_id_t> holders;
+      std::vector<txn_id_t> wounded;
+      for (const auto &other : locks_) {
+        if (other.txn_ == txn || (lock_mode == LockMode::SHARED && other.lock_mode_ == LockMode::SHARED) ||
+            !Overlap(range, other)) {
+          continue;
+        }
+        // the aborted release their locks when they abort, until then we wait for them like for anybody
+        holders.push_back(other.txn_->GetTransactionId());
+        TransactionState state = other.txn_->GetState();
+        if (wound && other.txn_->GetTransactionId() > txn->GetTransactionId() &&
+            state != TransactionState::ABORTED && state != TransactionState::COMMITTED) {
+          other.txn_->SetState(TransactionState::ABORTED);
+          wounded.push_back(other.txn_->GetTransactionId());
+        }
+      }
+      if (holders.empty()) {
+        break;
+      }
+      if (!wounded.empty()) {
+        lock_manager_->CountAbort(AbortReason::DEADLOCK, wounded.size());
+        released_.notify_all();
+        lock.unlock();
+        lock_manager_->WakeAborted(wounded);
+        lock.lock();
+        // the locks may have changed meanwhile
+        continue;
+      }
+      if (!wait_start.has_value()) {
+        wait_start = std::chrono::steady_clock::now();
+      }
+      // registered before the state check, a wake up from here on waits for latch_ until we sleep
+      lock_manager_->SetExternalWait(txn, this, std::move(holders));
+      if (txn->GetState() != TransactionState::ABORTED) {
+        released_.wait(lock);
+      }
+      if (txn->GetState() == TransactionState::ABORTED) {
+        lock_manager_->EndExternalWait(txn, MicrosSince(*wait_start));
+        throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+      }
+    }
+    if (wait_start.has_value()) {
+      lock_manager_->EndExternalWait(txn, MicrosSince(*wait_start));
+    }
+    locks_.push_back(range);
+    txn->GetRangeLockSet()->insert(this);
+    return true;
+  }
+
+  /** Lock a single key, see LockRange(). */
+  bool LockKey(Transaction *txn, const KeyType &key, LockMode lock_mode) {
+    return LockRange(txn, &key, &key, lock_mode);
+  }
+
+  void UnlockAll(Transaction *txn) override {
+    std::scoped_lock lock(latch_);
+    locks_.erase(std::remove_if(locks_.begin(), locks_.end(), [txn](const auto &range) { return range.txn_ == txn; }),
+                 locks_.end());
+    released_.notify_all();
+  }
+
+  void Wake() override {
+    std::scoped_lock lock(latch_);
+    released_.notify_all();
+  }
+
+  /** @return the number of range locks held, for tests */
+  size_t GetNumLocks() {
+    std::scoped_lock lock(latch_);
+    return locks_.size();
+  }
+
+ private:
+  struct RangeLock {
+    Transaction *txn_;
+    LockMode lock_mode_;
+    /** Both included, no value for an open end. */
+    std::optional<KeyType> low_;
+    std::optional<KeyType> high_;
+  };
+
+  static uint64_t MicrosSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  static std::optional<KeyType> Bound(const KeyType *key) {
+    return key == nullptr ? std::nullopt : std::optional<KeyType>(*key);
+  }
+
+  bool Overlap(const RangeLock &a, const RangeLock &b) const {
+    // a ends before b starts, or b ends before a starts
+    return !(a.high_.has_value() && b.low_.has_value() && comparator_(*a.high_, *b.low_) < 0) &&
+           !(b.high_.has_value() && a.low_.has_value() && comparator_(*b.high_, *a.low_) < 0);
+  }
+
+  KeyComparator comparator_;
+  LockManager *lock_manager_;
+  std::mutex latch_;
+  std::condition_variable released_;
+  std::vector<RangeLock> locks_;
+};
+
+}  // namespace bustub
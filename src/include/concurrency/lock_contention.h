@@ -0,0 +1,161 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lock_contention.h
+//
+// Identification: src/include/concurrency/lock_contention.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "concurrency/transaction.h"
+
+namespace bustub {
+
+/**
+ * HeavyHitters finds the most frequent keys of a stream in a fixed number of counters (the Space-Saving algorithm of
+ * Metwally et al.). A key that is not counted yet takes over the smallest counter and adds to its count, so a count
+ * may be too high by at most the smallest count, but every key more frequent than that is counted.
+ */
+template <typename Key>
+class HeavyHitters {
+ public:
+  explicit HeavyHitters(size_t capacity) : capacity_(capacity) { counters_.reserve(capacity); }
+
+  void Add(const Key &key, uint64_t count = 1) {
+    auto counter = std::find_if(counters_.begin(), counters_.end(), [&key](const auto &c) { return c.first == key; });
+    if (counter != counters_.end()) {
+      counter->second += count;
+    } else if (counters_.size() < capacity_) {
+      counters_.emplace_back(key, count);
+    } else {
+      counter = std::min_element(counters_.begin(), counters_.end(),
+                                 [](const auto &a, const auto &b) { return a.second < b.second; });
+      *counter = {key, counter->second + count};
+    }
+  }
+
+  /** @return the counted keys and their counts, in no particular order */
+  const std::vector<std::pair<Key, uint64_t>> &GetCounters() const { return counters_; }
+
+  void Clear() { counters_.clear(); }
+
+ private:
+  size_t capacity_;
+  std::vector<std::pair<Key, uint64_t>> counters_;
+};
+
+/**
+ * Counts values in power of two buckets: bucket 0 holds 0, bucket i > 0 holds [2^(i-1), 2^i), the last one the rest.
+ */
+template <size_t NumBuckets>
+class Log2Histogram {
+ public:
+  void Add(uint64_t value) {
+    size_t bucket = 0;
+    while (value != 0 && bucket + 1 < NumBuckets) {
+      value >>= 1;
+      bucket++;
+    }
+    buckets_[bucket]++;
+  }
+
+  /** Add the buckets to a histogram with the same number of them. */
+  void AddTo(std::vector<uint64_t> *buckets) const {
+    buckets->resize(NumBuckets);
+    for (size_t i = 0; i < NumBuckets; i++) {
+      (*buckets)[i] += buckets_[i];
+    }
+  }
+
+  void Clear() { buckets_.fill(0); }
+
+ private:
+  std::array<uint64_t, NumBuckets> buckets_{};
+};
+
+/**
+ * The contention a part of the lock table saw. Not thread safe, the lock manager keeps one per lock table shard under
+ * the shard latch, which it holds anyway when it records something.
+ */
+class LockContention {
+ public:
+  /** The number of counters each shard keeps for the hot rows and for the hot tables. */
+  static constexpr size_t SKETCH_SIZE = 16;
+  static constexpr size_t WAIT_BUCKETS = 32;
+  static constexpr size_t QUEUE_LENGTH_BUCKETS = 16;
+
+  /** A request joined a queue with ahead requests before it. */
+  void RecordRequest(size_t ahead) {
+    num_requests_++;
+    queue_lengths_.Add(ahead);
+  }
+
+  /**
+   * A request had to wait.
+   * @param rid the row it waits for, nullptr if it waits for a table lock
+   * @param oid the table of the row or the locked table, INVALID_TABLE_OID if unknown
+   */
+  void RecordWait(const RID *rid, table_oid_t oid) {
+    num_waits_++;
+    if (rid != nullptr) {
+      hot_rows_.Add(*rid);
+    }
+    if (oid != INVALID_TABLE_OID) {
+      hot_tables_.Add(oid);
+    }
+  }
+
+  /** A wait ended after wait_us microseconds, with the grant or an abort. */
+  void RecordWaitTime(uint64_t wait_us) {
+    total_wait_us_ += wait_us;
+    wait_times_.Add(wait_us);
+  }
+
+  void Clear() { *this = LockContention(); }
+
+  uint64_t num_requests_{0};
+  uint64_t num_waits_{0};
+  uint64_t total_wait_us_{0};
+  Log2Histogram<WAIT_BUCKETS> wait_times_;
+  Log2Histogram<QUEUE_LENGTH_BUCKETS> queue_lengths_;
+  HeavyHitters<RID> hot_rows_{SKETCH_SIZE};
+  HeavyHitters<table_oid_t> hot_tables_{SKETCH_SIZE};
+};
+
+/** A copy of the contention counters of a lock manager, see LockManager::GetContentionSnapshot(). */
+struct LockContentionSnapshot {
+  /** Lock requests that joined a queue, row and table locks. */
+  uint64_t num_requests_{0};
+  /** Requests that could not be granted right away. */
+  uint64_t num_waits_{0};
+  uint64_t total_wait_us_{0};
+  /** Waits by their duration in microseconds, in Log2Histogram buckets. */
+  std::vector<uint64_t> wait_us_histogram_;
+  /** Requests by the number of requests they found in the queue, in Log2Histogram buckets. */
+  std::vector<uint64_t> queue_length_histogram_;
+  /** The rows with the most waits, most first. The counts are upper bounds, see HeavyHitters. */
+  std::vector<std::pair<RID, uint64_t>> hot_rows_;
+  /** The same for tables, a wait for a row counts for its table too. */
+  std::vector<std::pair<table_oid_t, uint64_t>> hot_tables_;
+  /** The transactions the lock manager aborted, by reason. */
+  std::map<AbortReason, uint64_t> aborts_;
+
+  /** @return the snapshot in a human readable form, one counter per line */
+  std::string ToString() const;
+};
+
+}  // namespace bustub
@@ -13,20 +13,26 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>  // NOLINT
-#include <list>
+#include <cstddef>
+#include <iterator>
+#include <map>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "common/config.h"
 #include "common/rid.h"
+#include "concurrency/lock_contention.h"
 #include "concurrency/transaction.h"
 
 namespace bustub {
 
+class RangeLockTable;
 class TransactionManager;
 
 //Уʹlock tablelock tableԪIDΪΪֵĹϣ
@@ -34,44 +40,183 @@ class TransactionManager;
 
 
 
-class LockManager {
-  enum class LockMode { SHARED, EXCLUSIVE };
+/** How the lock manager deals with deadlocks. */
+enum class DeadlockPolicy {
+  /** An older transaction aborts the younger ones in its way, so no deadlock can form. */
+  WOUND_WAIT,
+  /** Transactions wait for each other, a background thread aborts the youngest transaction of each cycle. */
+  DETECTION
+};
 
+class LockManager {
 
 ////УбԪIDԪ͡ԼǷɣͨеķʽ֤Ⱥ˳
+  /**
+   * A lock request, linked into the queue of its row or table. The nodes come from a pool in their shard and go back
+   * to it when the request is dropped, so taking a lock does not allocate one.
+   */
   class LockRequest {
    public:
-    LockRequest(txn_id_t txn_id, LockMode lock_mode) : txn_id_(txn_id), lock_mode_(lock_mode), granted_(false) {}
+    void Init(Transaction *txn, LockMode lock_mode) {
+      txn_ = txn;
+      txn_id_ = txn->GetTransactionId();
+      lock_mode_ = lock_mode;
+      granted_ = false;
+    }
+
+    /** The requesting transaction, it releases all its locks before it goes away. */
+    Transaction *txn_{nullptr};
 
     txn_id_t txn_id_;     //ԪID
     LockMode lock_mode_;    //Ԫ
     bool granted_;    //Ƿ
+
+    /**
+     * The requesting transaction sleeps here while it waits. Whoever changes the queue wakes only the requests that
+     * can be granted now, and a wound wakes the request of the wounded transaction.
+     */
+    std::condition_variable cv_;
+
+    /** The neighbours in the queue, next_ also links the free requests of the pool. */
+    LockRequest *prev_{nullptr};
+    LockRequest *next_{nullptr};
   };
 
+  /** A FIFO list of requests, linked through the requests themselves. */
+  class RequestList {
+   public:
+    class Iterator {
+     public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = LockRequest;
+      using difference_type = std::ptrdiff_t;
+      using pointer = LockRequest *;
+      using reference = LockRequest &;
+
+      explicit Iterator(LockRequest *request) : request_(request) {}
+      LockRequest &operator*() const { return *request_; }
+      LockRequest *operator->() const { return request_; }
+      Iterator &operator++() {
+        request_ = request_->next_;
+        return *this;
+      }
+      bool operator==(const Iterator &other) const { return request_ == other.request_; }
+      bool operator!=(const Iterator &other) const { return request_ != other.request_; }
+
+     private:
+      LockRequest *request_;
+    };
+
+    Iterator begin() const { return Iterator(head_); }  // NOLINT
+    Iterator end() const { return Iterator(nullptr); }  // NOLINT
+    bool empty() const { return head_ == nullptr; }     // NOLINT
+    size_t Size() const { return size_; }
+
+    /** @return the oldest request, nullptr if there is none */
+    LockRequest *Front() const { return head_; }
+
+    void PushBack(LockRequest *request) {
+      request->prev_ = tail_;
+      request->next_ = nullptr;
+      (tail_ != nullptr ? tail_->next_ : head_) = request;
+      tail_ = request;
+      size_++;
+    }
+
+    void Remove(LockRequest *request) {
+      (request->prev_ != nullptr ? request->prev_->next_ : head_) = request->next_;
+      (request->next_ != nullptr ? request->next_->prev_ : tail_) = request->prev_;
+      request->prev_ = request->next_ = nullptr;
+      size_--;
+    }
+
+    /** @return the request of the transaction, nullptr if it has none here */
+    LockRequest *Find(Transaction *txn) const {
+      for (LockRequest *request = head_; request != nullptr; request = request->next_) {
+        if (request->txn_ == txn) {
+          return request;
+        }
+      }
+      return nullptr;
+    }
+
+   private:
+    LockRequest *head_{nullptr};
+    LockRequest *tail_{nullptr};
+    size_t size_{0};
+  };
 
   class LockRequestQueue {
    public:
-    std::list<LockRequest> request_queue_;    // ͨеķʽ֤Ⱥ˳ 
-
-
-    // for notifying blocked transactions on this rid  ֪ͨridϱ
-    std::condition_variable cv_;        // c++õ ҪǶ (wait)
-
+    RequestList request_queue_;    // ͨеķʽ֤Ⱥ˳ 
 
     // txn_id of an upgrading transaction (if any)
     txn_id_t upgrading_ = INVALID_TXN_ID;
+    /** The mode the upgrading transaction waits for. */
+    LockMode upgrading_mode_ = LockMode::EXCLUSIVE;
+  };
+
+  /**
+   * A part of the lock table with its own latch. Every RID belongs to one shard, chosen by its hash, and every table
+   * to one chosen by its oid.
+   */
+  struct LockTableShard {
+    std::mutex latch_;
+    /** Lock table for lock requests, a queue is dropped when its last request is. */
+    std::unordered_map<RID, LockRequestQueue> lock_table_;
+    /** The same for table locks. */
+    std::unordered_map<table_oid_t, LockRequestQueue> table_lock_table_;
+
+    /** Take a request from the pool, it only grows when all its requests are in use. */
+    LockRequest *NewRequest(Transaction *txn, LockMode lock_mode) {
+      LockRequest *request = free_requests_;
+      if (request != nullptr) {
+        free_requests_ = request->next_;
+      } else {
+        request = requests_.emplace_back(std::make_unique<LockRequest>()).get();
+      }
+      request->Init(txn, lock_mode);
+      return request;
+    }
+
+    /** Put a request that left its queue back into the pool. */
+    void FreeRequest(LockRequest *request) {
+      request->txn_ = nullptr;
+      request->next_ = free_requests_;
+      free_requests_ = request;
+    }
+
+    /** Every request of the shard, in a queue or free. */
+    std::vector<std::unique_ptr<LockRequest>> requests_;
+    LockRequest *free_requests_{nullptr};
+
+    /** What the queues of the shard saw, see GetContentionSnapshot(). */
+    LockContention contention_;
+
+    /**
+     * The largest COMMIT LSN of a transaction that released a lock of the shard it could write under, EXCLUSIVE,
+     * SHARED_INTENTION_EXCLUSIVE or INTENTION_EXCLUSIVE, which may have been before the record was persistent. A
+     * transaction granted a lock of the shard depends on it, see Transaction::GetCommitDependency(). Kept per shard
+     * rather than per queue, a queue goes away with its last request.
+     */
+    lsn_t released_commit_lsn_{INVALID_LSN};
   };
 
 
 
 
  public:
+  /** Default number of lock table shards. */
+  static constexpr size_t DEFAULT_NUM_SHARDS = 64;
+
   /**
-   * Creates a new lock manager configured for the deadlock prevention policy.
+   * Creates a new lock manager.
+   * @param num_shards the number of lock table shards, lock calls on RIDs of different shards do not contend
+   * @param policy the deadlock policy, DETECTION runs the cycle detection thread every cycle_detection_interval
    */
-  LockManager() = default;
+  explicit LockManager(size_t num_shards = DEFAULT_NUM_SHARDS, DeadlockPolicy policy = DeadlockPolicy::WOUND_WAIT);
 
-  ~LockManager() = default;
+  ~LockManager();
 
   /*
    * [LOCK_NOTE]: For all locking functions, we:
@@ -88,9 +233,13 @@ class LockManager {
    * Acquire a lock on RID in shared mode. See [LOCK_NOTE] in header file.
    * @param txn the transaction requesting the shared lock
    * @param rid the RID to be locked in shared mode
+   * @param oid the table of the row if known: a lock on it that covers the mode stands in for the row lock, and
+   * the row locks held until commit count toward escalating to it, see lock_escalation_threshold
+   * @param escalate false if the caller holds a page latch, escalating waits for the table lock and may abort the
+   * transaction. The caller escalates with EscalateIfDue() once it let go of the latch.
    * @return true if the lock is granted, false otherwise
    */
-  bool LockShared(Transaction *txn, const RID &rid);
+  bool LockShared(Transaction *txn, const RID &rid, table_oid_t oid = INVALID_TABLE_OID, bool escalate = true);
 
 
 
@@ -99,9 +248,11 @@ class LockManager {
    * Acquire a lock on RID in exclusive mode. See [LOCK_NOTE] in header file.
    * @param txn the transaction requesting the exclusive lock
    * @param rid the RID to be locked in exclusive mode
+   * @param oid the table of the row if known, see LockShared()
+   * @param escalate see LockShared()
    * @return true if the lock is granted, false otherwise
    */
-  bool LockExclusive(Transaction *txn, const RID &rid);
+  bool LockExclusive(Transaction *txn, const RID &rid, table_oid_t oid = INVALID_TABLE_OID, bool escalate = true);
 
 
 
@@ -111,9 +262,11 @@ class LockManager {
    * @param txn the transaction requesting the lock upgrade
    * @param rid the RID that should already be locked in shared mode by the
    * requesting transaction
+   * @param oid the table of the row if known, see LockShared()
+   * @param escalate see LockShared()
    * @return true if the upgrade is successful, false otherwise
    */
-  bool LockUpgrade(Transaction *txn, const RID &rid);
+  bool LockUpgrade(Transaction *txn, const RID &rid, table_oid_t oid = INVALID_TABLE_OID, bool escalate = true);
 
   
 
@@ -127,16 +280,248 @@ class LockManager {
    */
   bool Unlock(Transaction *txn, const RID &rid);
 
+  /**
+   * Acquire a lock on a table. See [LOCK_NOTE], except that a transaction which already holds a lock on the table
+   * gets it upgraded to the weakest mode that covers both, e.g. SHARED_INTENTION_EXCLUSIVE for SHARED and
+   * INTENTION_EXCLUSIVE. Row locks do not check for the intention lock on their table, taking it is up to the caller.
+   * @param txn the transaction requesting the table lock
+   * @param oid the table to be locked
+   * @param lock_mode the lock mode, READ_UNCOMMITTED transactions may not take the modes that include SHARED
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockTable(Transaction *txn, table_oid_t oid, LockMode lock_mode);
+
+  /**
+   * Release the table lock held by the transaction.
+   * @param txn the transaction releasing the lock
+   * @param oid the table that is locked by the transaction
+   * @return true if the unlock is successful, false otherwise
+   */
+  bool UnlockTable(Transaction *txn, table_oid_t oid);
+
+  /**
+   * Check if a transaction other than txn holds a lock that lets it write a row, the exclusive lock on the row or on
+   * its table. Optimistic transactions validate their reads with this.
+   * @param txn the asking transaction, its own locks do not count
+   * @param rid the row
+   * @param oid the row's table, INVALID_TABLE_OID to only look at the row lock
+   * @return true if somebody else may be writing the row
+   */
+  bool IsWriteLocked(Transaction *txn, const RID &rid, table_oid_t oid = INVALID_TABLE_OID);
+
+  /** @return true if the transaction holds a lock on the table that grants everything lock_mode would */
+  static bool IsTableLocked(Transaction *txn, table_oid_t oid, LockMode lock_mode);
+
+  /** @return true if a lock in mode held grants everything a lock in mode wanted would */
+  static bool Covers(LockMode held, LockMode wanted);
+
+  /** @return true if locks in the two modes can be held on the same resource by different transactions */
+  static bool Compatible(LockMode a, LockMode b);
+
+  /**
+   * Replace the transaction's row locks on the table by a table lock if it holds too many, after row locks that were
+   * taken without escalating. No latch may be held.
+   * @throw TransactionAbortException if the transaction is wounded while it waits for the table lock
+   */
+  void EscalateIfDue(Transaction *txn, table_oid_t oid);
+
+  /** @return the number of times a transaction's row locks on a table were replaced by a table lock */
+  uint64_t GetNumEscalations() const { return num_escalations_; }
+
+  /*** Graph API, for DeadlockPolicy::DETECTION ***/
+
+  /**
+   * Adds an edge from t1 -> t2 to the waits-for graph.
+   * @param t1 the transaction that waits
+   * @param t2 the transaction that is waited for
+   */
+  void AddEdge(txn_id_t t1, txn_id_t t2);
+
+  /**
+   * Removes an edge from t1 -> t2 from the waits-for graph.
+   * @param t1 the transaction that waits
+   * @param t2 the transaction that is waited for
+   */
+  void RemoveEdge(txn_id_t t1, txn_id_t t2);
+
+  /**
+   * Checks if the graph has a cycle. The search starts at the lowest transaction id and visits the neighbors of each
+   * transaction in ascending order, so the result is deterministic.
+   * @param[out] txn_id if the graph has a cycle, the youngest transaction in it
+   * @return true if the graph has a cycle
+   */
+  bool HasCycle(txn_id_t *txn_id);
+
+  /** @return the list of all edges in the current graph */
+  std::vector<std::pair<txn_id_t, txn_id_t>> GetEdgeList();
+
+  /**
+   * Builds the waits-for graph from the lock table and aborts the youngest transaction of every cycle in it, until
+   * there is none. Runs every cycle_detection_interval on the cycle detection thread.
+   */
+  void RunCycleDetection();
+
+  /** @return the number of transactions aborted by cycle detection */
+  uint64_t GetNumDeadlockAborts() const { return num_deadlock_aborts_; }
+
+  /**
+   * Wake up the aborted transactions wherever they wait, so they see that they are aborted. Takes shard latches, also
+   * used by the lock tables of the indexes when they wound a transaction, see KeyRangeLockTable.
+   */
+  void WakeAborted(const std::vector<txn_id_t> &aborted);
+
+  /** @return how deadlocks are dealt with, the lock tables of the indexes follow it too */
+  DeadlockPolicy GetDeadlockPolicy() const { return policy_; }
+
+  /*** Waits outside of the lock table, for the key range locks of the indexes ***/
+
+  /**
+   * Note that a transaction waits for a range lock of table behind the holders, or update the holders it waits for.
+   * Cycle detection sees the edges to them, and WakeAborted() wakes the transaction through RangeLockTable::Wake().
+   * The first call of a wait counts it in the contention profile. Caller holds the latch table waits under, so a wake
+   * up cannot slip in before the wait.
+   */
+  void SetExternalWait(Transaction *txn, RangeLockTable *table, std::vector<txn_id_t> holders);
+
+  /**
+   * The wait noted with SetExternalWait() is over.
+   * @param wait_us how long it took, for the contention profile
+   */
+  void EndExternalWait(Transaction *txn, uint64_t wait_us);
+
+  /** Count transactions aborted by the lock manager or by the lock tables of the indexes. */
+  void CountAbort(AbortReason reason, uint64_t count = 1);
+
+  /*** Contention profile ***/
+
+  /** The number of hot rows and tables a snapshot reports by default. */
+  static constexpr size_t DEFAULT_TOP_K = 10;
+
+  /**
+   * Copy the contention counters: the wait times and queue lengths of the lock requests, the rows and tables with the
+   * most waits, and the aborts by reason. The counters are always on, each shard keeps its own under its latch, and
+   * the snapshot takes the shard latches one at a time, so it can be taken while transactions run.
+   * @param top_k the number of hot rows and tables to report
+   */
+  LockContentionSnapshot GetContentionSnapshot(size_t top_k = DEFAULT_TOP_K);
+
+  /** Zero the contention counters, e.g. to profile one phase of a workload. */
+  void ResetContention();
+
 
 
 
  private:
-  std::mutex latch_;
+  LockTableShard *GetShard(const RID &rid) { return shards_[std::hash<RID>()(rid) % shards_.size()].get(); }
+  LockTableShard *GetTableShard(table_oid_t oid) { return shards_[oid % shards_.size()].get(); }
 
-  /** Lock table for lock requests. */
-  std::unordered_map<RID, LockRequestQueue> lock_table_;   //Уʹlock_tablelock_tableԪIDΪΪֵĹϣ
+  /**
+   * Check the state of a transaction before it takes a lock.
+   * @return false if it is aborted already
+   * @throw TransactionAbortException if it may not take the lock
+   */
+  bool CheckCanLock(Transaction *txn, LockMode lock_mode);
 
-  std::unordered_map<txn_id_t, Transaction *> txn_table_;
+  /** Put a new request at the end of the queue. Caller must hold the latch of the queue's shard. */
+  static LockRequest *Enqueue(LockTableShard *shard, LockRequestQueue *queue, Transaction *txn, LockMode lock_mode);
+
+  /**
+   * Note a granted row lock that is held until commit, and escalate once the transaction holds too many in the table
+   * if escalate is set. No shard latch may be held, escalating waits for the table lock.
+   */
+  void CountRowLock(Transaction *txn, const RID &rid, table_oid_t oid, LockMode lock_mode, bool escalate);
+
+  /** Replace the transaction's row locks on the table by one table lock in the strongest mode among them. */
+  void Escalate(Transaction *txn, table_oid_t oid);
+
+  /**
+   * Wound-wait: abort the younger transactions whose requests before the given one conflict with it, an older
+   * transaction never waits for a younger one. Caller must hold the latch of the queue's shard.
+   * @param[out] wounded the aborted transactions, they may be waiting in other shards, see WakeAborted()
+   */
+  void WoundYounger(LockRequestQueue *queue, LockRequest *request, std::vector<txn_id_t> *wounded);
+
+  /**
+   * Replace the waits-for graph by one built from a snapshot of the lock table, taken with all shard latches held.
+   * @param[out] waiters the waiting transactions
+   */
+  void BuildWaitsForGraph(std::unordered_map<txn_id_t, Transaction *> *waiters);
+
+  /** @return true if the request is compatible with all requests before it, ignoring those of aborted transactions */
+  static bool CanGrant(LockRequestQueue *queue, LockRequest *request);
+
+  /** @return true if the granted request can change to lock_mode, the requests still waiting do not matter */
+  static bool CanUpgrade(LockRequestQueue *queue, LockRequest *request, LockMode lock_mode);
+
+  /**
+   * Wake the waiting requests of the queue that can be granted now, and the upgrading one if it can go on. Called
+   * under the shard latch whenever a request leaves the queue or a transaction in it aborts.
+   */
+  static void WakeGrantable(LockRequestQueue *queue);
+
+  /**
+   * Drop the request of the transaction from the queue of key, and the queue with it if it was the last one. Caller
+   * must hold the shard latch.
+   * @return false if the transaction has no request there
+   */
+  template <typename Key>
+  static bool EraseRequest(LockTableShard *shard, std::unordered_map<Key, LockRequestQueue> *lock_table,
+                           const Key &key, Transaction *txn);
+
+  /**
+   * Block until CanGrant() holds for the request.
+   * @param rid the locked row, nullptr for a table lock, only for the contention profile
+   * @param oid the table of the row or the locked table, only for the contention profile
+   * @throw TransactionAbortException if the transaction is wounded while it waits
+   */
+  void WaitForGrant(LockTableShard *shard, LockRequestQueue *queue, LockRequest *request, const RID *rid,
+                    table_oid_t oid, std::unique_lock<std::mutex> *lock);
+
+  /**
+   * Upgrade a granted request once the other holders allow it, the requests still waiting do not matter.
+   * @throw TransactionAbortException if another upgrade is pending or the transaction is wounded while it waits
+   */
+  void UpgradeRequest(LockTableShard *shard, LockRequestQueue *queue, LockRequest *request, LockMode lock_mode,
+                      const RID *rid, table_oid_t oid, std::unique_lock<std::mutex> *lock);
+
+  /**
+   * Wait on the request once, lock holds the latch of its shard.
+   * @return false if the transaction is wounded
+   */
+  bool WaitOnRequest(LockTableShard *shard, LockRequest *request, std::unique_lock<std::mutex> *lock);
+
+  std::vector<std::unique_ptr<LockTableShard>> shards_;
+  std::atomic<uint64_t> num_escalations_{0};
+
+  DeadlockPolicy policy_;
+  std::atomic<bool> enable_cycle_detection_{false};
+  std::thread *cycle_detection_thread_{nullptr};
+  /** Waits-for graph representation, only used by cycle detection. */
+  std::unordered_map<txn_id_t, std::vector<txn_id_t>> waits_for_;
+  std::mutex waits_for_latch_;
+  std::atomic<uint64_t> num_deadlock_aborts_{0};
+
+  /** Protects aborts_, taken last, after a shard latch. */
+  std::mutex aborts_latch_;
+  std::map<AbortReason, uint64_t> aborts_;
+
+  /** A transaction that waits for a range lock of an index, see SetExternalWait(). */
+  struct ExternalWait {
+    Transaction *txn_;
+    RangeLockTable *table_;
+    std::vector<txn_id_t> holders_;
+  };
+
+  /** Protects waiting_for_, external_waits_ and external_contention_, taken after a shard latch, if at all. */
+  std::mutex waiting_latch_;
+  /**
+   * The request each blocked transaction waits on and its shard, only touched when a lock call has to wait. A request
+   * stays in its queue while its waiter is registered here.
+   */
+  std::unordered_map<txn_id_t, std::pair<LockTableShard *, LockRequest *>> waiting_for_;
+  std::unordered_map<txn_id_t, ExternalWait> external_waits_;
+  /** The waits for range locks, they belong to no shard. */
+  LockContention external_contention_;
 };
 
 }  // namespace bustub
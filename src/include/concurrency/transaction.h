@@ -12,12 +12,15 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <deque>
 #include <memory>
 #include <string>
 #include <thread>  // NOLINT
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "common/config.h"
 #include "common/logger.h"
@@ -44,9 +47,30 @@ namespace bustub {
 enum class TransactionState { GROWING, SHRINKING, COMMITTED, ABORTED };
 
 /**
- * Transaction isolation level.
+ * Transaction isolation level. SNAPSHOT reads every row as of the start of the transaction without locking it, see
+ * VersionStore. SERIALIZABLE locks like REPEATABLE_READ and also locks the key ranges it scans in an index, so that no
+ * rows appear in them, see KeyRangeLockTable.
  */
-enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED };
+enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED, SNAPSHOT, SERIALIZABLE };
+
+/**
+ * How a transaction keeps out of the way of the others. TWO_PHASE_LOCKING locks the rows it reads and writes as it
+ * goes. OPTIMISTIC reads without locks and buffers its updates and deletes, TransactionManager::Commit() validates its
+ * reads and installs its writes.
+ */
+enum class ConcurrencyControl { TWO_PHASE_LOCKING, OPTIMISTIC };
+
+/**
+ * Whether the writes of a transaction keep the versions they replace, decided at its first write, see
+ * VersionStore::KeepsVersions().
+ */
+enum class VersionMode { UNDECIDED, KEEP_VERSIONS, NO_VERSIONS };
+
+/**
+ * Lock modes. Rows are locked SHARED or EXCLUSIVE, tables in any mode. The intention modes on a table announce row
+ * locks of the same kind inside it, SHARED_INTENTION_EXCLUSIVE is SHARED and INTENTION_EXCLUSIVE at once.
+ */
+enum class LockMode { INTENTION_SHARED, INTENTION_EXCLUSIVE, SHARED, SHARED_INTENTION_EXCLUSIVE, EXCLUSIVE };
 
 /**
  * Type of write operation.
@@ -55,9 +79,14 @@ enum class WType { INSERT = 0, DELETE, UPDATE };
 
 class TableHeap;
 class Catalog;
+class VersionStore;
+class RangeLockTable;
 using table_oid_t = uint32_t;
 using index_oid_t = uint32_t;
 
+/** Stands for no table, e.g. for the rows of a table heap that is not in the catalog. */
+static constexpr table_oid_t INVALID_TABLE_OID = UINT32_MAX;
+
 /**
  * WriteRecord tracks information related to a write.
  */
@@ -74,6 +103,23 @@ class TableWriteRecord {
   TableHeap *table_;
 };
 
+/**
+ * TableReadRecord tracks a row an optimistic transaction read, and what it saw.
+ */
+class TableReadRecord {
+ public:
+  TableReadRecord(RID rid, bool exists, const Tuple &tuple, TableHeap *table)
+      : rid_(rid), exists_(exists), tuple_(tuple), table_(table) {}
+
+  RID rid_;
+  /** False if the transaction found no row. */
+  bool exists_;
+  /** The row as it was read. */
+  Tuple tuple_;
+  /** The table heap the row was read from. */
+  TableHeap *table_;
+};
+
 /**
  * WriteRecord tracks information related to a write.
  */
@@ -107,7 +153,8 @@ enum class AbortReason {
   UNLOCK_ON_SHRINKING,
   UPGRADE_CONFLICT,
   DEADLOCK,
-  LOCKSHARED_ON_READ_UNCOMMITTED
+  LOCKSHARED_ON_READ_UNCOMMITTED,
+  WRITE_CONFLICT
 };
 
 /**
@@ -137,6 +184,9 @@ class TransactionAbortException : public std::exception {
         return "Transaction " + std::to_string(txn_id_) + " aborted on deadlock\n";
       case AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED:
         return "Transaction " + std::to_string(txn_id_) + " aborted on lockshared on READ_UNCOMMITTED\n";
+      case AbortReason::WRITE_CONFLICT:
+        return "Transaction " + std::to_string(txn_id_) +
+               " aborted because a row it writes was changed after its snapshot was taken\n";
     }
     // Todo: Should fail with unreachable.
     return "";
@@ -155,10 +205,16 @@ class Transaction {
         txn_id_(txn_id),
         prev_lsn_(INVALID_LSN),
         shared_lock_set_{new std::unordered_set<RID>},
-        exclusive_lock_set_{new std::unordered_set<RID>} {
+        exclusive_lock_set_{new std::unordered_set<RID>},
+        table_lock_set_{new std::unordered_map<table_oid_t, LockMode>},
+        table_row_locks_{new std::unordered_map<table_oid_t, std::vector<RID>>},
+        range_lock_set_{new std::unordered_set<RangeLockTable *>},
+        commit_ts_{new std::atomic<timestamp_t>(INVALID_TIMESTAMP)} {
     // Initialize the sets that will be tracked.
     table_write_set_ = std::make_shared<std::deque<TableWriteRecord>>();
     index_write_set_ = std::make_shared<std::deque<IndexWriteRecord>>();
+    read_set_ = std::make_shared<std::unordered_map<RID, TableReadRecord>>();
+    buffered_write_set_ = std::make_shared<std::deque<TableWriteRecord>>();
     page_set_ = std::make_shared<std::deque<bustub::Page *>>();
     deleted_page_set_ = std::make_shared<std::unordered_set<page_id_t>>();
   }
@@ -176,12 +232,34 @@ class Transaction {
   /** @return the isolation level of this transaction */
   inline IsolationLevel GetIsolationLevel() const { return isolation_level_; }
 
+  /** @return true if the transaction holds its shared locks until it ends, under REPEATABLE_READ and SERIALIZABLE */
+  inline bool HoldsSharedLocks() const {
+    return isolation_level_ == IsolationLevel::REPEATABLE_READ || isolation_level_ == IsolationLevel::SERIALIZABLE;
+  }
+
+  /** @return the concurrency control of this transaction */
+  inline ConcurrencyControl GetConcurrencyControl() const { return concurrency_control_; }
+
+  /**
+   * Set the concurrency control, before the transaction reads or writes anything.
+   * @param concurrency_control the new concurrency control
+   */
+  inline void SetConcurrencyControl(ConcurrencyControl concurrency_control) {
+    concurrency_control_ = concurrency_control;
+  }
+
   /** @return the list of table write records of this transaction */
   inline std::shared_ptr<std::deque<TableWriteRecord>> GetWriteSet() { return table_write_set_; }
 
   /** @return the list of index write records of this transaction */
   inline std::shared_ptr<std::deque<IndexWriteRecord>> GetIndexWriteSet() { return index_write_set_; }
 
+  /** @return the rows an optimistic transaction read, by RID */
+  inline std::shared_ptr<std::unordered_map<RID, TableReadRecord>> GetReadSet() { return read_set_; }
+
+  /** @return the updates and deletes an optimistic transaction installs at commit, tuple_ is the new row */
+  inline std::shared_ptr<std::deque<TableWriteRecord>> GetBufferedWriteSet() { return buffered_write_set_; }
+
   /** @return the page set */
   inline std::shared_ptr<std::deque<Page *>> GetPageSet() { return page_set_; }
 
@@ -222,6 +300,17 @@ class Transaction {
   /** @return the set of resources under an exclusive lock */
   inline std::shared_ptr<std::unordered_set<RID>> GetExclusiveLockSet() { return exclusive_lock_set_; }
 
+  /** @return the locked tables and the mode each of them is locked in */
+  inline std::shared_ptr<std::unordered_map<table_oid_t, LockMode>> GetTableLockSet() { return table_lock_set_; }
+
+  /** @return the row locks held until commit, by table, LockManager escalates when a table has too many */
+  inline std::shared_ptr<std::unordered_map<table_oid_t, std::vector<RID>>> GetTableRowLocks() {
+    return table_row_locks_;
+  }
+
+  /** @return the index lock tables in which the transaction holds key range locks */
+  inline std::shared_ptr<std::unordered_set<RangeLockTable *>> GetRangeLockSet() { return range_lock_set_; }
+
   /** @return true if rid is shared locked by this transaction */
   bool IsSharedLocked(const RID &rid) { return shared_lock_set_->find(rid) != shared_lock_set_->end(); }
 
@@ -246,11 +335,61 @@ class Transaction {
    */
   inline void SetPrevLSN(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+  /** @return true if the commit of this transaction does not wait for its COMMIT record to be persistent */
+  inline bool IsAsyncCommit() const { return async_commit_; }
+
+  /**
+   * Commit asynchronously, see TransactionManager::Commit().
+   * @param async_commit true if the commit should not wait for the log
+   */
+  inline void SetAsyncCommit(bool async_commit) { async_commit_ = async_commit; }
+
+  /**
+   * @return the largest COMMIT LSN of the transactions whose writes this one may have seen before they were
+   * persistent, INVALID_LSN if there is none. Its own COMMIT record must not be persistent before theirs.
+   */
+  inline lsn_t GetCommitDependency() const { return commit_dependency_; }
+
+  /** Note that this transaction may have seen the writes of the transaction with the given COMMIT LSN. */
+  inline void AddCommitDependency(lsn_t commit_lsn) { commit_dependency_ = std::max(commit_dependency_, commit_lsn); }
+
+  /** @return the version store that keeps the versions this transaction replaces, nullptr if there is none */
+  inline VersionStore *GetVersionStore() { return version_store_; }
+
+  /**
+   * Set the version store, see TransactionManager::Begin().
+   * @param version_store the version store of the transaction manager
+   */
+  inline void SetVersionStore(VersionStore *version_store) { version_store_ = version_store; }
+
+  /** @return the timestamp of the last commit this transaction sees under SNAPSHOT isolation */
+  inline timestamp_t GetReadTs() const { return read_ts_; }
+
+  /**
+   * Set the snapshot of the transaction.
+   * @param read_ts the timestamp of the last commit it sees
+   */
+  inline void SetReadTs(timestamp_t read_ts) { read_ts_ = read_ts; }
+
+  /** @return the commit timestamp of this transaction, INVALID_TIMESTAMP until it commits */
+  inline std::shared_ptr<std::atomic<timestamp_t>> GetCommitTs() { return commit_ts_; }
+
+  /** @return whether the writes of this transaction keep the versions they replace */
+  inline VersionMode GetVersionMode() const { return version_mode_; }
+
+  /**
+   * Set whether the writes of this transaction keep the versions they replace, see VersionStore::KeepsVersions().
+   * @param version_mode the new version mode
+   */
+  inline void SetVersionMode(VersionMode version_mode) { version_mode_ = version_mode; }
+
  private:
-  /** The current transaction state. */
-  TransactionState state_;
+  /** The current transaction state, other transactions abort this one through it (see LockManager). */
+  std::atomic<TransactionState> state_;
   /** The isolation level of the transaction. */
   IsolationLevel isolation_level_;
+  /** The concurrency control of the transaction. */
+  ConcurrencyControl concurrency_control_{ConcurrencyControl::TWO_PHASE_LOCKING};
   /** The thread ID, used in single-threaded transactions. */
   std::thread::id thread_id_;
   /** The ID of this transaction. */
@@ -260,8 +399,16 @@ class Transaction {
   std::shared_ptr<std::deque<TableWriteRecord>> table_write_set_;
   /** The undo set of indexes. */
   std::shared_ptr<std::deque<IndexWriteRecord>> index_write_set_;
+  /** OCC: the rows read, validated at commit. */
+  std::shared_ptr<std::unordered_map<RID, TableReadRecord>> read_set_;
+  /** OCC: the updates and deletes, installed at commit. */
+  std::shared_ptr<std::deque<TableWriteRecord>> buffered_write_set_;
   /** The LSN of the last record written by the transaction. */
   lsn_t prev_lsn_;
+  /** True if the transaction commits asynchronously. */
+  bool async_commit_{false};
+  /** See GetCommitDependency(). */
+  lsn_t commit_dependency_{INVALID_LSN};
 
   /** Concurrent index: the pages that were latched during index operation. */
   std::shared_ptr<std::deque<Page *>> page_set_;
@@ -272,6 +419,21 @@ class Transaction {
   std::shared_ptr<std::unordered_set<RID>> shared_lock_set_;
   /** LockManager: the set of exclusive-locked tuples held by this transaction. */
   std::shared_ptr<std::unordered_set<RID>> exclusive_lock_set_;
+  /** LockManager: the tables locked by this transaction and their lock modes. */
+  std::shared_ptr<std::unordered_map<table_oid_t, LockMode>> table_lock_set_;
+  /** LockManager: the rows locked until commit in each table, they may have been unlocked since. */
+  std::shared_ptr<std::unordered_map<table_oid_t, std::vector<RID>>> table_row_locks_;
+  /** KeyRangeLockTable: the index lock tables with range locks of this transaction. */
+  std::shared_ptr<std::unordered_set<RangeLockTable *>> range_lock_set_;
+
+  /** VersionStore: the store of the transaction manager, nullptr for transactions it did not begin. */
+  VersionStore *version_store_{nullptr};
+  /** VersionStore: the snapshot of the transaction. */
+  timestamp_t read_ts_{0};
+  /** VersionStore: the commit timestamp, shared with the versions the transaction replaced so they outlive it. */
+  std::shared_ptr<std::atomic<timestamp_t>> commit_ts_;
+  /** VersionStore: whether the writes keep versions, only the thread of the transaction touches it. */
+  VersionMode version_mode_{VersionMode::UNDECIDED};
 };
 
 }  // namespace bustub
@@ -13,20 +13,27 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <condition_variable>  // NOLINT
 #include <list>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "common/config.h"
 #include "common/rid.h"
+#include "common/epoch_latch.h"
+#include "concurrency/key_range_lock.h"
+#include "concurrency/lock_manager.h"
 #include "concurrency/transaction.h"
+#include "concurrency/transaction_registry.h"
+#include "concurrency/version_store.h"
+#include "recovery/log_manager.h"
 
 namespace bustub {
-class LockManager;
 
 /**
  * TransactionManager keeps track of all the transactions running in the system.
@@ -42,15 +49,35 @@ class TransactionManager {
    * Begins a new transaction.
    * @param txn an optional transaction object to be initialized, otherwise a new transaction is created.
    * @param isolation_level an optional isolation level of the transaction.
+   * @param concurrency_control an optional concurrency control of the transaction.
    * @return an initialized transaction
    */
-  Transaction *Begin(Transaction *txn = nullptr, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ);
+  Transaction *Begin(Transaction *txn = nullptr, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ,
+                     ConcurrencyControl concurrency_control = ConcurrencyControl::TWO_PHASE_LOCKING);
 
   /**
-   * Commits a transaction.
+   * Commits a transaction. With logging enabled this returns once the COMMIT record is persistent, concurrent commits
+   * share a single log flush.
+   *
+   * An asynchronous commit returns as soon as the COMMIT record is in the log buffer, and the flush thread writes it
+   * within async_commit_delay. A crash before that loses the transaction: recovery finds no COMMIT record and rolls it
+   * back. A synchronous commit that may depend on such a transaction waits until its COMMIT record is persistent too,
+   * so recovery never keeps a transaction that read from one it rolls back.
+   *
+   * With early lock release, see SetEarlyLockRelease(), the locks are released as soon as the COMMIT record is in the
+   * log buffer, and the commit then waits for the flush without holding them. A transaction that gets a lock released
+   * that way may have read writes that are not durable yet, so its own commit waits until the COMMIT record of the
+   * releasing transaction is persistent, see Transaction::GetCommitDependency(). With one log partition that comes for
+   * free, the records are written in LSN order.
+   *
+   * An optimistic transaction first locks the rows it writes and checks that every row it read is still as it read
+   * it. If one is not, or it cannot get a lock, the transaction aborts instead. Otherwise it installs its buffered
+   * writes and commits like any other, so the locks are only held for the installation, and for the log flush without
+   * early lock release.
    * @param txn the transaction to commit
+   * @return false if the optimistic transaction failed validation and was aborted
    */
-  void Commit(Transaction *txn);
+  bool Commit(Transaction *txn);
 
   /**
    * Aborts a transaction
@@ -62,31 +89,56 @@ class TransactionManager {
    * Global list of running transactions
    */
 
-  /** The transaction map is a global list of all the running transactions in the system. */
-  static std::unordered_map<txn_id_t, Transaction *> txn_map;
-  static std::shared_mutex txn_map_mutex;
+  /** The transaction registry holds all the running transactions in the system, from Begin() to Commit() or Abort(). */
+  static TransactionRegistry txn_registry;
 
   /**
    * Locates and returns the transaction with the given transaction ID.
-   * @param txn_id the id of the transaction to be found, it must exist!
+   * @param txn_id the id of the transaction to be found, it must still be running!
    * @return the transaction with the given transaction id
    */
   static Transaction *GetTransaction(txn_id_t txn_id) {
-    TransactionManager::txn_map_mutex.lock_shared();
-    assert(TransactionManager::txn_map.find(txn_id) != TransactionManager::txn_map.end());
-    auto *res = TransactionManager::txn_map[txn_id];
+    auto *res = TransactionManager::txn_registry.Find(txn_id);
     assert(res != nullptr);
-    TransactionManager::txn_map_mutex.unlock_shared();
     return res;
   }
 
-  /** Prevents all transactions from performing operations, used for checkpointing. */
+  /**
+   * Collect the active transaction table for a fuzzy checkpoint. Transactions are only tracked while logging is
+   * enabled.
+   * @return every transaction that has not committed or aborted yet, with a lower bound of the LSN of its first record
+   */
+  std::vector<std::pair<txn_id_t, lsn_t>> GetActiveTransactionTable();
+
+  /**
+   * Commit every transaction asynchronously, not only those that asked for it with Transaction::SetAsyncCommit().
+   * @param async_commit true if commits should not wait for the log
+   */
+  void SetAsyncCommit(bool async_commit) { async_commit_ = async_commit; }
+
+  /**
+   * Release the locks of a committing transaction once its COMMIT record is appended, before it is persistent. Off by
+   * default.
+   * @param early_lock_release false to hold the locks until the commit is durable
+   */
+  void SetEarlyLockRelease(bool early_lock_release) { early_lock_release_ = early_lock_release; }
+
+  /** @return the store of the row versions that SNAPSHOT transactions read */
+  VersionStore *GetVersionStore() { return &version_store_; }
+
+  /** Keeps new transactions from beginning and waits until the running ones finished, used for checkpointing. */
   void BlockAllTransactions();
 
   /** Resumes all transactions, used for checkpointing. */
   void ResumeTransactions();
 
  private:
+  /**
+   * Lock the tables and rows an optimistic transaction writes and check its read set.
+   * @return true if the transaction may install its writes
+   */
+  bool Validate(Transaction *txn);
+
   /**
    * Releases all the locks held by the given transaction.
    * @param txn the transaction whose locks should be released
@@ -102,14 +154,65 @@ class TransactionManager {
     for (auto locked_rid : lock_set) {
       lock_manager_->Unlock(txn, locked_rid);
     }
+    // tables last, their intention locks cover the row locks
+    std::vector<table_oid_t> tables;
+    for (const auto &table_lock : *txn->GetTableLockSet()) {
+      tables.push_back(table_lock.first);
+    }
+    for (table_oid_t oid : tables) {
+      lock_manager_->UnlockTable(txn, oid);
+    }
+    for (RangeLockTable *range_locks : *txn->GetRangeLockSet()) {
+      range_locks->UnlockAll(txn);
+    }
+    txn->GetRangeLockSet()->clear();
   }
 
+  /** Drop a finished transaction from the active transaction table, once its COMMIT or ABORT record is logged. */
+  void RemoveActiveTransaction(txn_id_t txn_id);
+
+  /**
+   * Each thread takes TXN_ID_BATCH_SIZE ids from next_txn_id_ at a time and hands them out to the transactions it
+   * begins. The ids of the transactions of one thread still grow, but a transaction may get a smaller id than one
+   * another thread began before it. Wound-wait takes the id for the age of a transaction, so under
+   * DeadlockPolicy::WOUND_WAIT every transaction takes its id from next_txn_id_ on its own.
+   * @return a new transaction id
+   */
+  txn_id_t NextTxnId();
+
+  /** The number of transaction ids a thread takes at a time. */
+  static constexpr txn_id_t TXN_ID_BATCH_SIZE = 64;
+
+  /** Tells the transaction managers apart in the id batches of a thread, a batch is only good for one of them. */
+  static std::atomic<uint64_t> next_instance_id;
+  const uint64_t instance_id_{next_instance_id++};
+
   std::atomic<txn_id_t> next_txn_id_{0};
   LockManager *lock_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
+  std::atomic<bool> async_commit_{false};
+  std::atomic<bool> early_lock_release_{false};
+  /** The largest COMMIT LSN of a transaction that released its locks early, see Commit(). */
+  std::atomic<lsn_t> early_release_lsn_{INVALID_LSN};
+
+  /** Every transaction is a section from Begin() to Commit() or Abort(), see BlockAllTransactions(). */
+  EpochLatch txn_epoch_latch_;
+
+  /** A part of the active transaction table, spread by id like the TransactionRegistry, on a cache line of its own. */
+  struct alignas(64) ActiveTxnShard {
+    std::mutex latch_;
+    std::unordered_map<txn_id_t, lsn_t> first_lsns_;
+  };
+
+  ActiveTxnShard *GetActiveTxnShard(txn_id_t txn_id) {
+    return &active_txn_shards_[static_cast<size_t>(txn_id) % TransactionRegistry::NUM_SHARDS];
+  }
+
+  /** Running transactions and the next LSN when they began, see GetActiveTransactionTable(). */
+  std::array<ActiveTxnShard, TransactionRegistry::NUM_SHARDS> active_txn_shards_;
 
-  /** The global transaction latch is used for checkpointing. */
-  ReaderWriterLatch global_txn_latch_;
+  /** The old versions of the rows written by the transactions of this manager. */
+  VersionStore version_store_;
 };
 
 }  // namespace bustub
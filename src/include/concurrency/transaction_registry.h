@@ -0,0 +1,80 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// transaction_registry.h
+//
+// Identification: src/include/concurrency/transaction_registry.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <mutex>         // NOLINT
+#include <shared_mutex>  // NOLINT
+#include <unordered_map>
+
+#include "common/config.h"
+#include "concurrency/transaction.h"
+
+namespace bustub {
+
+/**
+ * TransactionRegistry maps the ids of the running transactions to the transactions. The ids are spread over shards
+ * with a latch each, so transactions that begin and end on different threads rarely meet on a latch.
+ */
+class TransactionRegistry {
+ public:
+  static constexpr size_t NUM_SHARDS = 64;
+
+  /** Register a transaction under its id, replacing whatever was registered under it. */
+  void Insert(Transaction *txn) {
+    Shard *shard = GetShard(txn->GetTransactionId());
+    std::unique_lock lock(shard->latch_);
+    shard->txns_[txn->GetTransactionId()] = txn;
+  }
+
+  /** Unregister a finished transaction, unless another one was registered under its id since. */
+  void Erase(Transaction *txn) {
+    Shard *shard = GetShard(txn->GetTransactionId());
+    std::unique_lock lock(shard->latch_);
+    auto iter = shard->txns_.find(txn->GetTransactionId());
+    if (iter != shard->txns_.end() && iter->second == txn) {
+      shard->txns_.erase(iter);
+    }
+  }
+
+  /** @return the transaction registered under the id, nullptr if there is none */
+  Transaction *Find(txn_id_t txn_id) {
+    Shard *shard = GetShard(txn_id);
+    std::shared_lock lock(shard->latch_);
+    auto iter = shard->txns_.find(txn_id);
+    return iter == shard->txns_.end() ? nullptr : iter->second;
+  }
+
+  /** @return the number of registered transactions */
+  size_t Size() {
+    size_t size = 0;
+    for (auto &shard : shards_) {
+      std::shared_lock lock(shard.latch_);
+      size += shard.txns_.size();
+    }
+    return size;
+  }
+
+ private:
+  /** A cache line of its own each, the latches of neighbouring shards do not share one. */
+  struct alignas(64) Shard {
+    std::shared_mutex latch_;
+    std::unordered_map<txn_id_t, Transaction *> txns_;
+  };
+
+  Shard *GetShard(txn_id_t txn_id) { return &shards_[static_cast<size_t>(txn_id) % NUM_SHARDS]; }
+
+  std::array<Shard, NUM_SHARDS> shards_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,173 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.h
+//
+// Identification: src/include/concurrency/version_store.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "concurrency/transaction.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * VersionStore keeps the old versions of the rows for SNAPSHOT transactions, which read without taking locks.
+ *
+ * The table pages always hold the newest version of a row. Before a transaction changes a row, the table heap hands
+ * the version it replaces to the store, where it goes on the version chain of the row. A version entry
+ * carries the commit timestamp of the write that replaced it. Every commit takes the next timestamp and a snapshot
+ * reads as of the last commit before it began, so a reader walks the chain back from the page over every write that
+ * committed after its snapshot or has not committed, and sees the version that write replaced.
+ *
+ * Versions are only kept while a snapshot may need them. A transaction that starts writing while no SNAPSHOT
+ * transaction runs keeps none and takes no commit timestamp, and a SNAPSHOT transaction that begins waits until such
+ * writers are done, so the pages hold nothing uncommitted that it has no version for.
+ *
+ * Writers still lock the rows they change, which serializes the writes of a row. A SNAPSHOT transaction that wants to
+ * change a row somebody changed after its snapshot was taken aborts (first committer wins).
+ *
+ * Versions that no running snapshot can see anymore are dropped when their row is written again and in a sweep every
+ * VERSION_GC_INTERVAL commits.
+ */
+class VersionStore {
+ public:
+  static constexpr size_t DEFAULT_NUM_SHARDS = 64;
+  static constexpr uint64_t VERSION_GC_INTERVAL = 1024;
+
+  /** @param num_shards the number of version chain partitions, rows are spread over them by hash */
+  explicit VersionStore(size_t num_shards = DEFAULT_NUM_SHARDS);
+
+  ~VersionStore() = default;
+
+  DISALLOW_COPY_AND_MOVE(VersionStore);
+
+  /**
+   * Take the snapshot of a beginning transaction, every transaction that committed so far is part of it. A SNAPSHOT
+   * transaction first waits for the transactions that write without keeping versions.
+   * @param txn the beginning transaction
+   */
+  void Begin(Transaction *txn);
+
+  /**
+   * Give a committing transaction the next commit timestamp, the snapshots taken from now on see its writes.
+   * @param txn the committing transaction, it still holds the locks on the rows it wrote
+   */
+  void Commit(Transaction *txn);
+
+  /**
+   * Forget the snapshot of an aborted transaction. RemoveVersions() takes its versions back after the rollback.
+   * @param txn the aborting transaction
+   */
+  void Abort(Transaction *txn);
+
+  /**
+   * Decide at the first write of a transaction whether its writes keep the versions they replace, they do if a
+   * snapshot runs. Call it before every write, with the page latch held at the latest.
+   * @param txn the writing transaction
+   * @return true if the write has to call AddVersion()
+   */
+  bool KeepsVersions(Transaction *txn);
+
+  /**
+   * Put the version of a row that a transaction is about to replace on the version chain of the row. The caller holds
+   * the page latch, so readers see the page and the chain change together.
+   * @param rid the written row
+   * @param txn the writing transaction
+   * @param old_tuple the replaced version, nullptr if the row did not exist before, i.e. the write is an insert
+   */
+  void AddVersion(const RID &rid, Transaction *txn, const Tuple *old_tuple);
+
+  /**
+   * Take back the versions a transaction added to a row, once it rolled back all its writes of the row. Until then
+   * the versions hide the rollback from the snapshots.
+   * @param rid the rolled back row
+   * @param txn the aborting transaction
+   */
+  void RemoveVersions(const RID &rid, Transaction *txn);
+
+  /**
+   * Find the version of a row that the snapshot of a transaction sees. The caller holds the page latch.
+   * @param rid the row to read
+   * @param txn the reading transaction
+   * @param[in,out] tuple the version on the page, replaced by the visible version
+   * @param exists true if there is a version on the page, false if the row is deleted or the slot empty
+   * @return true if the snapshot sees the row
+   */
+  bool GetVisibleVersion(const RID &rid, Transaction *txn, Tuple *tuple, bool exists);
+
+  /**
+   * Check if another transaction changed a row after the snapshot of txn was taken. The caller holds a lock that keeps
+   * other writers off the row.
+   * @return true if txn must not write the row
+   */
+  bool HasWriteConflict(const RID &rid, Transaction *txn);
+
+  /** Drop every version that no running snapshot can see anymore. */
+  void GarbageCollect();
+
+  /** @return the number of versions in the store */
+  size_t GetNumVersions();
+
+ private:
+  /** A version of a row, together with the write that replaced it. */
+  struct Version {
+    /** The replaced version of the row, if it existed. */
+    Tuple tuple_;
+    bool exists_;
+    /** The transaction that replaced it. */
+    txn_id_t writer_;
+    /** The commit timestamp of the writer, shared with the writer and its other versions. */
+    std::shared_ptr<std::atomic<timestamp_t>> commit_ts_;
+  };
+
+  /** A part of the version chains with its own latch. The chains are ordered oldest first. */
+  struct VersionShard {
+    std::mutex latch_;
+    std::unordered_map<RID, std::vector<Version>> chains_;
+  };
+
+  VersionShard *GetShard(const RID &rid) { return shards_[std::hash<RID>()(rid) % shards_.size()].get(); }
+
+  /** @return the oldest snapshot any running transaction reads, every version replaced before it can go */
+  timestamp_t GetWatermark();
+
+  /** Drop the versions of a chain that no snapshot at or after watermark sees. */
+  static void Prune(std::vector<Version> *chain, timestamp_t watermark);
+
+  /** A writer without versions is done, wake the beginning snapshots if it was the last one. */
+  void EndUnversionedWrites();
+
+  std::vector<std::unique_ptr<VersionShard>> shards_;
+
+  /** Guards the clock and the running snapshots, so a new snapshot sees either all or none of a commit. */
+  std::mutex ts_latch_;
+  /** The commit timestamp of the last commit. */
+  timestamp_t last_commit_ts_{0};
+  /** The snapshots of the running SNAPSHOT transactions. */
+  std::multiset<timestamp_t> active_snapshots_;
+  uint64_t num_commits_{0};
+  /** The running and beginning SNAPSHOT transactions, and the running transactions that write without versions. */
+  std::atomic<size_t> num_snapshots_{0};
+  std::atomic<size_t> num_unversioned_writers_{0};
+  /** Signalled under ts_latch_ when the last writer without versions is done. */
+  std::condition_variable unversioned_done_;
+};
+
+}  // namespace bustub
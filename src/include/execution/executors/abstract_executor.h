@@ -13,6 +13,7 @@
 #pragma once
 
 #include "execution/executor_context.h"
+#include "execution/plans/seq_scan_plan.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
@@ -78,6 +79,43 @@ class AbstractExecutor {
 
 
  protected:
+  /**
+   * Lock a table for the transaction of this executor, which may hold a lock that covers the mode already.
+   * @throw TransactionAbortException if the transaction is aborted
+   */
+  void LockTable(table_oid_t oid, LockMode lock_mode) {
+    Transaction *txn = exec_ctx_->GetTransaction();
+    // an optimistic transaction takes its table locks when it commits
+    if (txn->GetConcurrencyControl() == ConcurrencyControl::OPTIMISTIC) {
+      return;
+    }
+    if (!exec_ctx_->GetLockManager()->LockTable(txn, oid, lock_mode)) {
+      throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+    }
+  }
+
+  /**
+   * @return the table lock for a statement that writes the rows of table oid produced by child_plan. A sequential
+   * scan of that table reads every row, so the statement locks all of it: EXCLUSIVE if it writes every row, and
+   * under REPEATABLE_READ SHARED_INTENTION_EXCLUSIVE if a predicate picks them, which spares the scan its row locks.
+   * Otherwise only the written rows are locked, under INTENTION_EXCLUSIVE.
+   */
+  LockMode WriteLockMode(table_oid_t oid, const AbstractPlanNode *child_plan) {
+    if (child_plan->GetType() != PlanType::SeqScan) {
+      return LockMode::INTENTION_EXCLUSIVE;
+    }
+    const auto *scan_plan = static_cast<const SeqScanPlanNode *>(child_plan);
+    if (scan_plan->GetTableOid() != oid) {
+      return LockMode::INTENTION_EXCLUSIVE;
+    }
+    if (scan_plan->GetPredicate() == nullptr) {
+      return LockMode::EXCLUSIVE;
+    }
+    return exec_ctx_->GetTransaction()->HoldsSharedLocks()
+               ? LockMode::SHARED_INTENTION_EXCLUSIVE
+               : LockMode::INTENTION_EXCLUSIVE;
+  }
+
   /** The executor context in which the executor runs  ִгеִг   */
   ExecutorContext *exec_ctx_;
 
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <optional>
 #include <vector>
 
 #include "common/rid.h"
@@ -23,7 +24,9 @@
 namespace bustub {
 
 /**
- * IndexScanExecutor executes an index scan over a table.
+ * IndexScanExecutor executes an index scan over a table: it reads the rows of the table in the key order of the index.
+ * A SERIALIZABLE transaction locks the key range the predicate reads in the index, so that no row can be inserted into
+ * the scan. The range is open only where the predicate does not bound the key.
  */
 
 class IndexScanExecutor : public AbstractExecutor {
@@ -42,7 +45,22 @@ class IndexScanExecutor : public AbstractExecutor {
   bool Next(Tuple *tuple, RID *rid) override;
 
  private:
+  /**
+   * Derives the keys to scan from the predicate: a comparison of the key column of a single-column index with a
+   * constant bounds the scan, any other predicate leaves the range open.
+   */
+  void SetScanRange();
+
   /** The index scan plan node to be executed. */
   const IndexScanPlanNode *plan_;
+  /** The index to scan and the table of its rows. */
+  IndexInfo *index_info_{nullptr};
+  TableInfo *table_info_{nullptr};
+  /** The RIDs found in the index, in key order, and the next one to read. */
+  std::vector<RID> rids_;
+  size_t next_{0};
+  /** The first and last key to scan, both included, empty when the range is open at that end. */
+  std::optional<Tuple> low_key_;
+  std::optional<Tuple> high_key_;
 };
 }  // namespace bustub
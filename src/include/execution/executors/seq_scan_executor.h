@@ -67,6 +67,8 @@ class SeqScanExecutor : public AbstractExecutor {
   TableInfo *table_info_;
   TableIterator iter_;
   TableIterator end_;
+  /** True if the transaction holds a table lock that covers reading every row, the rows need no locks of their own. */
+  bool table_locked_{false};
 
 };
 }  // namespace bustub
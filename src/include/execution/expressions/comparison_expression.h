@@ -62,7 +62,8 @@ class ComparisonExpression : public AbstractExpression {
     return ValueFactory::GetBooleanValue(PerformComparison(lhs, rhs));
   }
 
-
+  /** @return the type of comparison performed */
+  ComparisonType GetComparisonType() const { return comp_type_; }
 
  private:
   CmpBool PerformComparison(const Value &lhs, const Value &rhs) const {
@@ -12,6 +12,10 @@
 
 #pragma once
 
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "recovery/log_manager.h"
@@ -19,7 +23,17 @@
 namespace bustub {
 
 /**
- * CheckpointManager creates consistent checkpoints by blocking all other transactions temporarily.
+ * CheckpointManager creates fuzzy checkpoints, transactions keep running while a checkpoint is taken.
+ *
+ * A checkpoint logs a BEGIN_CHECKPOINT record, followed by END_CHECKPOINT records that hold the active transaction
+ * table (ATT) and the dirty page table (DPT) as they were after BEGIN_CHECKPOINT. Once these are on disk, the master
+ * record is updated to point to them, and the pages of the DPT are written back by a background thread.
+ *
+ * Recovery only needs the log from the smallest LSN of the checkpoint: the first record of an active transaction, the
+ * recovery LSN of a dirty page or BEGIN_CHECKPOINT itself. The log is addressed by offsets, so every checkpoint
+ * remembers the end of the log together with the next LSN at that time, and later checkpoints let recovery start at
+ * the latest of these positions that lies before their smallest LSN. Once the master record points there, the log
+ * segments before that position are recycled.
  */
 class CheckpointManager {
  public:
@@ -29,15 +43,36 @@ class CheckpointManager {
         log_manager_(log_manager),
         buffer_pool_manager_(buffer_pool_manager) {}
 
-  ~CheckpointManager() = default;
+  /** Waits for the pages of the last checkpoint to be written. */
+  ~CheckpointManager();
 
+  /**
+   * Take a checkpoint without blocking transactions. Returns once the checkpoint is on disk, the dirty pages are
+   * written in the background.
+   */
   void BeginCheckpoint();
+
+  /** Wait until the dirty pages of the last checkpoint are written. */
   void EndCheckpoint();
 
  private:
-  TransactionManager *transaction_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /** A position in the log: every record with an LSN of at least lsn_ is stored behind offsets_. */
+  struct LogPosition {
+    lsn_t lsn_;
+    std::vector<int64_t> offsets_;
+  };
+
+  /** Write the pages of the dirty page table back to disk, on flush_thread_. */
+  void FlushDirtyPages(std::vector<std::pair<page_id_t, lsn_t>> dirty_page_table);
+
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+
+  /** Positions of the previous checkpoints in LSN order, where the redo of a later checkpoint may start. */
+  std::vector<LogPosition> log_positions_;
+  /** Writes the dirty pages of the last checkpoint. */
+  std::thread flush_thread_;
 };
 
 }  // namespace bustub
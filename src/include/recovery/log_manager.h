@@ -13,9 +13,13 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>  // NOLINT
 #include <condition_variable>  // NOLINT
 #include <future>              // NOLINT
-#include <mutex>               // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
@@ -25,50 +29,219 @@ namespace bustub {
 /**
  * LogManager maintains a separate thread that is awakened whenever the log buffer is full or whenever a timeout
  * happens. When the thread is awakened, the log buffer's content is written into the disk log file.
+ *
+ * The log is split into partitions, each with its own pair of buffers, flush thread and log file. A transaction always
+ * logs into the same partition (txn_id modulo the number of partitions), so its records are ordered within it and
+ * committing only waits for its own partition, unless it changed a page after a transaction of another partition
+ * whose record is not on disk yet. Redo replays a page in LSN order and cannot skip a lost change to it. LSNs are
+ * global: they come from a single counter and order the records of all partitions, which is what recovery merges the
+ * partitions by.
+ *
+ * Appenders do not take a latch. An appender reads the partition's reservation_, which packs the generation of
+ * log_buffer_ and the next free offset, takes an LSN and reserves its space with a compare-and-swap. The swap only
+ * succeeds if nobody reserved space in between, and everybody who did so took their LSN earlier, so LSN order equals
+ * buffer order within a partition. A failed swap discards its LSN, so LSNs are strictly increasing but not dense.
+ * Every appender serializes its record in parallel and publishes it by storing the record's size field last. The flush
+ * thread writes the contiguous prefix of published records and never waits for slow appenders.
+ *
+ * The appender whose record does not fit any more seals log_buffer_: it waits for the in-flight appenders of the sealed
+ * buffer, swaps in the empty flush_buffer_ and writes the rest of the sealed buffer, while the other appenders already
+ * continue in the fresh buffer.
+ *
+ * Table pages do not build LogRecord objects: they reserve the space of a record with ReserveLogRecord(), copy the
+ * tuple images straight from the page or the source tuple into the log buffer and publish the record, see
+ * AppendTupleLogRecord() and AppendUpdateLogRecord().
+ *
+ * Committing transactions call FlushUntil() with their commit LSN and are released together once a single write has
+ * covered all of them (group commit). Asynchronously committing transactions call FlushAsync() instead, which only
+ * sets a deadline for the flush thread of their partition.
  */
 class LogManager {
  public:
-  explicit LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
-    flush_buffer_ = new char[LOG_BUFFER_SIZE];
-  }
+  /**
+   * @param disk_manager the disk manager that owns the log files
+   * @param num_partitions the number of log partitions
+   */
+  explicit LogManager(DiskManager *disk_manager, int num_partitions = 1);
 
-  ~LogManager() {
-    delete[] log_buffer_;
-    delete[] flush_buffer_;
-    log_buffer_ = nullptr;
-    flush_buffer_ = nullptr;
-  }
+  ~LogManager();
 
   void RunFlushThread();
   void StopFlushThread();
 
   lsn_t AppendLogRecord(LogRecord *log_record);
 
-  inline lsn_t GetNextLSN() { return next_lsn_; }
-  inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
-  inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
-  inline char *GetLogBuffer() { return log_buffer_; }
+  /** Space for a log record in a log buffer, see ReserveLogRecord(). */
+  struct LogReservation {
+    lsn_t lsn_;
+    /** Where the payload of the record goes, behind its header. */
+    char *payload_;
+    /** The record in the log buffer. */
+    char *record_;
+    /** The size of the record, padded to 4 bytes. */
+    int32_t size_;
+  };
+
+  /**
+   * Reserve space for a log record and write its header. The caller writes the payload and must publish the record
+   * right away: the log buffer is not written past it, and cannot be swapped, before it is published.
+   * @param txn_id the transaction of the record, which also selects the partition
+   * @param prev_lsn the previous LSN of the transaction
+   * @param log_record_type the type of the record
+   * @param payload_size the size of the record without its header
+   * @return the reserved space and the LSN of the record
+   */
+  LogReservation ReserveLogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type,
+                                  int32_t payload_size);
+
+  /** Make a reserved record visible to the flush thread, once its payload is written. */
+  void PublishLogRecord(const LogReservation &reservation);
+
+  /**
+   * Append an INSERT, MARKDELETE, APPLYDELETE or ROLLBACKDELETE record without building a LogRecord.
+   * @param tuple_data the tuple image, copied straight into the log buffer
+   * @param tuple_size the size of the tuple image, may be 0
+   * @return the LSN of the record
+   */
+  lsn_t AppendTupleLogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, const RID &rid,
+                             const char *tuple_data, uint32_t tuple_size);
+
+  /**
+   * Append an UPDATE record without building a LogRecord, or a DELTAUPDATE record if both images have the same size.
+   * @return the LSN of the record
+   */
+  lsn_t AppendUpdateLogRecord(txn_id_t txn_id, lsn_t prev_lsn, const RID &rid, const char *old_data,
+                              uint32_t old_size, const char *new_data, uint32_t new_size);
+
+  /**
+   * Block until every log record up to and including lsn is on disk, waking up the flush threads if necessary.
+   * Without running flush threads the calling thread writes the log buffers itself.
+   * @param lsn the log sequence number that must become persistent
+   * @param txn_id if valid, only wait for the partition of this transaction, unless it depends on another partition
+   * @param commit_dependency the largest LSN of the records of other transactions the committing one depends on, see
+   * Transaction::GetCommitDependency(). If that is not on disk yet, the records of all partitions up to it are written
+   * first.
+   */
+  void FlushUntil(lsn_t lsn, txn_id_t txn_id = INVALID_TXN_ID, lsn_t commit_dependency = INVALID_LSN);
+
+  /**
+   * Let the flush thread of the transaction's partition write every record up to and including lsn within
+   * async_commit_delay, without waiting for it. Without running flush threads the records are written by the next
+   * flush.
+   * @param lsn the LSN of the COMMIT record of an asynchronously committing transaction
+   * @param txn_id the committing transaction
+   */
+  void FlushAsync(lsn_t lsn, txn_id_t txn_id);
+
+  /**
+   * Wake up the flush threads to write every record up to and including lsn, without waiting for them. Without running
+   * flush threads nothing is written.
+   */
+  void RequestFlush(lsn_t lsn);
 
- private:
-  // TODO(students): you may add your own member variables
+  inline lsn_t GetNextLSN() { return next_lsn_; }
+  /** @return the LSN up to which the records of all partitions are on disk */
+  lsn_t GetPersistentLSN();
+  void SetPersistentLSN(lsn_t lsn);
+  inline char *GetLogBuffer() { return partitions_[0]->log_buffer_; }
+  inline int GetNumPartitions() const { return static_cast<int>(partitions_.size()); }
+  /** @return the index of the partition the records of the transaction go to */
+  inline int GetPartitionIndex(txn_id_t txn_id) const {
+    return static_cast<int>(static_cast<uint32_t>(txn_id) % partitions_.size());
+  }
 
-  /** The atomic counter which records the next log sequence number. */
-  std::atomic<lsn_t> next_lsn_;
-  /** The log records before and including the persistent lsn have been written to disk. */
-  std::atomic<lsn_t> persistent_lsn_;
+  /**
+   * Take the current end of the log on disk, where a later checkpoint may let recovery start.
+   * @param[out] next_lsn every record with this LSN or a larger one is stored behind the returned offsets
+   * @return the logical end offset of every log partition
+   */
+  std::vector<int64_t> GetLogOffsets(lsn_t *next_lsn);
 
-  char *log_buffer_;
-  char *flush_buffer_;
+  /** Point recovery to a checkpoint whose records are on disk. */
+  void WriteMasterRecord(const CheckpointMasterRecord &master_record);
 
-  std::mutex latch_;
+  /**
+   * Recycle the log segments before the given offsets, once the master record no longer needs them.
+   * @param offsets the logical offset of the oldest record that is still needed, per partition
+   */
+  void TruncateLog(const std::vector<int64_t> &offsets);
 
-  std::thread *flush_thread_ __attribute__((__unused__));
+ private:
+  static constexpr uint64_t RESERVATION_OFFSET_MASK = 0xFFFFFFFF;
+  /** Offset of a sealed log_buffer_, no more space is handed out until the buffers are swapped. */
+  static constexpr uint64_t SEALED_OFFSET = RESERVATION_OFFSET_MASK;
+
+  struct LogPartition {
+    explicit LogPartition(int index);
+    ~LogPartition();
+
+    const int index_;
+    /** The generation of log_buffer_ in the high 32 bits, the next free offset in log_buffer_ in the low 32 bits. */
+    std::atomic<uint64_t> reservation_{0};
+    /** Number of appenders that have read reservation_ but not reserved their space yet. */
+    std::atomic<int> inflight_{0};
+    /**
+     * The records of this partition up to and including the persistent lsn are on disk, and no record with a smaller
+     * or equal LSN will be appended to it any more.
+     */
+    std::atomic<lsn_t> persistent_lsn_{INVALID_LSN};
+
+    char *log_buffer_;
+    char *flush_buffer_;
+
+    // protected by latch_, which is held for the duration of every log write
+    /** Number of bytes of log_buffer_ that are on disk. */
+    int flushed_offset_{0};
+    /** True if someone is waiting for the flush thread to write log_buffer_ before the timeout. */
+    bool need_flush_{false};
+    /** When the flush thread must write log_buffer_ at the latest, because of an asynchronous commit. */
+    std::chrono::steady_clock::time_point flush_deadline_{std::chrono::steady_clock::time_point::max()};
+
+    std::mutex latch_;
+
+    std::thread *flush_thread_{nullptr};
+
+    /** Wakes up the flush thread. */
+    std::condition_variable cv_;
+    /** Notified whenever a flush completes. */
+    std::condition_variable flushed_cv_;
+  };
+
+  /**
+   * Block until the records of the partition up to and including lsn are on disk.
+   * @param kick_only only wake up the flush thread, do not wait for it
+   */
+  void FlushPartitionUntil(LogPartition *partition, lsn_t lsn, bool kick_only);
+
+  /**
+   * Write the published records of log_buffer_ that follow flushed_offset_. Caller must hold the partition latch.
+   * @return true if anything was written
+   */
+  bool FlushFilledPrefix(LogPartition *partition);
+
+  /**
+   * Wait for the appenders of the full log_buffer_, swap the buffers and write the rest of the old one.
+   * @param sealed_size the number of bytes reserved in log_buffer_ before it was sealed
+   */
+  void SealLogBuffer(LogPartition *partition, int sealed_size);
+
+  /**
+   * Follow the size fields of the published records in buffer.
+   * @param buffer the log buffer
+   * @param offset where to start, must be the beginning of a record
+   * @param[out] last_lsn LSN of the last published record, unchanged if there is none
+   * @return the end of the last published record
+   */
+  static int ScanFilledPrefix(const char *buffer, int offset, lsn_t *last_lsn);
+
+  /** The next log sequence number, shared by all partitions. */
+  std::atomic<lsn_t> next_lsn_;
+  /** The largest LSN of an asynchronous COMMIT record. */
+  std::atomic<lsn_t> async_commit_lsn_{INVALID_LSN};
 
-  std::condition_variable cv_;
+  std::vector<std::unique_ptr<LogPartition>> partitions_;
 
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
 };
 
 }  // namespace bustub
@@ -13,7 +13,10 @@
 #pragma once
 
 #include <cassert>
+#include <cstring>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "storage/table/tuple.h"
@@ -32,8 +35,51 @@ enum class LogRecordType {
   ABORT,
   /** Creating a new page in the table heap. */
   NEWPAGE,
+  /** Start of a fuzzy checkpoint, see CheckpointManager. */
+  BEGIN_CHECKPOINT,
+  /** The active transaction table and the dirty page table of a fuzzy checkpoint. */
+  END_CHECKPOINT,
+  /** An update that keeps the tuple size, only the changed byte ranges are logged. */
+  DELTAUPDATE,
 };
 
+/** A run of bytes within a tuple that an update changed. */
+struct TupleDeltaRange {
+  int32_t offset_;
+  int32_t length_;
+};
+
+/**
+ * Find the byte ranges in which two images of a tuple differ. A gap shorter than a range header is cheaper to log
+ * than a new range, so it is merged into the ranges around it.
+ * @param old_data the tuple before the update
+ * @param new_data the tuple after the update, of the same size
+ * @param size the size of the tuple
+ * @param visit called with every TupleDeltaRange in order
+ */
+template <typename Visit>
+void ForEachTupleDelta(const char *old_data, const char *new_data, int32_t size, Visit &&visit) {
+  int32_t pos = 0;
+  while (pos < size) {
+    if (old_data[pos] == new_data[pos]) {
+      pos++;
+      continue;
+    }
+    int32_t end = pos + 1;
+    int32_t unchanged = 0;
+    while (end + unchanged < size && unchanged < static_cast<int32_t>(sizeof(TupleDeltaRange))) {
+      if (old_data[end + unchanged] != new_data[end + unchanged]) {
+        end += unchanged + 1;
+        unchanged = 0;
+      } else {
+        unchanged++;
+      }
+    }
+    visit(TupleDeltaRange{pos, end - pos});
+    pos = end;
+  }
+}
+
 /**
  * For every write operation on the table page, you should write ahead a corresponding log record.
  *
@@ -53,16 +99,29 @@ enum class LogRecordType {
  *-----------------------------------------------------------------------------------
  * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size | new_tuple_data |
  *-----------------------------------------------------------------------------------
+ * For delta update type log record, the old and the new bytes of all ranges are concatenated
+ *----------------------------------------------------------------------------------------------------
+ * | HEADER | tuple_rid | tuple_size | num_ranges | (offset, length) * num_ranges | old_bytes | new_bytes |
+ *----------------------------------------------------------------------------------------------------
  * For new page type log record
- *--------------------------
- * | HEADER | prev_page_id |
- *--------------------------
+ *-------------------------------------
+ * | HEADER | prev_page_id | page_id |
+ *-------------------------------------
+ * For end checkpoint type log record, a large table is split over several records
+ *-------------------------------------------------------------------------------------------
+ * | HEADER | num_txns | (txn_id, first_lsn) * num_txns | num_pages | (page_id, rec_lsn) * num_pages |
+ *-------------------------------------------------------------------------------------------
+ * BEGIN_CHECKPOINT and END_CHECKPOINT records do not belong to a transaction, their transID is INVALID_TXN_ID.
  */
 class LogRecord {
   friend class LogManager;
   friend class LogRecovery;
+  friend class CheckpointManager;
 
  public:
+  /** Size of one entry of the active transaction table or the dirty page table. */
+  static const int ENTRY_SIZE = sizeof(int32_t) + sizeof(lsn_t);
+
   LogRecord() = default;
 
   // constructor for Transaction type(BEGIN/COMMIT/ABORT)
@@ -85,17 +144,28 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(RID) + sizeof(int32_t) + tuple.GetLength();
   }
 
-  // constructor for UPDATE type
+  // constructor for UPDATE/DELTAUPDATE type, a DELTAUPDATE needs tuples of the same size
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, const RID &update_rid,
             const Tuple &old_tuple, const Tuple &new_tuple)
-      : txn_id_(txn_id),
-        prev_lsn_(prev_lsn),
-        log_record_type_(log_record_type),
-        update_rid_(update_rid),
-        old_tuple_(old_tuple),
-        new_tuple_(new_tuple) {
-    // calculate log record size
-    size_ = HEADER_SIZE + sizeof(RID) + old_tuple.GetLength() + new_tuple.GetLength() + 2 * sizeof(int32_t);
+      : txn_id_(txn_id), prev_lsn_(prev_lsn), log_record_type_(log_record_type), update_rid_(update_rid) {
+    if (log_record_type == LogRecordType::UPDATE) {
+      old_tuple_ = old_tuple;
+      new_tuple_ = new_tuple;
+      // calculate log record size
+      size_ = HEADER_SIZE + sizeof(RID) + old_tuple.GetLength() + new_tuple.GetLength() + 2 * sizeof(int32_t);
+      return;
+    }
+    assert(log_record_type == LogRecordType::DELTAUPDATE && old_tuple.GetLength() == new_tuple.GetLength());
+    delta_tuple_size_ = old_tuple.GetLength();
+    const char *old_data = old_tuple.GetData();
+    const char *new_data = new_tuple.GetData();
+    ForEachTupleDelta(old_data, new_data, delta_tuple_size_, [&](const TupleDeltaRange &range) {
+      delta_ranges_.push_back(range);
+      delta_old_.insert(delta_old_.end(), old_data + range.offset_, old_data + range.offset_ + range.length_);
+      delta_new_.insert(delta_new_.end(), new_data + range.offset_, new_data + range.offset_ + range.length_);
+    });
+    size_ = HEADER_SIZE + sizeof(RID) + 2 * sizeof(int32_t) + delta_ranges_.size() * sizeof(TupleDeltaRange) +
+            delta_old_.size() + delta_new_.size();
   }
 
   // constructor for NEWPAGE type
@@ -110,6 +180,15 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(page_id_t) * 2;
   }
 
+  // constructor for END_CHECKPOINT type
+  LogRecord(std::vector<std::pair<txn_id_t, lsn_t>> active_txn_table,
+            std::vector<std::pair<page_id_t, lsn_t>> dirty_page_table)
+      : log_record_type_(LogRecordType::END_CHECKPOINT),
+        active_txn_table_(std::move(active_txn_table)),
+        dirty_page_table_(std::move(dirty_page_table)) {
+    size_ = HEADER_SIZE + 2 * sizeof(int32_t) + (active_txn_table_.size() + dirty_page_table_.size()) * ENTRY_SIZE;
+  }
+
   ~LogRecord() = default;
 
   inline Tuple &GetDeleteTuple() { return delete_tuple_; }
@@ -126,8 +205,22 @@ class LogRecord {
 
   inline RID &GetUpdateRID() { return update_rid_; }
 
+  inline int32_t GetDeltaTupleSize() { return delta_tuple_size_; }
+
+  inline std::vector<TupleDeltaRange> &GetDeltaRanges() { return delta_ranges_; }
+
+  /** @return the bytes of all delta ranges before the update */
+  inline std::vector<char> &GetDeltaOldBytes() { return delta_old_; }
+
+  /** @return the bytes of all delta ranges after the update */
+  inline std::vector<char> &GetDeltaNewBytes() { return delta_new_; }
+
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
 
+  inline std::vector<std::pair<txn_id_t, lsn_t>> &GetActiveTxnTable() { return active_txn_table_; }
+
+  inline std::vector<std::pair<page_id_t, lsn_t>> &GetDirtyPageTable() { return dirty_page_table_; }
+
   inline int32_t GetSize() { return size_; }
 
   inline lsn_t GetLSN() { return lsn_; }
@@ -172,11 +265,84 @@ class LogRecord {
   RID update_rid_;
   Tuple old_tuple_;
   Tuple new_tuple_;
+  // for delta update operation, update_rid_ and the changed byte ranges
+  int32_t delta_tuple_size_{0};
+  std::vector<TupleDeltaRange> delta_ranges_;
+  std::vector<char> delta_old_;
+  std::vector<char> delta_new_;
 
   // case4: for new page operation
   page_id_t prev_page_id_{INVALID_PAGE_ID};
   page_id_t page_id_{INVALID_PAGE_ID};
+
+  // case5: for end checkpoint, transactions with the LSN of their first record and dirty pages with their recovery LSN
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txn_table_;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_page_table_;
+
   static const int HEADER_SIZE = 20;
 };  // namespace bustub
 
+/**
+ * The master record points recovery to the last complete checkpoint. The CheckpointManager rewrites it once the
+ * END_CHECKPOINT records are on disk, see DiskManager::WriteMasterRecord().
+ *------------------------------------------------------------------------------------------------------
+ * | magic | begin_lsn | end_lsn | num_partitions | checkpoint_offset * num_partitions | redo_offset * num_partitions |
+ *------------------------------------------------------------------------------------------------------
+ * Every partition holds the records of the checkpoint behind its checkpoint offset, and every record recovery must
+ * redo behind its redo offset. The offsets are logical offsets into the segment chain of the partition.
+ */
+struct CheckpointMasterRecord {
+  static constexpr uint32_t MAGIC = 0x4B435442;  // "BTCK"
+
+  /** LSN of the BEGIN_CHECKPOINT record. */
+  lsn_t begin_lsn_{INVALID_LSN};
+  /** LSN of the last END_CHECKPOINT record. */
+  lsn_t end_lsn_{INVALID_LSN};
+  std::vector<int64_t> checkpoint_offsets_;
+  std::vector<int64_t> redo_offsets_;
+
+  inline std::vector<char> Serialize() const {
+    uint32_t magic = MAGIC;
+    auto num_partitions = static_cast<int32_t>(checkpoint_offsets_.size());
+    std::vector<char> data(sizeof(uint32_t) + sizeof(lsn_t) * 2 + sizeof(int32_t) +
+                           sizeof(int64_t) * 2 * num_partitions);
+    char *pos = data.data();
+    auto put = [&pos](const void *value, size_t size) {
+      memcpy(pos, value, size);
+      pos += size;
+    };
+    put(&magic, sizeof(uint32_t));
+    put(&begin_lsn_, sizeof(lsn_t));
+    put(&end_lsn_, sizeof(lsn_t));
+    put(&num_partitions, sizeof(int32_t));
+    put(checkpoint_offsets_.data(), sizeof(int64_t) * num_partitions);
+    put(redo_offsets_.data(), sizeof(int64_t) * num_partitions);
+    return data;
+  }
+
+  /** @return false if data is not a complete master record */
+  inline bool Deserialize(const std::vector<char> &data) {
+    const size_t header_size = sizeof(uint32_t) + sizeof(lsn_t) * 2 + sizeof(int32_t);
+    if (data.size() < header_size) {
+      return false;
+    }
+    uint32_t magic;
+    int32_t num_partitions;
+    memcpy(&magic, data.data(), sizeof(uint32_t));
+    memcpy(&begin_lsn_, data.data() + sizeof(uint32_t), sizeof(lsn_t));
+    memcpy(&end_lsn_, data.data() + sizeof(uint32_t) + sizeof(lsn_t), sizeof(lsn_t));
+    memcpy(&num_partitions, data.data() + header_size - sizeof(int32_t), sizeof(int32_t));
+    if (magic != MAGIC || num_partitions <= 0 ||
+        data.size() != header_size + sizeof(int64_t) * 2 * static_cast<size_t>(num_partitions)) {
+      return false;
+    }
+    checkpoint_offsets_.resize(num_partitions);
+    redo_offsets_.resize(num_partitions);
+    memcpy(checkpoint_offsets_.data(), data.data() + header_size, sizeof(int64_t) * num_partitions);
+    memcpy(redo_offsets_.data(), data.data() + header_size + sizeof(int64_t) * num_partitions,
+           sizeof(int64_t) * num_partitions);
+    return true;
+  }
+};
+
 }  // namespace bustub
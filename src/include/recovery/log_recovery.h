@@ -13,8 +13,12 @@
 #pragma once
 
 #include <algorithm>
+#include <functional>
+#include <map>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
@@ -24,34 +28,132 @@ namespace bustub {
 
 /**
  * Read log file from disk, redo and undo.
+ *
+ * A log that was written in several partitions is replayed in global LSN order: every partition is read sequentially
+ * and is already sorted by LSN, so Redo() merges them by always taking the smallest LSN among the partition heads.
+ * A partition is read along its chain of segments, from one segment to the next where the records of a segment end.
+ * Segments are mapped into memory and records are deserialized in place, their tuples point into the mapping. No
+ * record ever spans two segments, so none has to be pieced together from two reads. The mappings are kept until
+ * Undo() is done.
+ *
+ * Redo is parallel. The thread calling Redo() reads the records and dispatches pointers to them by page id to a pool
+ * of redo threads, so every page is replayed by a single thread in LSN order and no page latches are needed.
+ *
+ * Undo only looks up the records of the transactions that did not finish. Their locations are collected by the first
+ * Undo() in a scan over the record headers, instead of mapping the LSN of every record during redo.
+ *
+ * If the master record points to a complete checkpoint, Redo() first reads its dirty page table and then starts at
+ * the redo offsets of the checkpoint instead of the beginning of the log. Records older than BEGIN_CHECKPOINT are only
+ * replayed on pages of the dirty page table, and only from their recovery LSN on.
  */
 class LogRecovery {
  public:
-  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
-      : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), offset_(0) {
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
-  }
+  /**
+   * @param disk_manager the disk manager that owns the log
+   * @param buffer_pool_manager the buffer pool to replay the log into
+   * @param num_redo_threads the number of threads that apply records during redo, 1 applies them on the reading thread
+   */
+  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int num_redo_threads = 4)
+      : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), num_redo_threads_(num_redo_threads) {}
 
-  ~LogRecovery() {
-    delete[] log_buffer_;
-    log_buffer_ = nullptr;
-  }
+  ~LogRecovery() { UnmapSegments(); }
 
+  /** @throw Exception if a record does not fit the page it changes, the log is missing a record before it */
   void Redo();
   void Undo();
+  /** Deserialize a record without copying its tuples, they point into data, which must outlive log_record. */
   bool DeserializeLogRecord(const char *data, LogRecord *log_record);
 
  private:
-  DiskManager *disk_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /**
+   * Deserialize the payload of a DELTAUPDATE record.
+   * @return false if it does not end before end or a range lies outside of the tuple
+   */
+  static bool DeserializeDelta(const char *pos, const char *end, LogRecord *log_record);
+
+  /** A log segment mapped by DiskManager::MapLogSegment(). */
+  struct MappedSegment {
+    const char *data_;
+    /** Logical offset of data_ in the log partition. */
+    int64_t begin_;
+    int64_t size_;
+  };
+
+  /** Reads the records of one log partition in place, segment by segment. */
+  struct PartitionReader {
+    int partition_;
+    /** The segment that is read, nullptr at the end of the partition. */
+    const MappedSegment *segment_{nullptr};
+    /** Offset of the next record in the segment. */
+    int64_t pos_{0};
+    /** The record that was read last, deserialized and in the mapping. */
+    LogRecord log_record_;
+    const char *record_{nullptr};
+  };
+
+  /** @return the mapping of the segment that holds offset, nullptr if offset is not in a live segment */
+  const MappedSegment *MapSegment(int partition, int64_t offset);
+  void UnmapSegments();
+
+  /** Position the reader at offset, which must be the beginning of a record. */
+  void StartReading(PartitionReader *reader, int partition, int64_t offset);
+
+  /**
+   * Step over the next record of the partition without deserializing it.
+   * @return the record, nullptr at the end of the partition
+   */
+  const char *NextLogRecord(PartitionReader *reader);
+
+  /**
+   * Read the next record of the partition into reader->log_record_.
+   * @return false at the end of the partition
+   */
+  bool ReadNextLogRecord(PartitionReader *reader);
+
+  /**
+   * Visit the records of all partitions in LSN order.
+   * @param offsets where to start reading in every partition, each must be the beginning of a record
+   * @param visit called for every record and where it is in its mapped segment, returns false to stop
+   */
+  void MergePartitions(const std::vector<int64_t> &offsets,
+                       const std::function<bool(LogRecord *, const char *)> &visit);
+
+  /** Map the LSN of every record of the transactions in active_txn_ to the record. */
+  void BuildLSNMapping();
+
+  /**
+   * Read the checkpoint the master record points to.
+   * @param[out] redo_offsets where redo starts in every partition
+   * @param[out] checkpoint_lsn LSN of the BEGIN_CHECKPOINT record
+   * @param[out] dirty_page_table the recovery LSN of every page that was dirty at the checkpoint
+   * @return false if there is no complete checkpoint, the outputs are left unchanged then
+   */
+  bool AnalyzeCheckpoint(std::vector<int64_t> *redo_offsets, lsn_t *checkpoint_lsn,
+                         std::unordered_map<page_id_t, lsn_t> *dirty_page_table);
+
+  /** @return the page a data record changes, INVALID_PAGE_ID for BEGIN/COMMIT/ABORT */
+  static page_id_t GetPageId(LogRecord *log_record);
+
+  /**
+   * Apply the record to one page unless the page already contains it.
+   * @param page_id the page to redo, a NEWPAGE record is replayed separately on the new page and on the page before it
+   */
+  void RedoLogRecord(LogRecord *log_record, page_id_t page_id);
+  void UndoLogRecord(LogRecord *log_record);
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  int num_redo_threads_;
 
   /** Maintain active transactions and its corresponding latest lsn. */
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
-  /** Mapping the log sequence number to log file offset for undos. */
-  std::unordered_map<lsn_t, int> lsn_mapping_;
+  /** Mapping the log sequence number to the record in its mapped segment for undos, built lazily by Undo(). */
+  std::unordered_map<lsn_t, const char *> lsn_mapping_;
+  /** Where redo started reading every partition. */
+  std::vector<int64_t> redo_offsets_;
 
-  int offset_ __attribute__((__unused__));
-  char *log_buffer_;
+  /** The mapped log segments, by partition and the logical offset where the segment ends. */
+  std::map<std::pair<int, int64_t>, MappedSegment> segments_;
 };
 
 }  // namespace bustub
@@ -13,10 +13,14 @@
 #pragma once
 
 #include <atomic>
+#include <deque>
 #include <fstream>
 #include <future>  // NOLINT
-#include <mutex>   // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "common/config.h"
 
@@ -25,14 +29,43 @@ namespace bustub {
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * With compression enabled, pages are compressed with PageCompressor before they are written and stored in
+ * variable-size slots instead of at page_id * PAGE_SIZE. Frames in the buffer pool always hold uncompressed pages.
+ * Every slot starts with a header naming the page it holds, so the page-id to slot mapping table is rebuilt by
+ * scanning the file when it is opened:
+ *  ------------------------------------------------------------------------------------------
+ *  | Magic (4) | PageId (4) | Capacity (4) | Size (4) | Sequence (8) | Payload (Size) | ... |
+ *  ------------------------------------------------------------------------------------------
+ * Capacity is a multiple of SLOT_ALIGNMENT. A page is rewritten in place while its payload fits into its slot,
+ * otherwise it moves to a new slot and the old one is recycled. Sequence orders multiple slots of the same page.
+ * A payload of PAGE_SIZE bytes is stored uncompressed.
+ *
+ * The log can be split into partitions that are appended to independently. Partition 0 is named after the db file
+ * (test.db -> test.log), partition i > 0 is named test.log.i. The master record of the last checkpoint is stored in
+ * test.log.master.
+ *
+ * Every partition is a chain of segment files of log_segment_size bytes, e.g. test.log.00000000, test.log.00000001 or
+ * test.log.1.00000000 for partition 1. A segment is preallocated when it is created, and segments that are no longer
+ * needed after a checkpoint are renamed to a future segment number and reused instead of creating new files. Every
+ * segment starts with a header naming the segment, so a recycled segment that still holds old records is never
+ * mistaken for a live one:
+ *  -----------------------------------------------------------------
+ *  | Magic (4) | Partition (4) | Segment (8) | Log records ... | 0 |
+ *  -----------------------------------------------------------------
+ * The log of a partition is addressed by logical offsets that count the log records of all segments, segment s holds
+ * offsets [s * capacity, (s + 1) * capacity) where the capacity is the segment size minus the header. A log write
+ * never spans two segments: if it does not fit into the rest of the current one, it starts the next segment and the
+ * current one ends with a zero size field, just like the last segment ends at the first record whose size is zero.
  */
 class DiskManager {
  public:
   /**
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
+   * @param enable_compression true if pages should be stored compressed, the file must have been written the same way
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, bool enable_compression = false);
 
   ~DiskManager() = default;
 
@@ -56,20 +89,83 @@ class DiskManager {
   void ReadPage(page_id_t page_id, char *page_data);
 
   /**
-   * Flush the entire log buffer into disk.
-   * @param log_data raw log data
+   * Flush the entire log buffer into disk and sync it, the records survive a crash once this returns.
+   * @param log_data raw log data, a sequence of complete log records
    * @param size size of log entry
+   * @param partition the log partition to append to
    */
-  void WriteLog(char *log_data, int size);
+  void WriteLog(char *log_data, int size, int partition = 0);
 
   /**
-   * Read a log entry from the log file.
+   * Read a log entry from the log file. The read stops at the end of the segment of offset, the rest of log_data is
+   * zero-filled.
    * @param[out] log_data output buffer
    * @param size size of the log entry
-   * @param offset offset of the log entry in the file
-   * @return true if the read was successful, false otherwise
+   * @param offset logical offset of the log entry in the partition
+   * @param partition the log partition to read from
+   * @return true if the read was successful, false if offset is not in a live segment
    */
-  bool ReadLog(char *log_data, int size, int offset);
+  bool ReadLog(char *log_data, int size, int64_t offset, int partition = 0);
+
+  /** @return the logical offset where the segment after the one of offset starts */
+  int64_t GetNextLogSegmentOffset(int64_t offset) const;
+
+  /**
+   * Map the log segment that holds offset into memory, read-only. A log record never spans two segments, so every
+   * record of the segment can be read in place without copying it.
+   * @param offset logical offset of a log record in the partition
+   * @param partition the log partition to read from
+   * @param[out] begin the logical offset of the first byte of the mapping, the first record of the segment
+   * @param[out] size the number of bytes mapped, up to the end of the segment or of the log
+   * @return the mapped log records, nullptr if offset is not in a live segment. Release it with UnmapLogSegment().
+   */
+  const char *MapLogSegment(int64_t offset, int partition, int64_t *begin, int64_t *size);
+
+  /** Release a mapping of MapLogSegment(). */
+  void UnmapLogSegment(const char *data, int64_t size);
+
+  /**
+   * Open the log partitions up to num_partitions, their first segment is created by the first write. Partitions found
+   * on disk are opened by the constructor, so that recovery sees all of them. Must be called before the log is
+   * written.
+   * @param num_partitions the number of log partitions
+   */
+  void OpenLogPartitions(int num_partitions);
+
+  /** @return the number of open log partitions */
+  int GetNumLogPartitions() const { return static_cast<int>(log_segments_.size()); }
+
+  /** @return the logical offset of the first log record of a partition that is still stored */
+  int64_t GetLogBegin(int partition);
+
+  /** @return the logical offset where the next write of a log partition goes, as far as it is known yet */
+  int64_t GetLogEnd(int partition);
+
+  /**
+   * Recycle the segments of a log partition that only hold records before offset, recovery will never read them
+   * again. The segment that is written to is kept.
+   * @param partition the log partition
+   * @param offset the logical offset of the oldest log record that is still needed
+   */
+  void TruncateLog(int partition, int64_t offset);
+
+  /** @return the number of segments of a log partition that were recycled instead of created */
+  int GetNumRecycledLogSegments(int partition);
+
+  /**
+   * Replace the master record, which tells recovery where the last checkpoint is. The old record stays intact until
+   * the new one is completely written and synced.
+   * @param data the master record
+   * @param size size of the master record
+   */
+  void WriteMasterRecord(const char *data, int size);
+
+  /**
+   * Read the master record.
+   * @param[out] data the master record
+   * @return false if there is none
+   */
+  bool ReadMasterRecord(std::vector<char> *data);
 
   /** @return the number of disk flushes */
   int GetNumFlushes() const;
@@ -80,6 +176,12 @@ class DiskManager {
   /** @return the number of disk writes */
   int GetNumWrites() const;
 
+  /** @return the number of page bytes written to the db file, which is less than PAGE_SIZE per write if compressed */
+  uint64_t GetNumBytesWritten() const;
+
+  /** @return the number of page bytes read from the db file */
+  uint64_t GetNumBytesRead() const;
+
   /**
    * Sets the future which is used to check for non-blocking flushes.
    * @param f the non-blocking flush check
@@ -90,19 +192,80 @@ class DiskManager {
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
  private:
-  int GetFileSize(const std::string &file_name);
-  // stream to write log file
-  std::fstream log_io_;
+  /** Location of a compressed page in the db file. */
+  struct PageSlot {
+    size_t offset_;
+    uint32_t capacity_;
+    uint32_t size_;
+  };
+
+  static constexpr uint32_t SLOT_ALIGNMENT = 512;
+
+  /** The segment chain of a log partition. */
+  struct LogSegments {
+    std::mutex latch_;
+    /** The live segments are first_ to last_, none if last_ < first_. */
+    int64_t first_{0};
+    int64_t last_{-1};
+    /** Numbers of the recycled segment files, larger than last_. */
+    std::deque<int64_t> spare_;
+    /** File of segment last_, which is written to. */
+    int write_fd_{-1};
+    /** Logical offset of the next write. */
+    int64_t write_offset_{0};
+    /** File of segment read_segment_, the last one read from. */
+    int read_fd_{-1};
+    int64_t read_segment_{-1};
+    int num_recycled_{0};
+    /** Last buffer written, used to check that the log manager swaps its buffers. */
+    char *buffer_used_{nullptr};
+  };
+
+  static constexpr uint32_t LOG_SEGMENT_MAGIC = 0x4C535442;  // "BTSL"
+  /** Segments that are kept for reuse per partition, the others are deleted. */
+  static constexpr size_t MAX_SPARE_LOG_SEGMENTS = 4;
+
+  int64_t GetFileSize(const std::string &file_name);
+  std::string GetLogFileName(int partition) const;
+  std::string GetLogSegmentName(int partition, int64_t segment) const;
+  /** Find the segments of all partitions on disk, the next write of every partition starts a new segment. */
+  void LoadLogSegments();
+  /** Make segment last_ + 1 the one that is written to, reusing a spare file if there is one. */
+  void StartLogSegment(int partition, LogSegments *segments);
+  /** Capacity of a segment for log records. */
+  int64_t GetLogSegmentCapacity() const;
+  void WriteCompressedPage(page_id_t page_id, const char *page_data);
+  void ReadCompressedPage(page_id_t page_id, char *page_data);
+  /** @return the offset of a free slot of the given capacity, reusing a recycled one if possible */
+  size_t AllocateSlot(uint32_t capacity);
+  /** Rebuild page_slots_ and free_slots_ from the slot headers in the db file. */
+  void LoadPageSlots();
+
+  // log segments, one chain per partition. Each partition is written by a single flush thread.
+  std::vector<std::unique_ptr<LogSegments>> log_segments_;
   std::string log_name_;
+  int64_t log_segment_size_;
   // stream to write db file
   std::fstream db_io_;
   std::string file_name_;
-  int num_flushes_;
+  std::atomic<int> num_flushes_;
   int num_writes_;
-  bool flush_log_;
+  uint64_t num_bytes_written_{0};
+  uint64_t num_bytes_read_{0};
+  std::atomic<bool> flush_log_;
   std::future<void> *flush_log_f_;
   // With multiple buffer pool instances, need to protect file access
   std::mutex db_io_latch_;
+
+  // page compression, all protected by db_io_latch_
+  bool enable_compression_;
+  std::unordered_map<page_id_t, PageSlot> page_slots_;
+  // recycled slot offsets, indexed by capacity / SLOT_ALIGNMENT
+  std::vector<std::vector<size_t>> free_slots_;
+  size_t file_end_{0};
+  uint64_t slot_seq_{0};
+  // slot header followed by the (compressed) page
+  std::vector<char> slot_buffer_;
 };
 
 }  // namespace bustub
@@ -0,0 +1,62 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_compressor.h
+//
+// Identification: src/include/storage/disk/page_compressor.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bustub {
+
+/**
+ * PageCompressor is a small LZ77 codec (LZ4 block format style) used by the DiskManager to compress pages on their way
+ * to disk. It favors speed over ratio: a single hash probe per position, no entropy coding.
+ *
+ * Each sequence is encoded as
+ *  -----------------------------------------------------------------------------------------------
+ *  | Token (1) | LiteralLength ext (0+) | Literals | Offset (2) | MatchLength ext (0+) |
+ *  -----------------------------------------------------------------------------------------------
+ * where the high nibble of the token is the literal length and the low nibble is the match length minus MIN_MATCH.
+ * A nibble of 15 is followed by extension bytes that are summed up until a byte other than 255. The last sequence
+ * only carries literals.
+ */
+class PageCompressor {
+ public:
+  /**
+   * Compress src into dst.
+   * @param src input buffer
+   * @param src_size size of the input, at most 64KB
+   * @param[out] dst output buffer
+   * @param dst_capacity size of the output buffer
+   * @return the compressed size, or 0 if the output does not fit into dst_capacity bytes
+   */
+  static size_t Compress(const char *src, size_t src_size, char *dst, size_t dst_capacity);
+
+  /**
+   * Decompress src into dst.
+   * @param src compressed buffer
+   * @param src_size size of the compressed buffer
+   * @param[out] dst output buffer
+   * @param dst_size expected size of the decompressed data
+   * @return true if src was well-formed and decompressed to exactly dst_size bytes
+   */
+  static bool Decompress(const char *src, size_t src_size, char *dst, size_t dst_size);
+
+ private:
+  static constexpr size_t MIN_MATCH = 4;
+  static constexpr size_t MAX_OFFSET = UINT16_MAX;
+  static constexpr int HASH_LOG = 12;
+
+  static uint32_t Hash(uint32_t sequence) { return (sequence * 2654435761U) >> (32 - HASH_LOG); }
+};
+
+}  // namespace bustub
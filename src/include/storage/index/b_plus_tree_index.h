@@ -16,6 +16,7 @@
 #include <string>
 #include <vector>
 
+#include "concurrency/key_range_lock.h"
 #include "storage/index/b_plus_tree.h"
 #include "storage/index/index.h"
 
@@ -26,7 +27,12 @@ namespace bustub {
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
  public:
-  BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager);
+  /**
+   * @param lock_manager if not nullptr, every transaction locks the keys it writes and SERIALIZABLE transactions also
+   * lock the keys they scan, see KeyRangeLockTable
+   */
+  BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                 LockManager *lock_manager = nullptr);
 
   void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
@@ -34,6 +40,16 @@ class BPlusTreeIndex : public Index {
 
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
+  /**
+   * Search the index for the keys from low_key to high_key, both included. A SERIALIZABLE transaction locks the range
+   * first, no key can be inserted into it or deleted from it until the transaction ends.
+   * @param low_key the first key, nullptr to start at the smallest
+   * @param high_key the last key, nullptr to go to the largest
+   * @param[out] result the RIDs of the keys in the range, in key order
+   */
+  void ScanRange(const Tuple *low_key, const Tuple *high_key, std::vector<RID> *result,
+                 Transaction *transaction) override;
+
   INDEXITERATOR_TYPE GetBeginIterator();
 
   INDEXITERATOR_TYPE GetBeginIterator(const KeyType &key);
@@ -45,6 +61,21 @@ class BPlusTreeIndex : public Index {
   KeyComparator comparator_;
   // container
   BPlusTree<KeyType, ValueType, KeyComparator> container_;
+
+ private:
+  /**
+   * @param write true for an insert or delete
+   * @return true if the transaction locks the key it reads or writes. A writer locks it whatever its own isolation
+   * level, a SERIALIZABLE scan would see a phantom otherwise.
+   */
+  bool LocksKeys(Transaction *transaction, bool write) const {
+    return lock_manager_ != nullptr && transaction != nullptr &&
+           (write || transaction->GetIsolationLevel() == IsolationLevel::SERIALIZABLE);
+  }
+
+  LockManager *lock_manager_;
+  // the keys written and the key ranges scanned by SERIALIZABLE transactions
+  KeyRangeLockTable<KeyType, KeyComparator> range_locks_;
 };
 
 }  // namespace bustub
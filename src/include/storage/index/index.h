@@ -18,6 +18,7 @@
 #include <vector>
 
 #include "catalog/schema.h"
+#include "common/exception.h"
 #include "storage/table/tuple.h"
 #include "type/value.h"
 
@@ -175,6 +176,19 @@ class Index {
    */
   virtual void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) = 0;
 
+  /**
+   * Search the index for the keys from low_key to high_key, both included.
+   * @param low_key The first key, nullptr to start at the smallest
+   * @param high_key The last key, nullptr to go to the largest
+   * @param result The collection of RIDs that is populated with results of the search, in key order
+   * @param transaction The transaction context
+   * @throw Exception if the index does not keep its keys in order
+   */
+  virtual void ScanRange(const Tuple *low_key, const Tuple *high_key, std::vector<RID> *result,
+                         Transaction *transaction) {
+    throw Exception(ExceptionType::NOT_IMPLEMENTED, "the index does not support range scans");
+  }
+
  private:
   /** The Index structure owns its metadata */
   std::unique_ptr<IndexMetadata> metadata_;
@@ -19,7 +19,7 @@ namespace bustub {
 
 #define B_PLUS_TREE_LEAF_PAGE_TYPE BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>
 #define LEAF_PAGE_HEADER_SIZE 28
-#define LEAF_PAGE_SIZE ((PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / sizeof(MappingType))
+#define LEAF_PAGE_SIZE (BPlusTreePageCapacity(LEAF_PAGE_HEADER_SIZE, sizeof(MappingType)))
 
 /**
  * Store indexed key and record id(record id = page id combined with slot id,
@@ -64,6 +64,8 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   void MoveLastToFrontOf(BPlusTreeLeafPage *recipient);
 
  private:
+  static_assert(LEAF_PAGE_HEADER_SIZE == sizeof(BPlusTreePage) + sizeof(page_id_t), "leaf page header size mismatch");
+
   void CopyNFrom(MappingType *items, int size);
   void CopyLastFrom(const MappingType &item);
   void CopyFirstFrom(const MappingType &item);
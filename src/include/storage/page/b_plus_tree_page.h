@@ -27,6 +27,11 @@ namespace bustub {
 // define page type enum
 enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
 
+/** @return the number of mapping_size entries that fit into a B+ tree page after a header of header_size bytes */
+constexpr int BPlusTreePageCapacity(size_t header_size, size_t mapping_size) {
+  return static_cast<int>((PAGE_SIZE - header_size) / mapping_size);
+}
+
 /**
  * Both internal and leaf page are inherited from this page.
  *
@@ -139,6 +139,9 @@ class HashTableBlockPage {
   void PrintBucket();
 
  private:
+  static_assert(2 * ((BLOCK_ARRAY_SIZE - 1) / 8 + 1) + BLOCK_ARRAY_SIZE * sizeof(MappingType) <= PAGE_SIZE,
+                "block page layout does not fit into PAGE_SIZE");
+
   std::atomic_char occupied_[(BLOCK_ARRAY_SIZE - 1) / 8 + 1];
 
   // 0 if tombstone/brand new (never occupied), 1 otherwise.
@@ -142,6 +142,8 @@ class HashTableBucketPage {
   void PrintBucket();
 
  private:
+  static_assert(2 * ((BUCKET_ARRAY_SIZE - 1) / 8 + 1) + BUCKET_ARRAY_SIZE * sizeof(MappingType) <= PAGE_SIZE,
+                "bucket page layout does not fit into PAGE_SIZE");
 
   //  For more on BUCKET_ARRAY_SIZE see storage/page/hash_table_page_defs.h
   char occupied_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];     // ͳͰеĲǷʹù,һ۱ֵʱӦλΪ1һξΪ1
@@ -12,8 +12,24 @@
 
 #pragma once
 
+#include <cstddef>
+
+#include "common/config.h"
+
 #define MappingType std::pair<KeyType, ValueType>
 
+namespace bustub {
+
+/**
+ * @return the number of (key, value) pairs of mapping_size bytes that fit into a hash table page of page_size bytes,
+ * given that every pair also needs two bits for its occupied_ and readable_ flags
+ */
+constexpr size_t HashTableArraySize(size_t page_size, size_t mapping_size) {
+  return 4 * page_size / (4 * mapping_size + 1);
+}
+
+}  // namespace bustub
+
 /**
  * Linear Probe Hashing Definitions
  */
@@ -26,7 +42,7 @@
  * 1) = PAGE_SIZE/(sizeof (MappingType) + 0.25) because 0.25 bytes = 2 bits is the space required to maintain the
  * occupied and readable flags for a key value pair.
  */
-#define BLOCK_ARRAY_SIZE (4 * PAGE_SIZE / (4 * sizeof(MappingType) + 1))
+#define BLOCK_ARRAY_SIZE (bustub::HashTableArraySize(PAGE_SIZE, sizeof(MappingType)))
 
 /**
  * Extendible Hashing Definitions
@@ -43,4 +59,4 @@
  * (MappingType) + 1) = (PAGE_SIZE - 4)/(sizeof (MappingType) + 0.25) because 0.25 bytes = 2 bits is the space required
  * to maintain the occupied and readable flags for a key value pair.
  */
-#define BUCKET_ARRAY_SIZE (4 * PAGE_SIZE / (4 * sizeof(MappingType) + 1))
+#define BUCKET_ARRAY_SIZE (bustub::HashTableArraySize(PAGE_SIZE, sizeof(MappingType)))
@@ -77,6 +77,15 @@ class Page {
   static constexpr size_t OFFSET_PAGE_START = 0;
   static constexpr size_t OFFSET_LSN = 4;
 
+  /**
+   * Which log partition logged the change with the page LSN, and the largest LSN of a change to the page that any
+   * other partition logged. Kept in memory only and only valid while tracked_lsn_ is the page LSN, see
+   * TablePage::LogChange().
+   */
+  int last_log_partition_ = -1;
+  lsn_t foreign_lsn_ = INVALID_LSN;
+  lsn_t tracked_lsn_ = INVALID_LSN;
+
  private:
   /** Zeroes out the data that is held within the page. */
   inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }
@@ -89,6 +98,11 @@ class Page {
   int pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
   bool is_dirty_ = false;
+  /**
+   * Recovery LSN, set when a clean page is pinned. No log record with a smaller LSN has changed the page since it was
+   * last written to disk. Only meaningful while the page is dirty or pinned.
+   */
+  lsn_t rec_lsn_ = INVALID_LSN;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
 };
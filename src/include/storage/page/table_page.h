@@ -13,6 +13,7 @@
 #pragma once
 
 #include <cstring>
+#include <vector>
 
 #include "common/rid.h"
 #include "concurrency/lock_manager.h"
@@ -53,6 +54,9 @@ class TablePage : public Page {
    */
   void Init(page_id_t page_id, uint32_t page_size, page_id_t prev_page_id, LogManager *log_manager, Transaction *txn);
 
+  /** @return the size of the largest tuple that fits into an empty page, i.e. PAGE_SIZE minus header and one slot */
+  static constexpr uint32_t MaxTupleSize() { return PAGE_SIZE - SIZE_TABLE_PAGE_HEADER - SIZE_TUPLE; }
+
   /** @return the page ID of this table page */
   page_id_t GetTablePageId() { return *reinterpret_cast<page_id_t *>(GetData()); }
 
@@ -79,9 +83,12 @@ class TablePage : public Page {
    * @param txn transaction performing the insert
    * @param lock_manager the lock manager
    * @param log_manager the log manager
+   * @param oid the table the page belongs to, for the lock manager. The caller escalates the row locks after it let go
+   * of the page latch, see LockManager::EscalateIfDue()
    * @return true if the insert is successful (i.e. there is enough space)
    */
-  bool InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager);
+  bool InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager,
+                   table_oid_t oid = INVALID_TABLE_OID);
 
   /**
    * Mark a tuple as deleted. This does not actually delete the tuple.
@@ -89,22 +96,37 @@ class TablePage : public Page {
    * @param txn transaction performing the delete
    * @param lock_manager the lock manager
    * @param log_manager the log manager
+   * @param oid the table the page belongs to, for the lock manager. The caller escalates the row locks after it let go
+   * of the page latch, see LockManager::EscalateIfDue()
    * @return true if marking the tuple as deleted is successful (i.e the tuple exists)
    */
-  bool MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager);
+  bool MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager,
+                  table_oid_t oid = INVALID_TABLE_OID);
 
   /**
-   * Update a tuple.
+   * Update a tuple. An update that keeps the size of the tuple only logs the bytes that changed.
    * @param new_tuple new value of the tuple
    * @param[out] old_tuple old value of the tuple
    * @param rid rid of the tuple
    * @param txn transaction performing the update
    * @param lock_manager the lock manager
    * @param log_manager the log manager
+   * @param oid the table the page belongs to, for the lock manager. The caller escalates the row locks after it let go
+   * of the page latch, see LockManager::EscalateIfDue()
    * @return true if updating the tuple succeeded
    */
   bool UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID &rid, Transaction *txn,
-                   LockManager *lock_manager, LogManager *log_manager);
+                   LockManager *lock_manager, LogManager *log_manager, table_oid_t oid = INVALID_TABLE_OID);
+
+  /**
+   * Overwrite byte ranges of a tuple in place, used to redo and undo DELTAUPDATE records.
+   * @param rid rid of the tuple
+   * @param tuple_size size of the tuple, which the update did not change
+   * @param ranges the byte ranges within the tuple
+   * @param bytes the content of all ranges, concatenated
+   * @return false if there is no tuple of this size at rid
+   */
+  bool PatchTuple(const RID &rid, uint32_t tuple_size, const std::vector<TupleDeltaRange> &ranges, const char *bytes);
 
   /** To be called on commit or abort. Actually perform the delete or rollback an insert. */
   void ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_manager);
@@ -118,24 +140,37 @@ class TablePage : public Page {
    * @param[out] tuple the tuple that was read
    * @param txn transaction performing the read
    * @param lock_manager the lock manager
+   * @param oid the table the page belongs to, for the lock manager. The caller escalates the row locks after it let go
+   * of the page latch, see LockManager::EscalateIfDue()
    * @return true if the read is successful (i.e. the tuple exists)
    */
-  bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager);
+  bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager,
+                table_oid_t oid = INVALID_TABLE_OID);
+
+  /**
+   * Read a tuple without locking it, for SNAPSHOT reads and for the version store.
+   * @param rid rid of the tuple to read
+   * @param[out] tuple the tuple that was read
+   * @return false if the slot is empty or the tuple is deleted
+   */
+  bool ReadTuple(const RID &rid, Tuple *tuple);
 
   /** @return the rid of the first tuple in this page */
 
   /**
    * @param[out] first_rid the RID of the first tuple in this page
+   * @param include_deleted true to also return deleted tuples and empty slots
    * @return true if the first tuple exists, false otherwise
    */
-  bool GetFirstTupleRid(RID *first_rid);
+  bool GetFirstTupleRid(RID *first_rid, bool include_deleted = false);
 
   /**
    * @param cur_rid the RID of the current tuple
    * @param[out] next_rid the RID of the tuple following the current tuple
+   * @param include_deleted true to also return deleted tuples and empty slots
    * @return true if the next tuple exists, false otherwise
    */
-  bool GetNextTupleRid(const RID &cur_rid, RID *next_rid);
+  bool GetNextTupleRid(const RID &cur_rid, RID *next_rid, bool include_deleted = false);
 
  private:
   static_assert(sizeof(page_id_t) == 4);
@@ -149,6 +184,13 @@ class TablePage : public Page {
   static constexpr size_t OFFSET_TUPLE_OFFSET = 24;  // Naming things is hard.
   static constexpr size_t OFFSET_TUPLE_SIZE = 28;
 
+  /**
+   * Set the page LSN to the LSN of a change the transaction just logged. The transaction then depends on the changes
+   * to this page that other log partitions logged before, see Transaction::GetCommitDependency(): its COMMIT record
+   * must not become persistent before them, redo could not replay the page otherwise.
+   */
+  void LogChange(lsn_t lsn, Transaction *txn, LogManager *log_manager);
+
   /** @return pointer to the end of the current free space, see header comment */
   uint32_t GetFreeSpacePointer() { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_FREE_SPACE); }
 
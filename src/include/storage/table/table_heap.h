@@ -48,9 +48,10 @@ class TableHeap {
    * @param lock_manager the lock manager
    * @param log_manager the log manager
    * @param txn the creating transaction
+   * @param oid the table's oid in the catalog, its row locks are taken as rows of that table
    */
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
-            Transaction *txn);
+            Transaction *txn, table_oid_t oid = INVALID_TABLE_OID);
 
   /**
    * Insert a tuple into the table. If the tuple is too large (>= page_size), return false.
@@ -83,7 +84,8 @@ class TableHeap {
   bool UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn);
 
   /**
-   * Called on Commit/Abort to actually delete a tuple or rollback an insert.
+   * Called on Commit/Abort to actually delete a tuple or rollback an insert. The row stays locked, the transaction
+   * releases it with its other locks once its COMMIT or ABORT record is logged.
    * @param rid rid of the tuple to delete
    * @param txn transaction performing the delete.
    */
@@ -102,9 +104,10 @@ class TableHeap {
    * @param rid rid of the tuple to read
    * @param tuple output variable for the tuple
    * @param txn transaction performing the read
+   * @param escalate false if the caller holds a page latch, it calls EscalateLocks() once it released the latch
    * @return true if the read was successful (i.e. the tuple exists)
    */
-  bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn);
+  bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, bool escalate = true);
 
   /** @return the begin iterator of this table */  //õTable
   TableIterator Begin(Transaction *txn);
@@ -115,11 +118,45 @@ class TableHeap {
   /** @return the id of the first page of this table */
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
+  /** @return the table's oid in the catalog */
+  inline table_oid_t GetOid() const { return oid_; }
+
+  /**
+   * Check that a row an optimistic transaction read is still the way it read it, and nobody else holds a lock to
+   * write it. A row changed and changed back counts as unchanged, the transaction could have read it either way.
+   * @param read the read to check
+   * @param txn the validating transaction, it holds the locks on the rows it writes
+   * @return true if the read is still valid
+   */
+  bool ValidateRead(const TableReadRecord &read, Transaction *txn);
+
  private:
+  /** @return true if txn is an optimistic transaction that buffers its writes, i.e. it has not validated yet */
+  static bool IsOptimistic(Transaction *txn);
+
+  /**
+   * Add an update or delete of an optimistic transaction to its buffered write set, Commit() installs it.
+   * @return false if the transaction does not see the row
+   */
+  bool BufferWrite(const RID &rid, WType wtype, const Tuple &tuple, Transaction *txn);
+
+  /**
+   * Before a SNAPSHOT transaction changes a row, lock it and make sure nobody changed it after the snapshot was taken.
+   * @param rid the row to change
+   * @param txn the writing transaction
+   * @return false if the row could not be locked
+   * @throws TransactionAbortException if the row was changed after the snapshot
+   */
+  bool CheckSnapshotWrite(const RID &rid, Transaction *txn);
+
+  /** Escalate the row locks that TablePage took under the page latch, see LockManager::EscalateIfDue(). */
+  void EscalateLocks(Transaction *txn);
+
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_{};
+  table_oid_t oid_{INVALID_TABLE_OID};
 };
 
 }  // namespace bustub
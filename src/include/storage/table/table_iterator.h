@@ -56,6 +56,14 @@ class TableIterator {
   }
 
  private:
+  /** @return true if the iterator reads a snapshot, see IsolationLevel::SNAPSHOT */
+  bool IsSnapshot() const { return txn_ != nullptr && txn_->GetIsolationLevel() == IsolationLevel::SNAPSHOT; }
+
+  /** @return true if the transaction may not see a tuple on the page, a snapshot or a buffered delete hides it */
+  bool MayHideTuples() const {
+    return IsSnapshot() || (txn_ != nullptr && txn_->GetConcurrencyControl() == ConcurrencyControl::OPTIMISTIC);
+  }
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
@@ -68,6 +68,9 @@ class Tuple {
   // deserialize tuple data(deep copy)   лԪ(ȸ)
   void DeserializeFrom(const char *storage);
 
+  // deserialize tuple data without copying it, the tuple points into storage, which must outlive it
+  void DeserializeViewFrom(const char *storage);
+
   // return RID of current tuple
   inline RID GetRid() const { return rid_; }
 
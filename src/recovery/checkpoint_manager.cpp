@@ -12,16 +12,93 @@
 
 #include "recovery/checkpoint_manager.h"
 
+#include <algorithm>
+
 namespace bustub {
 
+CheckpointManager::~CheckpointManager() { EndCheckpoint(); }
+
 void CheckpointManager::BeginCheckpoint() {
-  // Block all the transactions and ensure that both the WAL and all dirty buffer pool pages are persisted to disk,
-  // creating a consistent checkpoint. Do NOT allow transactions to resume at the end of this method, resume them
-  // in CheckpointManager::EndCheckpoint() instead. This is for grading purposes.
+  // the pages of the previous checkpoint may still be written
+  EndCheckpoint();
+  if (!enable_logging) {
+    // without a log there is nothing to recover from, only write the dirty pages back
+    flush_thread_ = std::thread(&CheckpointManager::FlushDirtyPages, this, buffer_pool_manager_->GetDirtyPageTable());
+    return;
+  }
+
+  LogPosition position;
+  position.offsets_ = log_manager_->GetLogOffsets(&position.lsn_);
+  LogRecord begin_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::BEGIN_CHECKPOINT);
+  lsn_t begin_lsn = log_manager_->AppendLogRecord(&begin_record);
+
+  // both tables are taken after BEGIN_CHECKPOINT, whatever they miss is logged after it
+  auto active_txn_table = transaction_manager_->GetActiveTransactionTable();
+  auto dirty_page_table = buffer_pool_manager_->GetDirtyPageTable();
+  lsn_t redo_lsn = begin_lsn;
+  for (const auto &[txn_id, first_lsn] : active_txn_table) {
+    redo_lsn = std::min(redo_lsn, first_lsn);
+  }
+  for (const auto &[page_id, rec_lsn] : dirty_page_table) {
+    redo_lsn = std::min(redo_lsn, rec_lsn);
+  }
+
+  // large tables are split over several records, each of them fits into a log buffer
+  const size_t max_entries = (LOG_BUFFER_SIZE - LogRecord::HEADER_SIZE - 2 * sizeof(int32_t)) / LogRecord::ENTRY_SIZE;
+  size_t txn_pos = 0;
+  size_t page_pos = 0;
+  lsn_t end_lsn;
+  do {
+    size_t num_txns = std::min(max_entries, active_txn_table.size() - txn_pos);
+    size_t num_pages = std::min(max_entries - num_txns, dirty_page_table.size() - page_pos);
+    LogRecord end_record({active_txn_table.begin() + txn_pos, active_txn_table.begin() + txn_pos + num_txns},
+                         {dirty_page_table.begin() + page_pos, dirty_page_table.begin() + page_pos + num_pages});
+    end_lsn = log_manager_->AppendLogRecord(&end_record);
+    txn_pos += num_txns;
+    page_pos += num_pages;
+  } while (txn_pos < active_txn_table.size() || page_pos < dirty_page_table.size());
+  log_manager_->FlushUntil(end_lsn);
+
+  // redo starts at the latest known position before redo_lsn. redo_lsn never decreases from one checkpoint to the
+  // next, so the positions before that one are not needed any more.
+  CheckpointMasterRecord master_record;
+  master_record.begin_lsn_ = begin_lsn;
+  master_record.end_lsn_ = end_lsn;
+  master_record.checkpoint_offsets_ = position.offsets_;
+  log_positions_.push_back(std::move(position));
+  auto iter = std::upper_bound(log_positions_.begin(), log_positions_.end(), redo_lsn,
+                               [](lsn_t lsn, const LogPosition &log_position) { return lsn < log_position.lsn_; });
+  if (iter == log_positions_.begin()) {
+    master_record.redo_offsets_.assign(master_record.checkpoint_offsets_.size(), 0);
+  } else {
+    --iter;
+    master_record.redo_offsets_ = iter->offsets_;
+    log_positions_.erase(log_positions_.begin(), iter);
+  }
+  log_manager_->WriteMasterRecord(master_record);
+  log_manager_->TruncateLog(master_record.redo_offsets_);
+
+  flush_thread_ = std::thread(&CheckpointManager::FlushDirtyPages, this, std::move(dirty_page_table));
 }
 
 void CheckpointManager::EndCheckpoint() {
-  // Allow transactions to resume, completing the checkpoint.
+  if (flush_thread_.joinable()) {
+    flush_thread_.join();
+  }
+}
+
+void CheckpointManager::FlushDirtyPages(std::vector<std::pair<page_id_t, lsn_t>> dirty_page_table) {
+  for (const auto &[page_id, rec_lsn] : dirty_page_table) {
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    if (page == nullptr) {
+      continue;
+    }
+    // transactions keep changing pages, the read latch keeps them from being written half-way through a change
+    page->RLatch();
+    buffer_pool_manager_->FlushPage(page_id);
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+  }
 }
 
 }  // namespace bustub
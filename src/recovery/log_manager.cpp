@@ -12,7 +12,55 @@
 
 #include "recovery/log_manager.h"
 
+#include <cstring>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "common/macros.h"
+
 namespace bustub {
+
+namespace {
+
+/** Write the entry count and the entries of an active transaction table or a dirty page table. */
+char *SerializeTable(char *pos, const std::vector<std::pair<int32_t, lsn_t>> &table) {
+  auto num_entries = static_cast<int32_t>(table.size());
+  memcpy(pos, &num_entries, sizeof(int32_t));
+  pos += sizeof(int32_t);
+  for (const auto &[id, lsn] : table) {
+    memcpy(pos, &id, sizeof(int32_t));
+    memcpy(pos + sizeof(int32_t), &lsn, sizeof(lsn_t));
+    pos += LogRecord::ENTRY_SIZE;
+  }
+  return pos;
+}
+
+}  // namespace
+
+LogManager::LogPartition::LogPartition(int index) : index_(index) {
+  // unpublished records are recognized by a zero size field
+  log_buffer_ = new char[LOG_BUFFER_SIZE]();
+  flush_buffer_ = new char[LOG_BUFFER_SIZE]();
+}
+
+LogManager::LogPartition::~LogPartition() {
+  delete[] log_buffer_;
+  delete[] flush_buffer_;
+  log_buffer_ = nullptr;
+  flush_buffer_ = nullptr;
+}
+
+LogManager::LogManager(DiskManager *disk_manager, int num_partitions) : next_lsn_(0), disk_manager_(disk_manager) {
+  BUSTUB_ASSERT(num_partitions > 0, "the log needs at least one partition");
+  disk_manager_->OpenLogPartitions(num_partitions);
+  for (int i = 0; i < num_partitions; i++) {
+    partitions_.emplace_back(std::make_unique<LogPartition>(i));
+  }
+}
+
+LogManager::~LogManager() = default;
+
 /*
  * set enable_logging = true
  * Start a separate thread to execute flush to disk operation periodically
@@ -21,34 +69,399 @@ namespace bustub {
  * a larger LSN than persistent LSN)
  *
  * This thread runs forever until system shutdown/StopFlushThread
+ * Every partition gets its own thread.
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  enable_logging = true;
+  for (auto &partition_ptr : partitions_) {
+    LogPartition *partition = partition_ptr.get();
+    std::scoped_lock lock(partition->latch_);
+    if (partition->flush_thread_ != nullptr) {
+      continue;
+    }
+    partition->flush_thread_ = new std::thread([this, partition] {
+      std::unique_lock<std::mutex> lock(partition->latch_);
+      while (true) {
+        auto timeout = std::min<std::chrono::steady_clock::time_point>(std::chrono::steady_clock::now() + log_timeout,
+                                                                       partition->flush_deadline_);
+        partition->cv_.wait_until(lock, timeout, [partition, timeout] {
+          return partition->need_flush_ || !enable_logging || partition->flush_deadline_ < timeout;
+        });
+        if (!partition->need_flush_ && enable_logging && std::chrono::steady_clock::now() < timeout) {
+          // an asynchronous commit brought the deadline forward, wait for it
+          continue;
+        }
+        // writes whatever is left on shutdown as well
+        FlushFilledPrefix(partition);
+        partition->need_flush_ = false;
+        partition->flush_deadline_ = std::chrono::steady_clock::time_point::max();
+        partition->flushed_cv_.notify_all();
+        if (!enable_logging) {
+          break;
+        }
+      }
+    });
+  }
+}
 
 /*
- * Stop and join the flush thread, set enable_logging = false
+ * Stop and join the flush threads, set enable_logging = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  enable_logging = false;
+  for (auto &partition : partitions_) {
+    {
+      // the flush thread is either waiting or will see enable_logging before it waits
+      std::scoped_lock lock(partition->latch_);
+      if (partition->flush_thread_ == nullptr) {
+        continue;
+      }
+    }
+    partition->cv_.notify_one();
+    partition->flush_thread_->join();
+    delete partition->flush_thread_;
+    partition->flush_thread_ = nullptr;
+  }
+}
 
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
  *
- *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
+ * The record is serialized as the 20 byte header followed by the type specific
+ * payload, see log_record.h. Its size is padded to 4 bytes so that the size
+ * field, which is stored last to publish the record, is always aligned.
+ */
+LogManager::LogReservation LogManager::ReserveLogRecord(txn_id_t txn_id, lsn_t prev_lsn,
+                                                       LogRecordType log_record_type, int32_t payload_size) {
+  const int32_t size =
+      (LogRecord::HEADER_SIZE + payload_size + sizeof(int32_t) - 1) & ~static_cast<int32_t>(sizeof(int32_t) - 1);
+  BUSTUB_ASSERT(size <= LOG_BUFFER_SIZE, "log record does not fit into the log buffer");
+  LogPartition *partition = partitions_[GetPartitionIndex(txn_id)].get();
+
+  // announce this appender before reading reservation_, see FlushFilledPrefix
+  partition->inflight_++;
+  uint64_t reservation;
+  int offset;
+  lsn_t lsn;
+  while (true) {
+    reservation = partition->reservation_.load();
+    uint64_t reserved = reservation & RESERVATION_OFFSET_MASK;
+    if (reserved == SEALED_OFFSET) {
+      std::this_thread::yield();
+      continue;
+    }
+    offset = static_cast<int>(reserved);
+    if (offset + size > LOG_BUFFER_SIZE) {
+      // whoever manages to mark the buffer as sealed swaps it
+      if (partition->reservation_.compare_exchange_strong(reservation, reservation | SEALED_OFFSET)) {
+        SealLogBuffer(partition, offset);
+      }
+      continue;
+    }
+    // the LSN must be taken after reading reservation_, so that the swap fails if a record with a larger LSN came first
+    lsn = next_lsn_.fetch_add(1);
+    if (partition->reservation_.compare_exchange_strong(reservation, reservation + size)) {
+      break;
+    }
+  }
+  partition->inflight_--;
+
+  // log_buffer_ cannot be swapped before this record is published, see SealLogBuffer
+  char *record = partition->log_buffer_ + offset;
+  memcpy(record + sizeof(int32_t), &lsn, sizeof(lsn_t));
+  memcpy(record + 2 * sizeof(int32_t), &txn_id, sizeof(txn_id_t));
+  memcpy(record + 3 * sizeof(int32_t), &prev_lsn, sizeof(lsn_t));
+  memcpy(record + 4 * sizeof(int32_t), &log_record_type, sizeof(LogRecordType));
+  return LogReservation{lsn, record + LogRecord::HEADER_SIZE, record, size};
+}
+
+void LogManager::PublishLogRecord(const LogReservation &reservation) {
+  __atomic_store_n(reinterpret_cast<int32_t *>(reservation.record_), reservation.size_, __ATOMIC_RELEASE);
+}
+
+lsn_t LogManager::AppendLogRecord(LogRecord *log_record) {
+  LogReservation reservation =
+      ReserveLogRecord(log_record->txn_id_, log_record->prev_lsn_, log_record->log_record_type_,
+                       log_record->size_ - LogRecord::HEADER_SIZE);
+  log_record->size_ = reservation.size_;
+  log_record->lsn_ = reservation.lsn_;
+  char *pos = reservation.payload_;
+
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      memcpy(pos, &log_record->insert_rid_, sizeof(RID));
+      log_record->insert_tuple_.SerializeTo(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(pos, &log_record->delete_rid_, sizeof(RID));
+      log_record->delete_tuple_.SerializeTo(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(pos, &log_record->update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.SerializeTo(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.SerializeTo(pos);
+      break;
+    case LogRecordType::DELTAUPDATE: {
+      auto num_ranges = static_cast<int32_t>(log_record->delta_ranges_.size());
+      memcpy(pos, &log_record->update_rid_, sizeof(RID));
+      memcpy(pos + sizeof(RID), &log_record->delta_tuple_size_, sizeof(int32_t));
+      memcpy(pos + sizeof(RID) + sizeof(int32_t), &num_ranges, sizeof(int32_t));
+      pos += sizeof(RID) + 2 * sizeof(int32_t);
+      memcpy(pos, log_record->delta_ranges_.data(), num_ranges * sizeof(TupleDeltaRange));
+      pos += num_ranges * sizeof(TupleDeltaRange);
+      memcpy(pos, log_record->delta_old_.data(), log_record->delta_old_.size());
+      memcpy(pos + log_record->delta_old_.size(), log_record->delta_new_.data(), log_record->delta_new_.size());
+      break;
+    }
+    case LogRecordType::NEWPAGE:
+      memcpy(pos, &log_record->prev_page_id_, sizeof(page_id_t));
+      memcpy(pos + sizeof(page_id_t), &log_record->page_id_, sizeof(page_id_t));
+      break;
+    case LogRecordType::END_CHECKPOINT:
+      pos = SerializeTable(pos, log_record->active_txn_table_);
+      SerializeTable(pos, log_record->dirty_page_table_);
+      break;
+    default:
+      break;
+  }
+  PublishLogRecord(reservation);
+  return log_record->lsn_;
+}
+
+lsn_t LogManager::AppendTupleLogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type,
+                                       const RID &rid, const char *tuple_data, uint32_t tuple_size) {
+  LogReservation reservation =
+      ReserveLogRecord(txn_id, prev_lsn, log_record_type, sizeof(RID) + sizeof(int32_t) + tuple_size);
+  char *pos = reservation.payload_;
+  memcpy(pos, &rid, sizeof(RID));
+  memcpy(pos + sizeof(RID), &tuple_size, sizeof(int32_t));
+  if (tuple_size > 0) {
+    memcpy(pos + sizeof(RID) + sizeof(int32_t), tuple_data, tuple_size);
+  }
+  PublishLogRecord(reservation);
+  return reservation.lsn_;
+}
+
+lsn_t LogManager::AppendUpdateLogRecord(txn_id_t txn_id, lsn_t prev_lsn, const RID &rid, const char *old_data,
+                                        uint32_t old_size, const char *new_data, uint32_t new_size) {
+  if (old_size != new_size) {
+    LogReservation reservation = ReserveLogRecord(txn_id, prev_lsn, LogRecordType::UPDATE,
+                                                  sizeof(RID) + 2 * sizeof(int32_t) + old_size + new_size);
+    char *pos = reservation.payload_;
+    memcpy(pos, &rid, sizeof(RID));
+    pos += sizeof(RID);
+    memcpy(pos, &old_size, sizeof(int32_t));
+    memcpy(pos + sizeof(int32_t), old_data, old_size);
+    pos += sizeof(int32_t) + old_size;
+    memcpy(pos, &new_size, sizeof(int32_t));
+    memcpy(pos + sizeof(int32_t), new_data, new_size);
+    PublishLogRecord(reservation);
+    return reservation.lsn_;
+  }
+
+  // one pass to size the record, a second one to write the ranges straight into the log buffer
+  const auto tuple_size = static_cast<int32_t>(old_size);
+  int32_t num_ranges = 0;
+  int32_t delta_size = 0;
+  ForEachTupleDelta(old_data, new_data, tuple_size, [&](const TupleDeltaRange &range) {
+    num_ranges++;
+    delta_size += range.length_;
+  });
+  LogReservation reservation =
+      ReserveLogRecord(txn_id, prev_lsn, LogRecordType::DELTAUPDATE,
+                       sizeof(RID) + 2 * sizeof(int32_t) + num_ranges * sizeof(TupleDeltaRange) + 2 * delta_size);
+  char *pos = reservation.payload_;
+  memcpy(pos, &rid, sizeof(RID));
+  memcpy(pos + sizeof(RID), &tuple_size, sizeof(int32_t));
+  memcpy(pos + sizeof(RID) + sizeof(int32_t), &num_ranges, sizeof(int32_t));
+  char *range_pos = pos + sizeof(RID) + 2 * sizeof(int32_t);
+  char *old_pos = range_pos + num_ranges * sizeof(TupleDeltaRange);
+  char *new_pos = old_pos + delta_size;
+  ForEachTupleDelta(old_data, new_data, tuple_size, [&](const TupleDeltaRange &range) {
+    memcpy(range_pos, &range, sizeof(TupleDeltaRange));
+    range_pos += sizeof(TupleDeltaRange);
+    memcpy(old_pos, old_data + range.offset_, range.length_);
+    old_pos += range.length_;
+    memcpy(new_pos, new_data + range.offset_, range.length_);
+    new_pos += range.length_;
+  });
+  PublishLogRecord(reservation);
+  return reservation.lsn_;
+}
+
+lsn_t LogManager::GetPersistentLSN() {
+  lsn_t persistent_lsn = partitions_[0]->persistent_lsn_;
+  for (auto &partition : partitions_) {
+    persistent_lsn = std::min(persistent_lsn, partition->persistent_lsn_.load());
+  }
+  return persistent_lsn;
+}
+
+void LogManager::SetPersistentLSN(lsn_t lsn) {
+  for (auto &partition : partitions_) {
+    partition->persistent_lsn_ = lsn;
+  }
+}
+
+std::vector<int64_t> LogManager::GetLogOffsets(lsn_t *next_lsn) {
+  std::vector<int64_t> offsets;
+  for (auto &partition : partitions_) {
+    // log writes happen under the latch, so the log never ends in the middle of a record
+    std::scoped_lock lock(partition->latch_);
+    offsets.push_back(disk_manager_->GetLogEnd(partition->index_));
+  }
+  // read after the offsets, a record that takes its LSN later cannot be in the files yet
+  *next_lsn = next_lsn_;
+  return offsets;
+}
+
+void LogManager::WriteMasterRecord(const CheckpointMasterRecord &master_record) {
+  std::vector<char> data = master_record.Serialize();
+  disk_manager_->WriteMasterRecord(data.data(), static_cast<int>(data.size()));
+}
+
+void LogManager::TruncateLog(const std::vector<int64_t> &offsets) {
+  for (auto &partition : partitions_) {
+    disk_manager_->TruncateLog(partition->index_, offsets[partition->index_]);
+  }
+}
+
+void LogManager::FlushUntil(lsn_t lsn, txn_id_t txn_id, lsn_t commit_dependency) {
+  // nothing beyond the last handed out LSN can ever become persistent
+  lsn = std::min(lsn, GetNextLSN() - 1);
+  if (txn_id != INVALID_TXN_ID) {
+    // the transaction may have read from an asynchronously committed one, or from one that released its locks early,
+    // or changed a page after a transaction of another partition. Those records have smaller LSNs and must be
+    // persistent first, the other partitions only have to get that far.
+    lsn_t dependency = std::min(std::max<lsn_t>(async_commit_lsn_, commit_dependency), lsn);
+    if (dependency > GetPersistentLSN()) {
+      for (auto &partition : partitions_) {
+        FlushPartitionUntil(partition.get(), dependency, true);
+      }
+      for (auto &partition : partitions_) {
+        FlushPartitionUntil(partition.get(), dependency, false);
+      }
+    }
+    FlushPartitionUntil(partitions_[GetPartitionIndex(txn_id)].get(), lsn, false);
+    return;
+  }
+  // wake up all flush threads first, so that the partitions are written in parallel
+  for (auto &partition : partitions_) {
+    FlushPartitionUntil(partition.get(), lsn, true);
+  }
+  for (auto &partition : partitions_) {
+    FlushPartitionUntil(partition.get(), lsn, false);
+  }
+}
+
+void LogManager::FlushAsync(lsn_t lsn, txn_id_t txn_id) {
+  lsn_t async_commit_lsn = async_commit_lsn_;
+  while (async_commit_lsn < lsn && !async_commit_lsn_.compare_exchange_weak(async_commit_lsn, lsn)) {
+  }
+  LogPartition *partition = partitions_[GetPartitionIndex(txn_id)].get();
+  std::scoped_lock lock(partition->latch_);
+  if (partition->persistent_lsn_ >= lsn || partition->flush_thread_ == nullptr) {
+    return;
+  }
+  auto deadline = std::chrono::steady_clock::now() + async_commit_delay;
+  if (deadline < partition->flush_deadline_) {
+    partition->flush_deadline_ = deadline;
+    partition->cv_.notify_one();
+  }
+}
+
+void LogManager::RequestFlush(lsn_t lsn) {
+  lsn = std::min(lsn, GetNextLSN() - 1);
+  for (auto &partition : partitions_) {
+    FlushPartitionUntil(partition.get(), lsn, true);
+  }
+}
+
+void LogManager::FlushPartitionUntil(LogPartition *partition, lsn_t lsn, bool kick_only) {
+  std::unique_lock<std::mutex> lock(partition->latch_);
+  while (partition->persistent_lsn_ < lsn) {
+    if (partition->flush_thread_ != nullptr) {
+      partition->need_flush_ = true;
+      partition->cv_.notify_one();
+      if (kick_only) {
+        return;
+      }
+      partition->flushed_cv_.wait(lock);
+    } else if (kick_only) {
+      return;
+    } else if (!FlushFilledPrefix(partition)) {
+      // the record is reserved but not published yet
+      lock.unlock();
+      std::this_thread::yield();
+      lock.lock();
+    }
+  }
+}
+
+int LogManager::ScanFilledPrefix(const char *buffer, int offset, lsn_t *last_lsn) {
+  while (offset + LogRecord::HEADER_SIZE <= LOG_BUFFER_SIZE) {
+    int32_t size = __atomic_load_n(reinterpret_cast<const int32_t *>(buffer + offset), __ATOMIC_ACQUIRE);
+    if (size == 0) {
+      break;
+    }
+    memcpy(last_lsn, buffer + offset + sizeof(int32_t), sizeof(lsn_t));
+    offset += size;
+  }
+  return offset;
+}
+
+/*
+ * Besides the written records, an idle partition also vouches for every LSN handed out so far: if nobody is between
+ * reading reservation_ and reserving space, every future record of this partition takes its LSN after next_lsn_ was
+ * read. The order of the loads matters, an appender that took a smaller LSN was announced in inflight_ before that
+ * and has reserved its space before it left.
  */
-lsn_t LogManager::AppendLogRecord(LogRecord *log_record) { return INVALID_LSN; }
+bool LogManager::FlushFilledPrefix(LogPartition *partition) {
+  lsn_t next_lsn = next_lsn_;
+  bool idle = partition->inflight_ == 0;
+  uint64_t reserved = partition->reservation_ & RESERVATION_OFFSET_MASK;
+
+  lsn_t last_lsn = INVALID_LSN;
+  int flushed_offset = partition->flushed_offset_;
+  int end = ScanFilledPrefix(partition->log_buffer_, flushed_offset, &last_lsn);
+  if (end != flushed_offset) {
+    disk_manager_->WriteLog(partition->log_buffer_ + flushed_offset, end - flushed_offset, partition->index_);
+    partition->flushed_offset_ = end;
+    partition->persistent_lsn_ = last_lsn;
+  }
+  if (idle && reserved == static_cast<uint64_t>(end) && partition->persistent_lsn_ < next_lsn - 1) {
+    partition->persistent_lsn_ = next_lsn - 1;
+  }
+  return end != flushed_offset;
+}
+
+void LogManager::SealLogBuffer(LogPartition *partition, int sealed_size) {
+  std::unique_lock<std::mutex> lock(partition->latch_);
+  // appenders that reserved space before the seal are still serializing
+  lsn_t last_lsn = INVALID_LSN;
+  while (ScanFilledPrefix(partition->log_buffer_, partition->flushed_offset_, &last_lsn) < sealed_size) {
+    std::this_thread::yield();
+  }
+
+  std::swap(partition->log_buffer_, partition->flush_buffer_);
+  int flush_offset = partition->flushed_offset_;
+  partition->flushed_offset_ = 0;
+  // reopen for appenders with the next generation, nobody else modifies a sealed reservation_
+  uint64_t generation = partition->reservation_ >> 32;
+  partition->reservation_ = (generation + 1) << 32;
+
+  if (sealed_size > flush_offset) {
+    disk_manager_->WriteLog(partition->flush_buffer_ + flush_offset, sealed_size - flush_offset, partition->index_);
+    partition->persistent_lsn_ = last_lsn;
+  }
+  memset(partition->flush_buffer_, 0, sealed_size);
+  partition->flushed_cv_.notify_all();
+}
 
 }  // namespace bustub
@@ -12,29 +12,599 @@
 
 #include "recovery/log_recovery.h"
 
+#include <condition_variable>  // NOLINT
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <queue>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "common/exception.h"
+#include "common/logger.h"
 #include "storage/page/table_page.h"
 
 namespace bustub {
+
+namespace {
+
+/** Number of records handed to a redo thread at once. */
+constexpr size_t REDO_BATCH_SIZE = 64;
+/** Number of batches a redo thread may lag behind before the reader waits for it. */
+constexpr size_t REDO_QUEUE_CAPACITY = 64;
+
+/** A record to replay on one page, the record stays in its mapped segment. */
+struct RedoTask {
+  const char *record_;
+  page_id_t page_id_;
+};
+
+/** Batches of redo tasks for one redo thread, in LSN order. */
+struct RedoQueue {
+  std::mutex latch_;
+  std::condition_variable cv_;
+  std::deque<std::vector<RedoTask>> batches_;
+  bool done_{false};
+};
+
+/**
+ * Read the entry count and the entries of an active transaction table or a dirty page table.
+ * @return the end of the table, nullptr if it does not end before end
+ */
+const char *DeserializeTable(const char *pos, const char *end, std::vector<std::pair<int32_t, lsn_t>> *table) {
+  int32_t num_entries;
+  if (pos + sizeof(int32_t) > end) {
+    return nullptr;
+  }
+  memcpy(&num_entries, pos, sizeof(int32_t));
+  pos += sizeof(int32_t);
+  if (num_entries < 0 || num_entries > (end - pos) / LogRecord::ENTRY_SIZE) {
+    return nullptr;
+  }
+  table->resize(num_entries);
+  for (auto &[id, lsn] : *table) {
+    memcpy(&id, pos, sizeof(int32_t));
+    memcpy(&lsn, pos + sizeof(int32_t), sizeof(lsn_t));
+    pos += LogRecord::ENTRY_SIZE;
+  }
+  return pos;
+}
+
+}  // namespace
+
+bool LogRecovery::DeserializeDelta(const char *pos, const char *end, LogRecord *log_record) {
+  int32_t num_ranges;
+  if (pos + sizeof(RID) + 2 * sizeof(int32_t) > end) {
+    return false;
+  }
+  memcpy(&log_record->update_rid_, pos, sizeof(RID));
+  memcpy(&log_record->delta_tuple_size_, pos + sizeof(RID), sizeof(int32_t));
+  memcpy(&num_ranges, pos + sizeof(RID) + sizeof(int32_t), sizeof(int32_t));
+  pos += sizeof(RID) + 2 * sizeof(int32_t);
+  if (num_ranges < 0 || num_ranges > (end - pos) / static_cast<int64_t>(sizeof(TupleDeltaRange))) {
+    return false;
+  }
+  log_record->delta_ranges_.resize(num_ranges);
+  memcpy(log_record->delta_ranges_.data(), pos, num_ranges * sizeof(TupleDeltaRange));
+  pos += num_ranges * sizeof(TupleDeltaRange);
+
+  int64_t num_bytes = 0;
+  for (const auto &range : log_record->delta_ranges_) {
+    if (range.offset_ < 0 || range.length_ <= 0 || range.offset_ + range.length_ > log_record->delta_tuple_size_) {
+      return false;
+    }
+    num_bytes += range.length_;
+  }
+  if (2 * num_bytes > end - pos) {
+    return false;
+  }
+  log_record->delta_old_.assign(pos, pos + num_bytes);
+  log_record->delta_new_.assign(pos + num_bytes, pos + 2 * num_bytes);
+  return true;
+}
+
 /*
  * deserialize a log record from log buffer
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
+ *
+ * The caller makes sure that the whole record, as announced by its size field,
+ * is in memory. The tuples of log_record are not copied, they point into data.
  */
-bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) { return false; }
+bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) {
+  int32_t size;
+  LogRecordType type;
+  memcpy(&size, data, sizeof(int32_t));
+  memcpy(&type, data + LogRecord::HEADER_SIZE - sizeof(LogRecordType), sizeof(LogRecordType));
+  if (size < LogRecord::HEADER_SIZE || size > LOG_BUFFER_SIZE || type <= LogRecordType::INVALID ||
+      type > LogRecordType::DELTAUPDATE) {
+    return false;
+  }
+  memcpy(reinterpret_cast<char *>(log_record), data, LogRecord::HEADER_SIZE);
+  const char *pos = data + LogRecord::HEADER_SIZE;
+  // log_record may be reused, do not carry the tables of a previous checkpoint record along
+  log_record->active_txn_table_.clear();
+  log_record->dirty_page_table_.clear();
+  log_record->delta_ranges_.clear();
+  log_record->delta_old_.clear();
+  log_record->delta_new_.clear();
+
+  switch (type) {
+    case LogRecordType::INSERT:
+      memcpy(&log_record->insert_rid_, pos, sizeof(RID));
+      log_record->insert_tuple_.DeserializeViewFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(&log_record->delete_rid_, pos, sizeof(RID));
+      log_record->delete_tuple_.DeserializeViewFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(&log_record->update_rid_, pos, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.DeserializeViewFrom(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.DeserializeViewFrom(pos);
+      break;
+    case LogRecordType::DELTAUPDATE:
+      if (!DeserializeDelta(pos, data + size, log_record)) {
+        return false;
+      }
+      break;
+    case LogRecordType::NEWPAGE:
+      memcpy(&log_record->prev_page_id_, pos, sizeof(page_id_t));
+      memcpy(&log_record->page_id_, pos + sizeof(page_id_t), sizeof(page_id_t));
+      break;
+    case LogRecordType::END_CHECKPOINT:
+      pos = DeserializeTable(pos, data + size, &log_record->active_txn_table_);
+      if (pos == nullptr || DeserializeTable(pos, data + size, &log_record->dirty_page_table_) == nullptr) {
+        return false;
+      }
+      break;
+    default:
+      break;
+  }
+  return true;
+}
+
+const LogRecovery::MappedSegment *LogRecovery::MapSegment(int partition, int64_t offset) {
+  auto key = std::make_pair(partition, disk_manager_->GetNextLogSegmentOffset(offset));
+  auto iter = segments_.find(key);
+  if (iter != segments_.end()) {
+    return &iter->second;
+  }
+  MappedSegment segment;
+  segment.data_ = disk_manager_->MapLogSegment(offset, partition, &segment.begin_, &segment.size_);
+  if (segment.data_ == nullptr) {
+    return nullptr;
+  }
+  return &segments_.emplace(key, segment).first->second;
+}
+
+void LogRecovery::UnmapSegments() {
+  for (const auto &[key, segment] : segments_) {
+    disk_manager_->UnmapLogSegment(segment.data_, segment.size_);
+  }
+  segments_.clear();
+}
+
+void LogRecovery::StartReading(PartitionReader *reader, int partition, int64_t offset) {
+  // the segments before the start of the log are gone, whatever recovery needs is in the ones after them
+  offset = std::max(offset, disk_manager_->GetLogBegin(partition));
+  reader->partition_ = partition;
+  reader->segment_ = MapSegment(partition, offset);
+  reader->pos_ = reader->segment_ == nullptr ? 0 : offset - reader->segment_->begin_;
+}
+
+const char *LogRecovery::NextLogRecord(PartitionReader *reader) {
+  while (reader->segment_ != nullptr) {
+    const MappedSegment &segment = *reader->segment_;
+    int32_t size = 0;
+    if (reader->pos_ + static_cast<int64_t>(sizeof(int32_t)) <= segment.size_) {
+      memcpy(&size, segment.data_ + reader->pos_, sizeof(int32_t));
+    }
+    // the records of a segment end at a zero size field, the log continues in the next segment if there is one
+    if (size == 0) {
+      reader->segment_ = MapSegment(reader->partition_, disk_manager_->GetNextLogSegmentOffset(segment.begin_));
+      reader->pos_ = 0;
+      continue;
+    }
+    if (size < LogRecord::HEADER_SIZE || reader->pos_ + size > segment.size_) {
+      LOG_DEBUG("corrupted log record, ignoring the rest of the log partition");
+      reader->segment_ = nullptr;
+      break;
+    }
+    const char *record = segment.data_ + reader->pos_;
+    reader->pos_ += size;
+    return record;
+  }
+  return nullptr;
+}
+
+bool LogRecovery::ReadNextLogRecord(PartitionReader *reader) {
+  reader->record_ = NextLogRecord(reader);
+  if (reader->record_ == nullptr) {
+    return false;
+  }
+  if (!DeserializeLogRecord(reader->record_, &reader->log_record_)) {
+    LOG_DEBUG("corrupted log record, ignoring the rest of the log partition");
+    reader->segment_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void LogRecovery::MergePartitions(const std::vector<int64_t> &offsets,
+                                  const std::function<bool(LogRecord *, const char *)> &visit) {
+  int num_partitions = disk_manager_->GetNumLogPartitions();
+  std::vector<PartitionReader> readers(num_partitions);
+  // min-heap of (LSN of the head record, partition)
+  using Head = std::pair<lsn_t, int>;
+  std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+  for (int i = 0; i < num_partitions; i++) {
+    StartReading(&readers[i], i, offsets[i]);
+    if (ReadNextLogRecord(&readers[i])) {
+      heads.emplace(readers[i].log_record_.GetLSN(), i);
+    }
+  }
+
+  while (!heads.empty()) {
+    PartitionReader &reader = readers[heads.top().second];
+    heads.pop();
+    if (!visit(&reader.log_record_, reader.record_)) {
+      return;
+    }
+    if (ReadNextLogRecord(&reader)) {
+      heads.emplace(reader.log_record_.GetLSN(), reader.partition_);
+    }
+  }
+}
+
+void LogRecovery::BuildLSNMapping() {
+  for (int i = 0; i < disk_manager_->GetNumLogPartitions(); i++) {
+    PartitionReader reader;
+    StartReading(&reader, i, i < static_cast<int>(redo_offsets_.size()) ? redo_offsets_[i] : 0);
+    // only the header of a record is needed to tell whether it is undone
+    for (const char *record = NextLogRecord(&reader); record != nullptr; record = NextLogRecord(&reader)) {
+      lsn_t lsn;
+      txn_id_t txn_id;
+      memcpy(&lsn, record + sizeof(int32_t), sizeof(lsn_t));
+      memcpy(&txn_id, record + sizeof(int32_t) + sizeof(lsn_t), sizeof(txn_id_t));
+      if (active_txn_.count(txn_id) > 0) {
+        lsn_mapping_[lsn] = record;
+      }
+    }
+  }
+}
+
+bool LogRecovery::AnalyzeCheckpoint(std::vector<int64_t> *redo_offsets, lsn_t *checkpoint_lsn,
+                                    std::unordered_map<page_id_t, lsn_t> *dirty_page_table) {
+  std::vector<char> data;
+  CheckpointMasterRecord master_record;
+  if (!disk_manager_->ReadMasterRecord(&data) || !master_record.Deserialize(data) ||
+      static_cast<int>(master_record.checkpoint_offsets_.size()) != disk_manager_->GetNumLogPartitions()) {
+    return false;
+  }
+
+  // the master record may be left over from another log, only trust it if the checkpoint is where it points to
+  bool found_begin = false;
+  bool found_end = false;
+  std::unordered_map<page_id_t, lsn_t> checkpoint_table;
+  MergePartitions(master_record.checkpoint_offsets_, [&](LogRecord *log_record, const char * /*record*/) {
+    lsn_t lsn = log_record->GetLSN();
+    if (lsn == master_record.begin_lsn_) {
+      found_begin = log_record->GetLogRecordType() == LogRecordType::BEGIN_CHECKPOINT;
+    } else if (found_begin && lsn <= master_record.end_lsn_ &&
+               log_record->GetLogRecordType() == LogRecordType::END_CHECKPOINT) {
+      checkpoint_table.insert(log_record->GetDirtyPageTable().begin(), log_record->GetDirtyPageTable().end());
+      found_end = lsn == master_record.end_lsn_;
+    }
+    return lsn < master_record.end_lsn_;
+  });
+  if (!found_end) {
+    LOG_DEBUG("the master record does not match the log, recovering from the beginning of the log");
+    return false;
+  }
+  *redo_offsets = std::move(master_record.redo_offsets_);
+  *checkpoint_lsn = master_record.begin_lsn_;
+  *dirty_page_table = std::move(checkpoint_table);
+  return true;
+}
 
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
  *read log file from the beginning to end (you must prefetch log records into
  *log buffer to reduce unnecessary I/O operations), remember to compare page's
- *LSN with log_record's sequence number, and also build active_txn_ table &
- *lsn_mapping_ table
+ *LSN with log_record's sequence number, and also build active_txn_ table,
+ *Undo() builds the lsn_mapping_ table for the transactions left in it
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo() {
+  std::vector<int64_t> offsets(disk_manager_->GetNumLogPartitions(), 0);
+  lsn_t checkpoint_lsn = INVALID_LSN;
+  std::unordered_map<page_id_t, lsn_t> dirty_page_table;
+  AnalyzeCheckpoint(&offsets, &checkpoint_lsn, &dirty_page_table);
+  // every other page was on disk with all changes logged before the checkpoint
+  auto needs_redo = [&](page_id_t page_id, lsn_t lsn) {
+    if (lsn >= checkpoint_lsn) {
+      return true;
+    }
+    auto iter = dirty_page_table.find(page_id);
+    return iter != dirty_page_table.end() && lsn >= iter->second;
+  };
+
+  const size_t num_threads = std::max(num_redo_threads_, 1);
+  std::vector<RedoQueue> queues(num_threads);
+  std::vector<std::vector<RedoTask>> pending(num_threads);
+  std::vector<std::thread> threads;
+  // the first error of a redo thread, it keeps taking batches so that the reader does not wait for it forever
+  std::mutex error_latch;
+  std::exception_ptr error;
+  if (num_threads > 1) {
+    for (auto &queue : queues) {
+      threads.emplace_back([this, &queue, &error_latch, &error] {
+        LogRecord log_record;
+        while (true) {
+          std::vector<RedoTask> batch;
+          {
+            std::unique_lock<std::mutex> lock(queue.latch_);
+            queue.cv_.wait(lock, [&queue] { return !queue.batches_.empty() || queue.done_; });
+            if (queue.batches_.empty()) {
+              return;
+            }
+            batch = std::move(queue.batches_.front());
+            queue.batches_.pop_front();
+          }
+          queue.cv_.notify_all();
+          // the reader already checked every record
+          try {
+            for (const auto &task : batch) {
+              DeserializeLogRecord(task.record_, &log_record);
+              RedoLogRecord(&log_record, task.page_id_);
+            }
+          } catch (...) {
+            std::scoped_lock lock(error_latch);
+            if (error == nullptr) {
+              error = std::current_exception();
+            }
+          }
+        }
+      });
+    }
+  }
+  auto dispatch = [&](LogRecord *log_record, const char *record, page_id_t page_id) {
+    if (!needs_redo(page_id, log_record->GetLSN())) {
+      return;
+    }
+    if (num_threads == 1) {
+      RedoLogRecord(log_record, page_id);
+      return;
+    }
+    size_t index = static_cast<uint32_t>(page_id) % num_threads;
+    pending[index].push_back(RedoTask{record, page_id});
+    if (pending[index].size() < REDO_BATCH_SIZE) {
+      return;
+    }
+    RedoQueue &queue = queues[index];
+    {
+      std::unique_lock<std::mutex> lock(queue.latch_);
+      queue.cv_.wait(lock, [&queue] { return queue.batches_.size() < REDO_QUEUE_CAPACITY; });
+      queue.batches_.push_back(std::move(pending[index]));
+    }
+    queue.cv_.notify_all();
+    pending[index].clear();
+  };
+
+  redo_offsets_ = offsets;
+  MergePartitions(offsets, [&](LogRecord *log_record, const char *record) {
+    // checkpoint records do not belong to a transaction
+    if (log_record->GetTxnId() == INVALID_TXN_ID) {
+      return true;
+    }
+    if (log_record->GetLogRecordType() == LogRecordType::COMMIT ||
+        log_record->GetLogRecordType() == LogRecordType::ABORT) {
+      active_txn_.erase(log_record->GetTxnId());
+    } else {
+      active_txn_[log_record->GetTxnId()] = log_record->GetLSN();
+    }
+    page_id_t page_id = GetPageId(log_record);
+    if (page_id != INVALID_PAGE_ID) {
+      dispatch(log_record, record, page_id);
+    }
+    if (log_record->GetLogRecordType() == LogRecordType::NEWPAGE && log_record->GetNewPageRecord() != INVALID_PAGE_ID) {
+      dispatch(log_record, record, log_record->GetNewPageRecord());
+    }
+    return true;
+  });
+
+  for (size_t i = 0; i < threads.size(); i++) {
+    {
+      std::scoped_lock lock(queues[i].latch_);
+      if (!pending[i].empty()) {
+        queues[i].batches_.push_back(std::move(pending[i]));
+      }
+      queues[i].done_ = true;
+    }
+    queues[i].cv_.notify_all();
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
+ *
+ * The records of all loser transactions are undone in reverse LSN order.
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Undo() {
+  if (!active_txn_.empty()) {
+    BuildLSNMapping();
+  }
+  std::priority_queue<lsn_t> lsns;
+  for (const auto &[txn_id, lsn] : active_txn_) {
+    lsns.push(lsn);
+  }
+  LogRecord log_record;
+  while (!lsns.empty()) {
+    lsn_t lsn = lsns.top();
+    lsns.pop();
+    auto iter = lsn_mapping_.find(lsn);
+    if (iter == lsn_mapping_.end()) {
+      LOG_DEBUG("undo reached a log record that is not in the log");
+      continue;
+    }
+    if (!DeserializeLogRecord(iter->second, &log_record)) {
+      LOG_DEBUG("corrupted log record during undo");
+      continue;
+    }
+    UndoLogRecord(&log_record);
+    if (log_record.GetPrevLSN() != INVALID_LSN) {
+      lsns.push(log_record.GetPrevLSN());
+    }
+  }
+  active_txn_.clear();
+  lsn_mapping_.clear();
+  UnmapSegments();
+}
+
+page_id_t LogRecovery::GetPageId(LogRecord *log_record) {
+  switch (log_record->GetLogRecordType()) {
+    case LogRecordType::INSERT:
+      return log_record->GetInsertRID().GetPageId();
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      return log_record->GetDeleteRID().GetPageId();
+    case LogRecordType::UPDATE:
+    case LogRecordType::DELTAUPDATE:
+      return log_record->GetUpdateRID().GetPageId();
+    case LogRecordType::NEWPAGE:
+      return log_record->page_id_;
+    default:
+      return INVALID_PAGE_ID;
+  }
+}
+
+void LogRecovery::RedoLogRecord(LogRecord *log_record, page_id_t page_id) {
+  if (log_record->GetLogRecordType() == LogRecordType::NEWPAGE && page_id != log_record->page_id_) {
+    // link the page before the new one, the link itself is not logged, so this does not depend on the page's LSN
+    auto *prev_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (prev_page == nullptr) {
+      LOG_DEBUG("cannot fetch page %d for redo", page_id);
+      return;
+    }
+    bool relink = prev_page->GetNextPageId() != log_record->page_id_;
+    if (relink) {
+      prev_page->SetNextPageId(log_record->page_id_);
+    }
+    buffer_pool_manager_->UnpinPage(page_id, relink);
+    return;
+  }
+
+  auto *page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  if (page == nullptr) {
+    LOG_DEBUG("cannot fetch page %d for redo", page_id);
+    return;
+  }
+  // the page on disk already contains the change
+  if (page->GetLSN() >= log_record->GetLSN()) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return;
+  }
+  switch (log_record->GetLogRecordType()) {
+    case LogRecordType::INSERT: {
+      RID rid;
+      page->InsertTuple(log_record->GetInsertTuple(), &rid, nullptr, nullptr, nullptr);
+      // the records after this one name the tuple by its logged RID, they would change another one
+      if (!(rid == log_record->GetInsertRID())) {
+        buffer_pool_manager_->UnpinPage(page_id, false);
+        throw Exception("redo inserted into a different slot than the logged one, the log is missing a record");
+      }
+      break;
+    }
+    case LogRecordType::MARKDELETE:
+      page->MarkDelete(log_record->GetDeleteRID(), nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE:
+      page->ApplyDelete(log_record->GetDeleteRID(), nullptr, nullptr);
+      break;
+    case LogRecordType::ROLLBACKDELETE:
+      page->RollbackDelete(log_record->GetDeleteRID(), nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE: {
+      Tuple old_tuple;
+      page->UpdateTuple(log_record->GetUpdateTuple(), &old_tuple, log_record->GetUpdateRID(), nullptr, nullptr,
+                        nullptr);
+      break;
+    }
+    case LogRecordType::DELTAUPDATE:
+      if (!page->PatchTuple(log_record->GetUpdateRID(), log_record->GetDeltaTupleSize(), log_record->GetDeltaRanges(),
+                            log_record->GetDeltaNewBytes().data())) {
+        buffer_pool_manager_->UnpinPage(page_id, false);
+        throw Exception("redo found no tuple of the logged size to update, the log is missing a record");
+      }
+      break;
+    case LogRecordType::NEWPAGE:
+      page->Init(page_id, PAGE_SIZE, log_record->GetNewPageRecord(), nullptr, nullptr);
+      break;
+    default:
+      break;
+  }
+  page->SetLSN(log_record->GetLSN());
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+void LogRecovery::UndoLogRecord(LogRecord *log_record) {
+  // BEGIN has nothing to undo, a NEWPAGE stays linked into the table heap
+  if (log_record->GetLogRecordType() == LogRecordType::NEWPAGE) {
+    return;
+  }
+  page_id_t page_id = GetPageId(log_record);
+  if (page_id == INVALID_PAGE_ID) {
+    return;
+  }
+
+  auto *page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  if (page == nullptr) {
+    LOG_DEBUG("cannot fetch page %d for undo", page_id);
+    return;
+  }
+  switch (log_record->GetLogRecordType()) {
+    case LogRecordType::INSERT:
+      page->ApplyDelete(log_record->GetInsertRID(), nullptr, nullptr);
+      break;
+    case LogRecordType::MARKDELETE:
+      page->RollbackDelete(log_record->GetDeleteRID(), nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE: {
+      RID rid;
+      page->InsertTuple(log_record->GetDeleteTuple(), &rid, nullptr, nullptr, nullptr);
+      break;
+    }
+    case LogRecordType::ROLLBACKDELETE:
+      page->MarkDelete(log_record->GetDeleteRID(), nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE: {
+      Tuple new_tuple;
+      page->UpdateTuple(log_record->GetOriginalTuple(), &new_tuple, log_record->GetUpdateRID(), nullptr, nullptr,
+                        nullptr);
+      break;
+    }
+    case LogRecordType::DELTAUPDATE:
+      page->PatchTuple(log_record->GetUpdateRID(), log_record->GetDeltaTupleSize(), log_record->GetDeltaRanges(),
+                       log_record->GetDeltaOldBytes().data());
+      break;
+    default:
+      break;
+  }
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
 
 }  // namespace bustub
@@ -10,10 +10,18 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <cctype>
+#include <cstdio>
 #include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <map>
 #include <mutex>  // NOLINT
 #include <string>
 #include <thread>  // NOLINT
@@ -21,37 +29,62 @@
 #include "common/exception.h"
 #include "common/logger.h"
 #include "storage/disk/disk_manager.h"
+#include "storage/disk/page_compressor.h"
 
 namespace bustub {
 
-static char *buffer_used;
+static constexpr uint32_t SLOT_MAGIC = 0x50535442;  // "BTSP"
+
+/** On-disk header of a compressed page slot, see DiskManager. */
+struct SlotHeader {
+  uint32_t magic_;
+  page_id_t page_id_;
+  uint32_t capacity_;
+  uint32_t size_;
+  uint64_t seq_;
+};
+
+/** On-disk header of a log segment, see DiskManager. */
+struct LogSegmentHeader {
+  uint32_t magic_;
+  int32_t partition_;
+  int64_t segment_;
+};
+
+/** Segment numbers in file names are padded to this many digits. */
+static constexpr size_t LOG_SEGMENT_DIGITS = 8;
+
+/** Make a file created or renamed in the directory of the given file survive a crash. */
+static void SyncDirectory(const std::string &file_name) {
+  std::string dir = std::filesystem::path(file_name).parent_path().string();
+  int fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0 || fsync(fd) != 0) {
+    LOG_DEBUG("I/O error while syncing directory");
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
 
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, bool enable_compression)
+    : log_segment_size_(log_segment_size),
+      file_name_(db_file),
+      num_flushes_(0),
+      num_writes_(0),
+      flush_log_(false),
+      flush_log_f_(nullptr),
+      enable_compression_(enable_compression) {
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
-
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app | std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-    if (!log_io_.is_open()) {
-      throw Exception("can't open dblog file");
-    }
-  }
+  LoadLogSegments();
 
   std::scoped_lock scoped_db_io_latch(db_io_latch_);
   db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
@@ -67,7 +100,11 @@ DiskManager::DiskManager(const std::string &db_file)
       throw Exception("can't open db file");
     }
   }
-  buffer_used = nullptr;
+  if (enable_compression_) {
+    free_slots_.resize((sizeof(SlotHeader) + PAGE_SIZE) / SLOT_ALIGNMENT + 2);
+    slot_buffer_.resize(sizeof(SlotHeader) + PAGE_SIZE);
+    LoadPageSlots();
+  }
 }
 
 /**
@@ -78,7 +115,162 @@ void DiskManager::ShutDown() {
     std::scoped_lock scoped_db_io_latch(db_io_latch_);
     db_io_.close();
   }
-  log_io_.close();
+  for (auto &segments : log_segments_) {
+    std::scoped_lock lock(segments->latch_);
+    for (int *fd : {&segments->write_fd_, &segments->read_fd_}) {
+      if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+      }
+    }
+    segments->read_segment_ = -1;
+  }
+}
+
+/**
+ * Open the log partitions that are not open yet
+ */
+void DiskManager::OpenLogPartitions(int num_partitions) {
+  while (GetNumLogPartitions() < num_partitions) {
+    log_segments_.push_back(std::make_unique<LogSegments>());
+  }
+}
+
+std::string DiskManager::GetLogFileName(int partition) const {
+  return partition == 0 ? log_name_ : log_name_ + "." + std::to_string(partition);
+}
+
+std::string DiskManager::GetLogSegmentName(int partition, int64_t segment) const {
+  std::string number = std::to_string(segment);
+  if (number.size() < LOG_SEGMENT_DIGITS) {
+    number.insert(0, LOG_SEGMENT_DIGITS - number.size(), '0');
+  }
+  return GetLogFileName(partition) + "." + number;
+}
+
+int64_t DiskManager::GetLogSegmentCapacity() const {
+  return log_segment_size_ - static_cast<int64_t>(sizeof(LogSegmentHeader));
+}
+
+/**
+ * Collect the segment files of every partition by name. A segment is live if its header names it, any other file is
+ * a recycled segment. The last live segment may end with a torn write, so writing continues in a new segment.
+ */
+void DiskManager::LoadLogSegments() {
+  namespace fs = std::filesystem;
+  auto all_digits = [](const std::string &str) {
+    return !str.empty() && std::all_of(str.begin(), str.end(), [](char c) { return std::isdigit(c) != 0; });
+  };
+
+  // segment numbers of every partition
+  std::map<int, std::vector<int64_t>> files;
+  fs::path log_path(log_name_);
+  fs::path dir = log_path.has_parent_path() ? log_path.parent_path() : fs::path(".");
+  std::string prefix = log_path.filename().string() + ".";
+  std::error_code ec;
+  for (const auto &entry : fs::directory_iterator(dir, ec)) {
+    std::string name = entry.path().filename().string();
+    if (name.compare(0, prefix.size(), prefix) != 0) {
+      continue;
+    }
+    std::string number = name.substr(prefix.size());
+    int partition = 0;
+    size_t dot = number.find('.');
+    if (dot != std::string::npos) {
+      if (!all_digits(number.substr(0, dot))) {
+        continue;
+      }
+      partition = std::stoi(number.substr(0, dot));
+      number = number.substr(dot + 1);
+    }
+    if (number.size() < LOG_SEGMENT_DIGITS || !all_digits(number)) {
+      continue;
+    }
+    files[partition].push_back(std::stoll(number));
+  }
+
+  OpenLogPartitions(files.empty() ? 1 : files.rbegin()->first + 1);
+  for (auto &[partition, numbers] : files) {
+    LogSegments &segments = *log_segments_[partition];
+    std::sort(numbers.begin(), numbers.end());
+    std::vector<int64_t> live;
+    for (int64_t segment : numbers) {
+      std::string name = GetLogSegmentName(partition, segment);
+      LogSegmentHeader header{};
+      int fd = open(name.c_str(), O_RDONLY);
+      bool valid = fd >= 0 && pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+                   header.magic_ == LOG_SEGMENT_MAGIC && header.partition_ == partition && header.segment_ == segment;
+      if (fd >= 0) {
+        close(fd);
+      }
+      if (valid) {
+        live.push_back(segment);
+        // the segments were preallocated with the size they were written with
+        log_segment_size_ = GetFileSize(name);
+      } else {
+        segments.spare_.push_back(segment);
+      }
+    }
+    if (!live.empty()) {
+      segments.first_ = live.front();
+      segments.last_ = live.back();
+      segments.write_offset_ = (segments.last_ + 1) * GetLogSegmentCapacity();
+    }
+  }
+  if (GetLogSegmentCapacity() < LOG_BUFFER_SIZE) {
+    throw Exception("a log segment must hold a full log buffer");
+  }
+}
+
+/**
+ * Caller must hold the latch of the segments
+ */
+void DiskManager::StartLogSegment(int partition, LogSegments *segments) {
+  int64_t segment = segments->last_ + 1;
+  std::string name = GetLogSegmentName(partition, segment);
+  bool reused = false;
+  if (!segments->spare_.empty()) {
+    auto spare = std::find(segments->spare_.begin(), segments->spare_.end(), segment);
+    if (spare == segments->spare_.end()) {
+      spare = segments->spare_.begin();
+      reused = std::rename(GetLogSegmentName(partition, *spare).c_str(), name.c_str()) == 0;
+    } else {
+      reused = true;
+    }
+    segments->spare_.erase(spare);
+  }
+
+  int fd = open(name.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    throw Exception("can't open log segment");
+  }
+  if (reused) {
+    segments->num_recycled_++;
+  } else if (posix_fallocate(fd, 0, log_segment_size_) != 0 && ftruncate(fd, log_segment_size_) != 0) {
+    LOG_DEBUG("could not preallocate log segment");
+  }
+  // the header is followed by a zero size field, a reused segment still holds the records of its previous life
+  char header[sizeof(LogSegmentHeader) + sizeof(int32_t)] = {0};
+  LogSegmentHeader segment_header{LOG_SEGMENT_MAGIC, partition, segment};
+  memcpy(header, &segment_header, sizeof(segment_header));
+  if (pwrite(fd, header, sizeof(header), 0) != sizeof(header)) {
+    LOG_DEBUG("I/O error while writing log segment header");
+  }
+  // the records of the segment are synced with the data only, its name and size have to be on disk before
+  if (fsync(fd) != 0) {
+    LOG_DEBUG("I/O error while syncing log segment");
+  }
+  SyncDirectory(name);
+
+  if (segments->write_fd_ >= 0) {
+    close(segments->write_fd_);
+  }
+  segments->write_fd_ = fd;
+  if (segments->last_ < segments->first_) {
+    segments->first_ = segment;
+  }
+  segments->last_ = segment;
+  segments->write_offset_ = segment * GetLogSegmentCapacity();
 }
 
 /**
@@ -86,9 +278,14 @@ void DiskManager::ShutDown() {
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
   std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  if (enable_compression_) {
+    WriteCompressedPage(page_id, page_data);
+    return;
+  }
   size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
   // set write cursor to offset
   num_writes_ += 1;
+  num_bytes_written_ += PAGE_SIZE;
   db_io_.seekp(offset);
   db_io_.write(page_data, PAGE_SIZE);
   // check for I/O error
@@ -105,11 +302,17 @@ void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
   std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  int offset = page_id * PAGE_SIZE;
+  if (enable_compression_) {
+    ReadCompressedPage(page_id, page_data);
+    return;
+  }
+  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
   // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
+  if (static_cast<int64_t>(offset) > GetFileSize(file_name_)) {
     LOG_DEBUG("I/O error reading past end of file");
     // std::cerr << "I/O error while reading" << std::endl;
+    // a page that was allocated but never written, e.g. when recovery replays its creation
+    memset(page_data, 0, PAGE_SIZE);
   } else {
     // set read cursor to offset
     db_io_.seekp(offset);
@@ -120,6 +323,7 @@ void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
     }
     // if file ends before reading PAGE_SIZE
     int read_count = db_io_.gcount();
+    num_bytes_read_ += read_count;
     if (read_count < PAGE_SIZE) {
       LOG_DEBUG("Read less than a page");
       db_io_.clear();
@@ -129,14 +333,138 @@ void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
   }
 }
 
+/**
+ * Compress the page and write it into its slot, moving it to a larger slot if it no longer fits.
+ * Caller must hold db_io_latch_.
+ */
+void DiskManager::WriteCompressedPage(page_id_t page_id, const char *page_data) {
+  char *payload = slot_buffer_.data() + sizeof(SlotHeader);
+  // anything that does not save at least a byte is stored raw, so that Size == PAGE_SIZE means uncompressed
+  uint32_t size = PageCompressor::Compress(page_data, PAGE_SIZE, payload, PAGE_SIZE - 1);
+  if (size == 0) {
+    memcpy(payload, page_data, PAGE_SIZE);
+    size = PAGE_SIZE;
+  }
+  uint32_t capacity = (sizeof(SlotHeader) + size + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+
+  auto iter = page_slots_.find(page_id);
+  if (iter == page_slots_.end()) {
+    iter = page_slots_.emplace(page_id, PageSlot{AllocateSlot(capacity), capacity, size}).first;
+  } else if (iter->second.capacity_ < capacity) {
+    // the new slot carries a newer sequence number, so the old one is ignored on reopen even before it is reused
+    free_slots_[iter->second.capacity_ / SLOT_ALIGNMENT].push_back(iter->second.offset_);
+    iter->second = PageSlot{AllocateSlot(capacity), capacity, size};
+  } else {
+    iter->second.size_ = size;
+  }
+  PageSlot &slot = iter->second;
+
+  SlotHeader header{SLOT_MAGIC, page_id, slot.capacity_, size, ++slot_seq_};
+  memcpy(slot_buffer_.data(), &header, sizeof(header));
+
+  num_writes_ += 1;
+  num_bytes_written_ += sizeof(SlotHeader) + size;
+  db_io_.seekp(slot.offset_);
+  db_io_.write(slot_buffer_.data(), sizeof(SlotHeader) + size);
+  if (db_io_.bad()) {
+    LOG_DEBUG("I/O error while writing");
+    return;
+  }
+  db_io_.flush();
+}
+
+/**
+ * Read the slot of the page and decompress it into page_data. Pages that were never written read as zeros.
+ * Caller must hold db_io_latch_.
+ */
+void DiskManager::ReadCompressedPage(page_id_t page_id, char *page_data) {
+  auto iter = page_slots_.find(page_id);
+  if (iter == page_slots_.end()) {
+    LOG_DEBUG("I/O error reading a page that was never written");
+    memset(page_data, 0, PAGE_SIZE);
+    return;
+  }
+  const PageSlot &slot = iter->second;
+  char *payload = slot.size_ == PAGE_SIZE ? page_data : slot_buffer_.data();
+
+  db_io_.seekp(slot.offset_ + sizeof(SlotHeader));
+  db_io_.read(payload, slot.size_);
+  if (db_io_.bad()) {
+    LOG_DEBUG("I/O error while reading");
+    return;
+  }
+  num_bytes_read_ += slot.size_;
+  if (payload != page_data && !PageCompressor::Decompress(payload, slot.size_, page_data, PAGE_SIZE)) {
+    LOG_DEBUG("corrupted compressed page");
+    memset(page_data, 0, PAGE_SIZE);
+  }
+}
+
+size_t DiskManager::AllocateSlot(uint32_t capacity) {
+  auto &free_list = free_slots_[capacity / SLOT_ALIGNMENT];
+  if (!free_list.empty()) {
+    size_t offset = free_list.back();
+    free_list.pop_back();
+    return offset;
+  }
+  size_t offset = file_end_;
+  file_end_ += capacity;
+  return offset;
+}
+
+/**
+ * Scan all slot headers. For every page the slot with the highest sequence number wins, the others are recycled.
+ * A torn slot at the end of the file (crash during append) ends the scan. Caller must hold db_io_latch_.
+ */
+void DiskManager::LoadPageSlots() {
+  std::unordered_map<page_id_t, uint64_t> page_seqs;
+  int64_t file_size = GetFileSize(file_name_);
+  size_t offset = 0;
+  SlotHeader header;
+
+  while (static_cast<int64_t>(offset + sizeof(SlotHeader)) <= file_size) {
+    db_io_.seekp(offset);
+    db_io_.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (db_io_.gcount() != sizeof(header) || header.magic_ != SLOT_MAGIC || header.capacity_ % SLOT_ALIGNMENT != 0 ||
+        header.size_ > PAGE_SIZE || sizeof(SlotHeader) + header.size_ > header.capacity_) {
+      if (offset == 0) {
+        throw Exception("db file was not written with page compression");
+      }
+      LOG_DEBUG("corrupted slot header, ignoring the rest of the db file");
+      break;
+    }
+    if (static_cast<int64_t>(offset + sizeof(SlotHeader) + header.size_) > file_size) {
+      break;
+    }
+
+    auto iter = page_seqs.find(header.page_id_);
+    if (iter == page_seqs.end() || iter->second < header.seq_) {
+      if (iter != page_seqs.end()) {
+        const PageSlot &old_slot = page_slots_[header.page_id_];
+        free_slots_[old_slot.capacity_ / SLOT_ALIGNMENT].push_back(old_slot.offset_);
+      }
+      page_seqs[header.page_id_] = header.seq_;
+      page_slots_[header.page_id_] = PageSlot{offset, header.capacity_, header.size_};
+    } else {
+      free_slots_[header.capacity_ / SLOT_ALIGNMENT].push_back(offset);
+    }
+    slot_seq_ = std::max(slot_seq_, header.seq_);
+    offset += header.capacity_;
+  }
+  db_io_.clear();
+  file_end_ = offset;
+}
+
 /**
  * Write the contents of the log into disk file
  * Only return when sync is done, and only perform sequence write
  */
-void DiskManager::WriteLog(char *log_data, int size) {
+void DiskManager::WriteLog(char *log_data, int size, int partition) {
+  LogSegments &segments = *log_segments_[partition];
+  std::scoped_lock lock(segments.latch_);
   // enforce swap log buffer
-  assert(log_data != buffer_used);
-  buffer_used = log_data;
+  assert(log_data != segments.buffer_used_);
+  segments.buffer_used_ = log_data;
 
   if (size == 0) {  // no effect on num_flushes_ if log buffer is empty
     return;
@@ -150,16 +478,33 @@ void DiskManager::WriteLog(char *log_data, int size) {
   }
 
   num_flushes_ += 1;
-  // sequence write
-  log_io_.write(log_data, size);
+  const int64_t capacity = GetLogSegmentCapacity();
+  if (segments.write_fd_ < 0 || segments.write_offset_ + size > (segments.last_ + 1) * capacity) {
+    // the records of the current segment end at the zero size field behind them
+    StartLogSegment(partition, &segments);
+  }
+  int64_t segment_end = (segments.last_ + 1) * capacity;
+  off_t pos = sizeof(LogSegmentHeader) + segments.write_offset_ - segments.last_ * capacity;
 
-  // check for I/O error
-  if (log_io_.bad()) {
+  // the zero size field behind the records goes first, so that the segment never continues with old records
+  if (segments.write_offset_ + size + static_cast<int64_t>(sizeof(int32_t)) <= segment_end) {
+    int32_t end_of_log = 0;
+    if (pwrite(segments.write_fd_, &end_of_log, sizeof(end_of_log), pos + size) != sizeof(end_of_log)) {
+      LOG_DEBUG("I/O error while writing log");
+      return;
+    }
+  }
+  // sequence write
+  if (pwrite(segments.write_fd_, log_data, size, pos) != size) {
     LOG_DEBUG("I/O error while writing log");
     return;
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
+  // one sync per buffer, every commit whose record is in it becomes durable with it
+  if (fdatasync(segments.write_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing log");
+    return;
+  }
+  segments.write_offset_ += size;
   flush_log_ = false;
 }
 
@@ -168,27 +513,170 @@ void DiskManager::WriteLog(char *log_data, int size) {
  * Always read from the beginning and perform sequence read
  * @return: false means already reach the end
  */
-bool DiskManager::ReadLog(char *log_data, int size, int offset) {
-  if (offset >= GetFileSize(log_name_)) {
+bool DiskManager::ReadLog(char *log_data, int size, int64_t offset, int partition) {
+  if (partition >= GetNumLogPartitions() || offset < 0) {
+    return false;
+  }
+  LogSegments &segments = *log_segments_[partition];
+  std::scoped_lock lock(segments.latch_);
+  const int64_t capacity = GetLogSegmentCapacity();
+  int64_t segment = offset / capacity;
+  if (segment < segments.first_ || offset >= segments.write_offset_) {
     // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
+  if (segments.read_segment_ != segment) {
+    if (segments.read_fd_ >= 0) {
+      close(segments.read_fd_);
+    }
+    segments.read_fd_ = open(GetLogSegmentName(partition, segment).c_str(), O_RDONLY);
+    segments.read_segment_ = segments.read_fd_ >= 0 ? segment : -1;
+    if (segments.read_fd_ < 0) {
+      LOG_DEBUG("log segment is missing");
+      return false;
+    }
+  }
 
-  if (log_io_.bad()) {
+  // a log record never continues in the next segment
+  int64_t pos = offset - segment * capacity;
+  auto count = static_cast<size_t>(std::min<int64_t>(size, capacity - pos));
+  ssize_t read_count = pread(segments.read_fd_, log_data, count, sizeof(LogSegmentHeader) + pos);
+  if (read_count < 0) {
     LOG_DEBUG("I/O error while reading log");
     return false;
   }
   // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
-  if (read_count < size) {
-    log_io_.clear();
-    memset(log_data + read_count, 0, size - read_count);
+  memset(log_data + read_count, 0, size - read_count);
+  return true;
+}
+
+int64_t DiskManager::GetNextLogSegmentOffset(int64_t offset) const {
+  const int64_t capacity = GetLogSegmentCapacity();
+  return (offset / capacity + 1) * capacity;
+}
+
+const char *DiskManager::MapLogSegment(int64_t offset, int partition, int64_t *begin, int64_t *size) {
+  if (partition >= GetNumLogPartitions() || offset < 0) {
+    return nullptr;
+  }
+  LogSegments &segments = *log_segments_[partition];
+  const int64_t capacity = GetLogSegmentCapacity();
+  int64_t segment = offset / capacity;
+  int64_t end;
+  {
+    std::scoped_lock lock(segments.latch_);
+    if (segment < segments.first_ || offset >= segments.write_offset_) {
+      return nullptr;
+    }
+    end = std::min(segments.write_offset_, (segment + 1) * capacity);
   }
 
-  return true;
+  int fd = open(GetLogSegmentName(partition, segment).c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG_DEBUG("log segment is missing");
+    return nullptr;
+  }
+  // never map past the end of the file, touching such a page raises SIGBUS
+  struct stat stat_buf;
+  int64_t file_size = fstat(fd, &stat_buf) == 0 ? stat_buf.st_size : 0;
+  end = std::min(end, segment * capacity + file_size - static_cast<int64_t>(sizeof(LogSegmentHeader)));
+  if (end <= offset) {
+    close(fd);
+    return nullptr;
+  }
+  // the header keeps the mapping page aligned
+  auto length = static_cast<size_t>(sizeof(LogSegmentHeader) + end - segment * capacity);
+  void *data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    LOG_DEBUG("cannot map log segment");
+    return nullptr;
+  }
+  madvise(data, length, MADV_SEQUENTIAL);
+  *begin = segment * capacity;
+  *size = end - segment * capacity;
+  return static_cast<const char *>(data) + sizeof(LogSegmentHeader);
+}
+
+void DiskManager::UnmapLogSegment(const char *data, int64_t size) {
+  munmap(const_cast<char *>(data - sizeof(LogSegmentHeader)), sizeof(LogSegmentHeader) + size);
+}
+
+int64_t DiskManager::GetLogBegin(int partition) {
+  LogSegments &segments = *log_segments_[partition];
+  std::scoped_lock lock(segments.latch_);
+  return segments.last_ < segments.first_ ? segments.write_offset_ : segments.first_ * GetLogSegmentCapacity();
+}
+
+int64_t DiskManager::GetLogEnd(int partition) {
+  LogSegments &segments = *log_segments_[partition];
+  std::scoped_lock lock(segments.latch_);
+  return segments.write_offset_;
+}
+
+/**
+ * Rename the old segments to the numbers after the last live or spare segment, from where StartLogSegment() takes
+ * them. Beyond MAX_SPARE_LOG_SEGMENTS they are deleted.
+ */
+void DiskManager::TruncateLog(int partition, int64_t offset) {
+  LogSegments &segments = *log_segments_[partition];
+  std::scoped_lock lock(segments.latch_);
+  int64_t end = std::min(offset / GetLogSegmentCapacity(), segments.last_);
+  for (; segments.first_ < end; segments.first_++) {
+    std::string name = GetLogSegmentName(partition, segments.first_);
+    if (segments.read_segment_ == segments.first_) {
+      close(segments.read_fd_);
+      segments.read_fd_ = -1;
+      segments.read_segment_ = -1;
+    }
+    if (segments.spare_.size() < MAX_SPARE_LOG_SEGMENTS) {
+      int64_t spare = std::max<int64_t>(segments.last_, segments.spare_.empty() ? 0 : segments.spare_.back()) + 1;
+      if (std::rename(name.c_str(), GetLogSegmentName(partition, spare).c_str()) == 0) {
+        segments.spare_.push_back(spare);
+        continue;
+      }
+    }
+    std::remove(name.c_str());
+  }
+}
+
+int DiskManager::GetNumRecycledLogSegments(int partition) {
+  LogSegments &segments = *log_segments_[partition];
+  std::scoped_lock lock(segments.latch_);
+  return segments.num_recycled_;
+}
+
+/**
+ * Write the master record into a temporary file and rename it over the old one. The temporary file is synced before
+ * the rename and the directory after it, so that a crash leaves either the old or the new master record.
+ */
+void DiskManager::WriteMasterRecord(const char *data, int size) {
+  std::string master_name = log_name_ + ".master";
+  std::string tmp_name = master_name + ".tmp";
+  int fd = open(tmp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    LOG_DEBUG("I/O error while writing the master record");
+    return;
+  }
+  bool written = write(fd, data, size) == size && fsync(fd) == 0;
+  close(fd);
+  if (!written || std::rename(tmp_name.c_str(), master_name.c_str()) != 0) {
+    LOG_DEBUG("I/O error while writing the master record");
+    return;
+  }
+  SyncDirectory(master_name);
+}
+
+bool DiskManager::ReadMasterRecord(std::vector<char> *data) {
+  std::string master_name = log_name_ + ".master";
+  int64_t size = GetFileSize(master_name);
+  if (size < 0) {
+    return false;
+  }
+  std::ifstream master_io(master_name, std::ios::binary | std::ios::in);
+  data->resize(size);
+  master_io.read(data->data(), size);
+  return master_io.gcount() == size;
 }
 
 /**
@@ -201,6 +689,16 @@ int DiskManager::GetNumFlushes() const { return num_flushes_; }
  */
 int DiskManager::GetNumWrites() const { return num_writes_; }
 
+/**
+ * Returns number of page bytes written so far
+ */
+uint64_t DiskManager::GetNumBytesWritten() const { return num_bytes_written_; }
+
+/**
+ * Returns number of page bytes read so far
+ */
+uint64_t DiskManager::GetNumBytesRead() const { return num_bytes_read_; }
+
 /**
  * Returns true if the log is currently being flushed
  */
@@ -209,10 +707,10 @@ bool DiskManager::GetFlushState() const { return flush_log_; }
 /**
  * Private helper function to get disk file size
  */
-int DiskManager::GetFileSize(const std::string &file_name) {
+int64_t DiskManager::GetFileSize(const std::string &file_name) {
   struct stat stat_buf;
   int rc = stat(file_name.c_str(), &stat_buf);
-  return rc == 0 ? static_cast<int>(stat_buf.st_size) : -1;
+  return rc == 0 ? static_cast<int64_t>(stat_buf.st_size) : -1;
 }
 
 }  // namespace bustub
@@ -0,0 +1,178 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_compressor.cpp
+//
+// Identification: src/storage/disk/page_compressor.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/page_compressor.h"
+
+#include <cstring>
+
+namespace bustub {
+
+namespace {
+
+uint32_t Read32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+/** Number of bytes needed to encode a length whose nibble saturated at 15. */
+size_t ExtensionBytes(size_t length) { return length < 15 ? 0 : (length - 15) / 255 + 1; }
+
+uint8_t *WriteExtension(uint8_t *op, size_t length) {
+  for (length -= 15; length >= 255; length -= 255) {
+    *op++ = 255;
+  }
+  *op++ = static_cast<uint8_t>(length);
+  return op;
+}
+
+bool ReadExtension(const uint8_t **ip, const uint8_t *end, size_t *length) {
+  uint8_t byte;
+  do {
+    if (*ip >= end) {
+      return false;
+    }
+    byte = *(*ip)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/**
+ * Append one sequence to the output. A match_length of 0 encodes the final, literal-only sequence.
+ * @return the new output position, or nullptr if the sequence does not fit
+ */
+uint8_t *EmitSequence(uint8_t *op, const uint8_t *op_end, const uint8_t *literals, size_t literal_length,
+                      size_t offset, size_t match_length, size_t min_match) {
+  size_t match_code = match_length == 0 ? 0 : match_length - min_match;
+  size_t needed = 1 + ExtensionBytes(literal_length) + literal_length;
+  if (match_length != 0) {
+    needed += 2 + ExtensionBytes(match_code);
+  }
+  if (needed > static_cast<size_t>(op_end - op)) {
+    return nullptr;
+  }
+
+  uint8_t *token = op++;
+  *token = static_cast<uint8_t>((literal_length < 15 ? literal_length : 15) << 4);
+  if (literal_length >= 15) {
+    op = WriteExtension(op, literal_length);
+  }
+  memcpy(op, literals, literal_length);
+  op += literal_length;
+  if (match_length == 0) {
+    return op;
+  }
+
+  *op++ = static_cast<uint8_t>(offset & 0xFF);
+  *op++ = static_cast<uint8_t>(offset >> 8);
+  *token |= static_cast<uint8_t>(match_code < 15 ? match_code : 15);
+  if (match_code >= 15) {
+    op = WriteExtension(op, match_code);
+  }
+  return op;
+}
+
+}  // namespace
+
+size_t PageCompressor::Compress(const char *src, size_t src_size, char *dst, size_t dst_capacity) {
+  const auto *in = reinterpret_cast<const uint8_t *>(src);
+  auto *op = reinterpret_cast<uint8_t *>(dst);
+  const uint8_t *op_end = op + dst_capacity;
+  uint16_t table[1 << HASH_LOG] = {0};
+
+  size_t anchor = 0;
+  size_t ip = 0;
+  while (ip + MIN_MATCH <= src_size) {
+    uint32_t sequence = Read32(in + ip);
+    uint32_t hash = Hash(sequence);
+    size_t candidate = table[hash];
+    table[hash] = static_cast<uint16_t>(ip);
+    if (candidate >= ip || ip - candidate > MAX_OFFSET || Read32(in + candidate) != sequence) {
+      // skip faster through data that does not compress
+      ip += 1 + ((ip - anchor) >> 6);
+      continue;
+    }
+
+    size_t match_length = MIN_MATCH;
+    while (ip + match_length < src_size && in[candidate + match_length] == in[ip + match_length]) {
+      match_length++;
+    }
+    op = EmitSequence(op, op_end, in + anchor, ip - anchor, ip - candidate, match_length, MIN_MATCH);
+    if (op == nullptr) {
+      return 0;
+    }
+    ip += match_length;
+    anchor = ip;
+  }
+
+  op = EmitSequence(op, op_end, in + anchor, src_size - anchor, 0, 0, MIN_MATCH);
+  if (op == nullptr) {
+    return 0;
+  }
+  return op - reinterpret_cast<uint8_t *>(dst);
+}
+
+bool PageCompressor::Decompress(const char *src, size_t src_size, char *dst, size_t dst_size) {
+  const auto *ip = reinterpret_cast<const uint8_t *>(src);
+  const uint8_t *ip_end = ip + src_size;
+  auto *op = reinterpret_cast<uint8_t *>(dst);
+  const uint8_t *op_begin = op;
+  const uint8_t *op_end = op + dst_size;
+
+  // every stream ends with a literal-only sequence, running out of input anywhere else means it was truncated
+  while (true) {
+    if (ip >= ip_end) {
+      return false;
+    }
+    uint8_t token = *ip++;
+
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !ReadExtension(&ip, ip_end, &literal_length)) {
+      return false;
+    }
+    if (literal_length > static_cast<size_t>(ip_end - ip) || literal_length > static_cast<size_t>(op_end - op)) {
+      return false;
+    }
+    memcpy(op, ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+    if (ip == ip_end) {
+      break;
+    }
+
+    if (ip_end - ip < 2) {
+      return false;
+    }
+    size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<size_t>(op - op_begin)) {
+      return false;
+    }
+    size_t match_length = token & 0x0F;
+    if (match_length == 15 && !ReadExtension(&ip, ip_end, &match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (match_length > static_cast<size_t>(op_end - op)) {
+      return false;
+    }
+    // byte by byte, the match may overlap the bytes it produces
+    const uint8_t *match = op - offset;
+    for (size_t i = 0; i < match_length; i++) {
+      *op++ = *match++;
+    }
+  }
+  return op == op_end;
+}
+
+}  // namespace bustub
@@ -16,10 +16,13 @@ namespace bustub {
  * Constructor
  */
 INDEX_TEMPLATE_ARGUMENTS
-BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager)
+BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                                     LockManager *lock_manager)
     : Index(std::move(metadata)),
       comparator_(GetMetadata()->GetKeySchema()),
-      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_) {}
+      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_),
+      lock_manager_(lock_manager),
+      range_locks_(comparator_, lock_manager) {}
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
@@ -27,6 +30,10 @@ void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *t
   KeyType index_key;
   index_key.SetFromKey(key);
 
+  // a scan that locked a range with the key in it would see a phantom
+  if (LocksKeys(transaction, true)) {
+    range_locks_.LockKey(transaction, index_key, LockMode::EXCLUSIVE);
+  }
   container_.Insert(index_key, rid, transaction);
 }
 
@@ -36,6 +43,9 @@ void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *t
   KeyType index_key;
   index_key.SetFromKey(key);
 
+  if (LocksKeys(transaction, true)) {
+    range_locks_.LockKey(transaction, index_key, LockMode::EXCLUSIVE);
+  }
   container_.Remove(index_key, transaction);
 }
 
@@ -45,9 +55,40 @@ void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, T
   KeyType index_key;
   index_key.SetFromKey(key);
 
+  // locked also if the key is not there, so that it is not there on the next scan either
+  if (LocksKeys(transaction, false)) {
+    range_locks_.LockKey(transaction, index_key, LockMode::SHARED);
+  }
   container_.GetValue(index_key, result, transaction);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanRange(const Tuple *low_key, const Tuple *high_key, std::vector<RID> *result,
+                                     Transaction *transaction) {
+  KeyType low_index_key;
+  KeyType high_index_key;
+  if (low_key != nullptr) {
+    low_index_key.SetFromKey(*low_key);
+  }
+  if (high_key != nullptr) {
+    high_index_key.SetFromKey(*high_key);
+  }
+
+  if (LocksKeys(transaction, false)) {
+    range_locks_.LockRange(transaction, low_key != nullptr ? &low_index_key : nullptr,
+                           high_key != nullptr ? &high_index_key : nullptr, LockMode::SHARED);
+  }
+  if (container_.IsEmpty()) {
+    return;
+  }
+  for (auto iter = low_key != nullptr ? container_.Begin(low_index_key) : container_.Begin(); !iter.IsEnd(); ++iter) {
+    if (high_key != nullptr && comparator_((*iter).first, high_index_key) > 0) {
+      break;
+    }
+    result->push_back((*iter).second);
+  }
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator() { return container_.Begin(); }
 
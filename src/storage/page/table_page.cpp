@@ -25,8 +25,7 @@ void TablePage::Init(page_id_t page_id, uint32_t page_size, page_id_t prev_page_
     LogRecord log_record =
         LogRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::NEWPAGE, prev_page_id, page_id);
     lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-    SetLSN(lsn);
-    txn->SetPrevLSN(lsn);
+    LogChange(lsn, txn, log_manager);
   }
   // Set the previous and next page IDs.
   SetPrevPageId(prev_page_id);
@@ -35,8 +34,26 @@ void TablePage::Init(page_id_t page_id, uint32_t page_size, page_id_t prev_page_
   SetTupleCount(0);
 }
 
+void TablePage::LogChange(lsn_t lsn, Transaction *txn, LogManager *log_manager) {
+  int partition = log_manager->GetPartitionIndex(txn->GetTransactionId());
+  if (tracked_lsn_ != GetLSN()) {
+    // the page was read from disk since, the log was persistent up to the page LSN before the page was written
+    last_log_partition_ = -1;
+    foreign_lsn_ = GetLSN();
+  }
+  // the changes of our own partition are written before ours anyway
+  txn->AddCommitDependency(partition == last_log_partition_ ? foreign_lsn_ : GetLSN());
+  if (partition != last_log_partition_) {
+    foreign_lsn_ = GetLSN();
+    last_log_partition_ = partition;
+  }
+  SetLSN(lsn);
+  tracked_lsn_ = lsn;
+  txn->SetPrevLSN(lsn);
+}
+
 bool TablePage::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, LockManager *lock_manager,
-                            LogManager *log_manager) {
+                            LogManager *log_manager, table_oid_t oid) {
   BUSTUB_ASSERT(tuple.size_ > 0, "Cannot have empty tuples.");
   // If there is not enough space, then return false.
   if (GetFreeSpaceRemaining() < tuple.size_ + SIZE_TUPLE) {
@@ -75,17 +92,17 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, Lock
   if (enable_logging) {
     BUSTUB_ASSERT(!txn->IsSharedLocked(*rid) && !txn->IsExclusiveLocked(*rid), "A new tuple should not be locked.");
     // Acquire an exclusive lock on the new tuple.
-    bool locked = lock_manager->LockExclusive(txn, *rid);
+    bool locked = lock_manager->LockExclusive(txn, *rid, oid, false);
     BUSTUB_ASSERT(locked, "Locking a new tuple should always work.");
-    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::INSERT, *rid, tuple);
-    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-    SetLSN(lsn);
-    txn->SetPrevLSN(lsn);
+    lsn_t lsn = log_manager->AppendTupleLogRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::INSERT,
+                                                  *rid, tuple.data_, tuple.size_);
+    LogChange(lsn, txn, log_manager);
   }
   return true;
 }
 
-bool TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager) {
+bool TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager,
+                           table_oid_t oid) {
   uint32_t slot_num = rid.GetSlotNum();
   // If the slot number is invalid, abort the transaction.
   if (slot_num >= GetTupleCount()) {
@@ -107,17 +124,15 @@ bool TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_m
   if (enable_logging) {
     // Acquire an exclusive lock, upgrading from a shared lock if necessary.
     if (txn->IsSharedLocked(rid)) {
-      if (!lock_manager->LockUpgrade(txn, rid)) {
+      if (!lock_manager->LockUpgrade(txn, rid, oid, false)) {
         return false;
       }
-    } else if (!txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
+    } else if (!txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid, oid, false)) {
       return false;
     }
-    Tuple dummy_tuple;
-    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::MARKDELETE, rid, dummy_tuple);
-    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-    SetLSN(lsn);
-    txn->SetPrevLSN(lsn);
+    lsn_t lsn = log_manager->AppendTupleLogRecord(txn->GetTransactionId(), txn->GetPrevLSN(),
+                                                  LogRecordType::MARKDELETE, rid, nullptr, 0);
+    LogChange(lsn, txn, log_manager);
   }
 
   // Mark the tuple as deleted.
@@ -128,7 +143,7 @@ bool TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_m
 }
 
 bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID &rid, Transaction *txn,
-                            LockManager *lock_manager, LogManager *log_manager) {
+                            LockManager *lock_manager, LogManager *log_manager, table_oid_t oid) {
   BUSTUB_ASSERT(new_tuple.size_ > 0, "Cannot have empty tuples.");
   uint32_t slot_num = rid.GetSlotNum();
   // If the slot number is invalid, abort the transaction.
@@ -165,16 +180,17 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID
   if (enable_logging) {
     // Acquire an exclusive lock, upgrading from shared if necessary.
     if (txn->IsSharedLocked(rid)) {
-      if (!lock_manager->LockUpgrade(txn, rid)) {
+      if (!lock_manager->LockUpgrade(txn, rid, oid, false)) {
         return false;
       }
-    } else if (!txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
+    } else if (!txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid, oid, false)) {
       return false;
     }
-    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::UPDATE, rid, *old_tuple, new_tuple);
-    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-    SetLSN(lsn);
-    txn->SetPrevLSN(lsn);
+    // both images go straight from the page and the new tuple into the log buffer
+    lsn_t lsn = log_manager->AppendUpdateLogRecord(txn->GetTransactionId(), txn->GetPrevLSN(), rid,
+                                                   GetData() + tuple_offset, tuple_size, new_tuple.data_,
+                                                   new_tuple.size_);
+    LogChange(lsn, txn, log_manager);
   }
 
   // Perform the update.
@@ -197,6 +213,20 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID
   return true;
 }
 
+bool TablePage::PatchTuple(const RID &rid, uint32_t tuple_size, const std::vector<TupleDeltaRange> &ranges,
+                           const char *bytes) {
+  uint32_t slot_num = rid.GetSlotNum();
+  if (slot_num >= GetTupleCount() || GetTupleSize(slot_num) != tuple_size) {
+    return false;
+  }
+  char *tuple_data = GetData() + GetTupleOffsetAtSlot(slot_num);
+  for (const auto &range : ranges) {
+    memcpy(tuple_data + range.offset_, bytes, range.length_);
+    bytes += range.length_;
+  }
+  return true;
+}
+
 void TablePage::ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_manager) {
   uint32_t slot_num = rid.GetSlotNum();
   BUSTUB_ASSERT(slot_num < GetTupleCount(), "Cannot have more slots than tuples.");
@@ -209,21 +239,14 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_ma
   }
   // Otherwise we are rolling back an insert.
 
-  // We need to copy out the deleted tuple for undo purposes.
-  Tuple delete_tuple;
-  delete_tuple.size_ = tuple_size;
-  delete_tuple.data_ = new char[delete_tuple.size_];
-  memcpy(delete_tuple.data_, GetData() + tuple_offset, delete_tuple.size_);
-  delete_tuple.rid_ = rid;
-  delete_tuple.allocated_ = true;
-
   if (enable_logging) {
     BUSTUB_ASSERT(txn->IsExclusiveLocked(rid), "We must own the exclusive lock!");
 
-    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::APPLYDELETE, rid, delete_tuple);
-    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-    SetLSN(lsn);
-    txn->SetPrevLSN(lsn);
+    // the deleted tuple is logged for undo purposes, straight from the page
+    lsn_t lsn = log_manager->AppendTupleLogRecord(txn->GetTransactionId(), txn->GetPrevLSN(),
+                                                  LogRecordType::APPLYDELETE, rid, GetData() + tuple_offset,
+                                                  tuple_size);
+    LogChange(lsn, txn, log_manager);
   }
 
   uint32_t free_space_pointer = GetFreeSpacePointer();
@@ -248,11 +271,9 @@ void TablePage::RollbackDelete(const RID &rid, Transaction *txn, LogManager *log
   // Log the rollback.
   if (enable_logging) {
     BUSTUB_ASSERT(txn->IsExclusiveLocked(rid), "We must own an exclusive lock on the RID.");
-    Tuple dummy_tuple;
-    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ROLLBACKDELETE, rid, dummy_tuple);
-    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-    SetLSN(lsn);
-    txn->SetPrevLSN(lsn);
+    lsn_t lsn = log_manager->AppendTupleLogRecord(txn->GetTransactionId(), txn->GetPrevLSN(),
+                                                  LogRecordType::ROLLBACKDELETE, rid, nullptr, 0);
+    LogChange(lsn, txn, log_manager);
   }
 
   uint32_t slot_num = rid.GetSlotNum();
@@ -265,7 +286,7 @@ void TablePage::RollbackDelete(const RID &rid, Transaction *txn, LogManager *log
   }
 }
 
-bool TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager) {
+bool TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager, table_oid_t oid) {
   // Get the current slot number.
   uint32_t slot_num = rid.GetSlotNum();
   // If somehow we have more slots than tuples, abort the transaction.
@@ -287,14 +308,22 @@ bool TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockMan
 
   // Otherwise we have a valid tuple, try to acquire at least a shared lock.
   if (enable_logging) {
-    if (!txn->IsSharedLocked(rid) && !txn->IsExclusiveLocked(rid) && !lock_manager->LockShared(txn, rid)) {
+    if (!txn->IsSharedLocked(rid) && !txn->IsExclusiveLocked(rid) && !lock_manager->LockShared(txn, rid, oid, false)) {
       return false;
     }
   }
 
   // At this point, we have at least a shared lock on the RID. Copy the tuple data into our result.
+  return ReadTuple(rid, tuple);
+}
+
+bool TablePage::ReadTuple(const RID &rid, Tuple *tuple) {
+  uint32_t slot_num = rid.GetSlotNum();
+  if (slot_num >= GetTupleCount() || IsDeleted(GetTupleSize(slot_num))) {
+    return false;
+  }
   uint32_t tuple_offset = GetTupleOffsetAtSlot(slot_num);
-  tuple->size_ = tuple_size;
+  tuple->size_ = GetTupleSize(slot_num);
   if (tuple->allocated_) {
     delete[] tuple->data_;
   }
@@ -305,10 +334,10 @@ bool TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockMan
   return true;
 }
 
-bool TablePage::GetFirstTupleRid(RID *first_rid) {
+bool TablePage::GetFirstTupleRid(RID *first_rid, bool include_deleted) {
   // Find and return the first valid tuple.
   for (uint32_t i = 0; i < GetTupleCount(); ++i) {
-    if (!IsDeleted(GetTupleSize(i))) {
+    if (include_deleted || !IsDeleted(GetTupleSize(i))) {
       first_rid->Set(GetTablePageId(), i);
       return true;
     }
@@ -317,11 +346,11 @@ bool TablePage::GetFirstTupleRid(RID *first_rid) {
   return false;
 }
 
-bool TablePage::GetNextTupleRid(const RID &cur_rid, RID *next_rid) {
+bool TablePage::GetNextTupleRid(const RID &cur_rid, RID *next_rid, bool include_deleted) {
   BUSTUB_ASSERT(cur_rid.GetPageId() == GetTablePageId(), "Wrong table!");
   // Find and return the first valid tuple after our current slot number.
   for (auto i = cur_rid.GetSlotNum() + 1; i < GetTupleCount(); ++i) {
-    if (!IsDeleted(GetTupleSize(i))) {
+    if (include_deleted || !IsDeleted(GetTupleSize(i))) {
       next_rid->Set(GetTablePageId(), i);
       return true;
     }
@@ -11,8 +11,10 @@
 //===----------------------------------------------------------------------===//
 
 #include <cassert>
+#include <cstring>
 
 #include "common/logger.h"
+#include "concurrency/version_store.h"
 #include "storage/table/table_heap.h"
 
 namespace bustub {
@@ -25,8 +27,8 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_m
       first_page_id_(first_page_id) {}
 
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
-                     Transaction *txn)
-    : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager), log_manager_(log_manager) {
+                     Transaction *txn, table_oid_t oid)
+    : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager), log_manager_(log_manager), oid_(oid) {
   // Initialize the first table page.
   auto first_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->NewPage(&first_page_id_));
   BUSTUB_ASSERT(first_page != nullptr, "Couldn't create a page for the table heap.");
@@ -37,7 +39,7 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_m
 }
 
 bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
-  if (tuple.size_ + 32 > PAGE_SIZE) {  // larger than one page size
+  if (tuple.size_ > TablePage::MaxTupleSize()) {  // larger than one page size
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
@@ -51,7 +53,7 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
   cur_page->WLatch();
   // Insert into the first page with enough space. If no such page exists, create a new page and insert into that.
   // INVARIANT: cur_page is WLatched if you leave the loop normally.
-  while (!cur_page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_)) {
+  while (!cur_page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_, oid_)) {
     auto next_page_id = cur_page->GetNextPageId();
     // If the next page is a valid page,
     if (next_page_id != INVALID_PAGE_ID) {
@@ -81,12 +83,16 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
       cur_page = new_page;
     }
   }
+  if (txn->GetVersionStore() != nullptr && txn->GetVersionStore()->KeepsVersions(txn)) {
+    txn->GetVersionStore()->AddVersion(*rid, txn, nullptr);
+  }
   // This line has caused most of us to double-take and "whoa double unlatch".
   // We are not, in fact, double unlatching. See the invariant above.
   cur_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
   // Update the transaction's write set.
   txn->GetWriteSet()->emplace_back(*rid, WType::INSERT, Tuple{}, this);
+  EscalateLocks(txn);
   return true;
 }
 
@@ -99,13 +105,27 @@ bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  if (IsOptimistic(txn)) {
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    return BufferWrite(rid, WType::DELETE, Tuple{}, txn);
+  }
+  if (!CheckSnapshotWrite(rid, txn)) {
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    return false;
+  }
   // Otherwise, mark the tuple as deleted.
   page->WLatch();
-  page->MarkDelete(rid, txn, lock_manager_, log_manager_);
+  Tuple old_tuple;
+  bool keep_version = txn->GetVersionStore() != nullptr && txn->GetVersionStore()->KeepsVersions(txn) &&
+                      page->ReadTuple(rid, &old_tuple);
+  if (page->MarkDelete(rid, txn, lock_manager_, log_manager_, oid_) && keep_version) {
+    txn->GetVersionStore()->AddVersion(rid, txn, &old_tuple);
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
   // Update the transaction's write set.
   txn->GetWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this);
+  EscalateLocks(txn);
   return true;
 }
 
@@ -117,15 +137,29 @@ bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  if (IsOptimistic(txn)) {
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    return BufferWrite(rid, WType::UPDATE, tuple, txn);
+  }
+  // a rollback restores the old value, which is not a write of its own
+  bool rollback = txn->GetState() == TransactionState::ABORTED;
+  if (!rollback && !CheckSnapshotWrite(rid, txn)) {
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    return false;
+  }
   // Update the tuple; but first save the old value for rollbacks.
   Tuple old_tuple;
   page->WLatch();
-  bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_);
+  bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_, oid_);
+  if (is_updated && !rollback && txn->GetVersionStore() != nullptr && txn->GetVersionStore()->KeepsVersions(txn)) {
+    txn->GetVersionStore()->AddVersion(rid, txn, &old_tuple);
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_updated);
   // Update the transaction's write set.
   if (is_updated && txn->GetState() != TransactionState::ABORTED) {
     txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this);
+    EscalateLocks(txn);
   }
   return is_updated;
 }
@@ -137,7 +171,6 @@ void TableHeap::ApplyDelete(const RID &rid, Transaction *txn) {
   // Delete the tuple from the page.
   page->WLatch();
   page->ApplyDelete(rid, txn, log_manager_);
-  lock_manager_->Unlock(txn, rid);
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
 }
@@ -153,7 +186,20 @@ void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
 }
 
-bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) {
+bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, bool escalate) {
+  if (IsOptimistic(txn)) {
+    // the transaction sees its own writes, the newest one first
+    auto buffered = txn->GetBufferedWriteSet();
+    for (auto write = buffered->rbegin(); write != buffered->rend(); ++write) {
+      if (write->rid_ == rid && write->table_ == this) {
+        if (write->wtype_ == WType::DELETE) {
+          return false;
+        }
+        *tuple = write->tuple_;
+        return true;
+      }
+    }
+  }
   // Find the page which contains the tuple.
   auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -163,12 +209,85 @@ bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) {
   }
   // Read the tuple from the page.
   page->RLatch();
-  bool res = page->GetTuple(rid, tuple, txn, lock_manager_);
+  bool res;
+  if (txn != nullptr && txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT && txn->GetVersionStore() != nullptr) {
+    // no lock, the version store turns the newest version into the one the snapshot sees
+    res = txn->GetVersionStore()->GetVisibleVersion(rid, txn, tuple, page->ReadTuple(rid, tuple));
+  } else if (IsOptimistic(txn)) {
+    // no lock, Commit() checks that the row is still what we saw here
+    res = page->ReadTuple(rid, tuple);
+    txn->GetReadSet()->emplace(rid, TableReadRecord(rid, res, res ? *tuple : Tuple{}, this));
+  } else {
+    res = page->GetTuple(rid, tuple, txn, lock_manager_, oid_);
+  }
   page->RUnlatch();
   buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
+  if (escalate) {
+    EscalateLocks(txn);
+  }
   return res;
 }
 
+void TableHeap::EscalateLocks(Transaction *txn) {
+  if (enable_logging && lock_manager_ != nullptr && txn != nullptr) {
+    lock_manager_->EscalateIfDue(txn, oid_);
+  }
+}
+
+bool TableHeap::CheckSnapshotWrite(const RID &rid, Transaction *txn) {
+  if (txn->GetIsolationLevel() != IsolationLevel::SNAPSHOT || txn->GetVersionStore() == nullptr) {
+    return true;
+  }
+  // the lock keeps other writers off the row until we commit, so the check below stays true
+  if (lock_manager_ != nullptr && !txn->IsExclusiveLocked(rid) && !lock_manager_->LockExclusive(txn, rid, oid_)) {
+    return false;
+  }
+  if (txn->GetVersionStore()->HasWriteConflict(rid, txn)) {
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::WRITE_CONFLICT);
+  }
+  return true;
+}
+
+bool TableHeap::ValidateRead(const TableReadRecord &read, Transaction *txn) {
+  // a row that somebody else may be writing right now can change after the check below
+  if (lock_manager_ != nullptr && lock_manager_->IsWriteLocked(txn, read.rid_, oid_)) {
+    return false;
+  }
+  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(read.rid_.GetPageId()));
+  if (page == nullptr) {
+    return false;
+  }
+  Tuple tuple;
+  page->RLatch();
+  bool exists = page->ReadTuple(read.rid_, &tuple);
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(read.rid_.GetPageId(), false);
+  if (exists != read.exists_) {
+    return false;
+  }
+  return !exists ||
+         (tuple.GetLength() == read.tuple_.GetLength() &&
+          std::memcmp(tuple.GetData(), read.tuple_.GetData(), tuple.GetLength()) == 0);
+}
+
+bool TableHeap::IsOptimistic(Transaction *txn) {
+  // once the transaction validated it installs its writes with the regular write paths
+  return txn != nullptr && txn->GetConcurrencyControl() == ConcurrencyControl::OPTIMISTIC &&
+         txn->GetState() == TransactionState::GROWING;
+}
+
+bool TableHeap::BufferWrite(const RID &rid, WType wtype, const Tuple &tuple, Transaction *txn) {
+  Tuple old_tuple;
+  if (!GetTuple(rid, &old_tuple, txn)) {
+    return false;
+  }
+  txn->GetBufferedWriteSet()->emplace_back(rid, wtype, tuple, this);
+  // reads of the row return the buffered tuple, so it carries the rid
+  txn->GetBufferedWriteSet()->back().tuple_.rid_ = rid;
+  return true;
+}
+
 TableIterator TableHeap::Begin(Transaction *txn) {
   // Start an iterator from the first page.  ӵһҳʼ
   // TODO(Wuwen): Hacky fix for now. Removing empty pages is a better way to handle this.
@@ -178,7 +297,9 @@ TableIterator TableHeap::Begin(Transaction *txn) {
     auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
     page->RLatch();
     // If this fails because there is no tuple, then RID will be the default-constructed value, which means EOF.
-    auto found_tuple = page->GetFirstTupleRid(&rid);
+    // A snapshot may still see an older version of a deleted tuple, the iterator skips the slots it does not see.
+    auto found_tuple =
+        page->GetFirstTupleRid(&rid, txn != nullptr && txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT);
     page->RUnlatch();
     buffer_pool_manager_->UnpinPage(page_id, false);
     if (found_tuple) {
@@ -18,8 +18,9 @@ namespace bustub {
 
 TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
     : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
-  if (rid.GetPageId() != INVALID_PAGE_ID) {
-    table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
+  // a snapshot iterator starts at the first tuple the snapshot sees, an optimistic one at the first it did not delete
+  if (rid.GetPageId() != INVALID_PAGE_ID && !table_heap_->GetTuple(tuple_->rid_, tuple_, txn_) && MayHideTuples()) {
+    ++(*this);
   }
 }
 
@@ -35,32 +36,37 @@ Tuple *TableIterator::operator->() {
 
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  cur_page->RLatch();
-  assert(cur_page != nullptr);  // all pages are pinned
+  // a snapshot also visits the deleted tuples and empty slots, and skips those it does not see an older version of
+  bool snapshot = IsSnapshot();
+  bool skip_hidden = MayHideTuples();
+  bool found;
+  do {
+    auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
+    cur_page->RLatch();
+    assert(cur_page != nullptr);  // all pages are pinned
 
-  RID next_tuple_rid;
-  if (!cur_page->GetNextTupleRid(tuple_->rid_,
-                                 &next_tuple_rid)) {  // end of this page
-    while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
-      if (cur_page->GetFirstTupleRid(&next_tuple_rid)) {
-        break;
+    RID next_tuple_rid;
+    if (!cur_page->GetNextTupleRid(tuple_->rid_, &next_tuple_rid, snapshot)) {  // end of this page
+      while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
+        auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
+        cur_page->RUnlatch();
+        buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
+        cur_page = next_page;
+        cur_page->RLatch();
+        if (cur_page->GetFirstTupleRid(&next_tuple_rid, snapshot)) {
+          break;
+        }
       }
     }
-  }
-  tuple_->rid_ = next_tuple_rid;
+    tuple_->rid_ = next_tuple_rid;
 
-  if (*this != table_heap_->End()) {
-    table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
-  }
-  // release until copy the tuple
-  cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
+    // escalating may wait for the table lock or throw, not under the latch
+    found = *this == table_heap_->End() || table_heap_->GetTuple(tuple_->rid_, tuple_, txn_, false);
+    // release until copy the tuple
+    cur_page->RUnlatch();
+    buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
+    table_heap_->EscalateLocks(txn_);
+  } while (skip_hidden && !found);
   return *this;
 }
 
@@ -162,4 +162,13 @@ void Tuple::DeserializeFrom(const char *storage) {
   this->allocated_ = true;
 }
 
+void Tuple::DeserializeViewFrom(const char *storage) {
+  if (this->allocated_) {
+    delete[] this->data_;
+  }
+  this->size_ = *reinterpret_cast<const uint32_t *>(storage);
+  this->data_ = const_cast<char *>(storage + sizeof(int32_t));
+  this->allocated_ = false;
+}
+
 }  // namespace bustub
@@ -12,6 +12,7 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include <cstdio>
+#include <filesystem>
 #include <random>
 #include <string>
 #include "buffer/buffer_pool_manager.h"
@@ -141,4 +142,58 @@ TEST(BufferPoolManagerInstanceTest, DISABLED_SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, WALAwareEvictionTest) {
+  const std::string db_name = "test.db";
+  enable_logging = true;
+  auto *disk_manager = new DiskManager(db_name);
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(3, disk_manager, log_manager);
+
+  // durable_lsn is on disk, lsn is not
+  LogRecord begin_record(0, INVALID_LSN, LogRecordType::BEGIN);
+  lsn_t durable_lsn = log_manager->AppendLogRecord(&begin_record);
+  log_manager->FlushUntil(durable_lsn);
+  LogRecord commit_record(0, durable_lsn, LogRecordType::COMMIT);
+  lsn_t lsn = log_manager->AppendLogRecord(&commit_record);
+
+  // three dirty pages, only the second one can be written back without flushing the log
+  page_id_t page_ids[3];
+  for (int i = 0; i < 3; i++) {
+    Page *page = bpm->NewPage(&page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    page->SetLSN(i == 1 ? durable_lsn : lsn);
+    snprintf(page->GetData() + 64, PAGE_SIZE - 64, "page %d", i);
+    bpm->UnpinPage(page_ids[i], true);
+  }
+
+  // the least recently used page is passed over
+  page_id_t page_id_temp;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_EQ(0, bpm->GetNumForcedLogFlushes());
+  EXPECT_LT(log_manager->GetPersistentLSN(), lsn);
+  char data[PAGE_SIZE];
+  disk_manager->ReadPage(page_ids[1], data);
+  EXPECT_STREQ(data + 64, "page 1");
+
+  // no page left that is durable, the eviction has to flush the log
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_EQ(1, bpm->GetNumForcedLogFlushes());
+  EXPECT_GE(log_manager->GetPersistentLSN(), lsn);
+  disk_manager->ReadPage(page_ids[0], data);
+  EXPECT_STREQ(data + 64, "page 0");
+
+  enable_logging = false;
+  disk_manager->ShutDown();
+  remove("test.db");
+  for (const auto &entry : std::filesystem::directory_iterator(".")) {
+    if (entry.path().filename().string().rfind("test.log", 0) == 0) {
+      std::filesystem::remove(entry.path());
+    }
+  }
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+}
+
 }  // namespace bustub
@@ -0,0 +1,85 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// epoch_latch_test.cpp
+//
+// Identification: test/common/epoch_latch_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/epoch_latch.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(EpochLatchTest, QuiesceTest) {
+  EpochLatch latch;
+  std::atomic<bool> quiesced{false};
+  std::atomic<bool> entered{false};
+
+  // a section that entered before keeps Quiesce() waiting, even if it exits on another thread
+  latch.Enter();
+  std::thread quiescer{[&] {
+    latch.Quiesce();
+    quiesced = true;
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(quiesced);
+  std::thread exiter{[&] { latch.Exit(); }};
+  exiter.join();
+  quiescer.join();
+  EXPECT_TRUE(quiesced);
+
+  // a section that enters after waits for Resume()
+  std::thread enterer{[&] {
+    latch.Enter();
+    entered = true;
+    latch.Exit();
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(entered);
+  latch.Resume();
+  enterer.join();
+  EXPECT_TRUE(entered);
+}
+
+// NOLINTNEXTLINE
+TEST(EpochLatchTest, ConcurrentTest) {
+  EpochLatch latch;
+  std::atomic<bool> stop{false};
+  std::atomic<int> inside{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&] {
+      while (!stop) {
+        latch.Enter();
+        inside++;
+        std::this_thread::yield();
+        inside--;
+        latch.Exit();
+      }
+    });
+  }
+  for (int i = 0; i < 100; i++) {
+    latch.Quiesce();
+    EXPECT_EQ(inside, 0);
+    std::this_thread::yield();
+    EXPECT_EQ(inside, 0);
+    latch.Resume();
+  }
+  stop = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace bustub
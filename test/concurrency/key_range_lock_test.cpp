@@ -0,0 +1,218 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// key_range_lock_test.cpp
+//
+// Identification: test/concurrency/key_range_lock_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "catalog/catalog.h"
+#include "concurrency/key_range_lock.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "storage/index/generic_key.h"
+#include "test_util.h"  // NOLINT
+#include "type/value_factory.h"
+
+namespace bustub {
+
+class KeyRangeLockTest : public ::testing::Test {
+ public:
+  GenericKey<8> Key(int64_t value) {
+    GenericKey<8> key;
+    key.SetFromInteger(value);
+    return key;
+  }
+
+  std::unique_ptr<Schema> key_schema_ = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator_{key_schema_.get()};
+  LockManager lock_mgr_{};
+  TransactionManager txn_mgr_{&lock_mgr_};
+  KeyRangeLockTable<GenericKey<8>, GenericComparator<8>> range_locks_{comparator_, &lock_mgr_};
+};
+
+// NOLINTNEXTLINE
+TEST_F(KeyRangeLockTest, PhantomTest) {
+  Transaction scanner(0, IsolationLevel::SERIALIZABLE);
+  Transaction writer(1, IsolationLevel::SERIALIZABLE);
+  txn_mgr_.Begin(&scanner);
+  txn_mgr_.Begin(&writer);
+  GenericKey<8> low = Key(10);
+  GenericKey<8> high = Key(20);
+  EXPECT_TRUE(range_locks_.LockRange(&scanner, &low, &high, LockMode::SHARED));
+
+  // other scans of the range and writes outside of it go on
+  EXPECT_TRUE(range_locks_.LockRange(&writer, &low, nullptr, LockMode::SHARED));
+  EXPECT_TRUE(range_locks_.LockKey(&writer, Key(9), LockMode::EXCLUSIVE));
+  EXPECT_TRUE(range_locks_.LockKey(&writer, Key(21), LockMode::EXCLUSIVE));
+
+  // an insert into the range waits until the scanner is done
+  std::atomic<bool> inserted{false};
+  std::thread writer_thread{[&] {
+    EXPECT_TRUE(range_locks_.LockKey(&writer, Key(15), LockMode::EXCLUSIVE));
+    inserted = true;
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(inserted);
+  txn_mgr_.Commit(&scanner);
+  writer_thread.join();
+  EXPECT_TRUE(inserted);
+  EXPECT_EQ(range_locks_.GetNumLocks(), 4);
+  txn_mgr_.Commit(&writer);
+  EXPECT_EQ(range_locks_.GetNumLocks(), 0);
+  EXPECT_TRUE(writer.GetRangeLockSet()->empty());
+}
+
+// NOLINTNEXTLINE
+TEST_F(KeyRangeLockTest, WoundWaitTest) {
+  Transaction txn_old(0, IsolationLevel::SERIALIZABLE);
+  Transaction txn_young(1, IsolationLevel::SERIALIZABLE);
+  txn_mgr_.Begin(&txn_old);
+  txn_mgr_.Begin(&txn_young);
+
+  // the older scanner aborts the younger writer of a key in its range
+  EXPECT_TRUE(range_locks_.LockKey(&txn_young, Key(5), LockMode::EXCLUSIVE));
+  std::thread old_thread{[&] { EXPECT_TRUE(range_locks_.LockRange(&txn_old, nullptr, nullptr, LockMode::SHARED)); }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(txn_young.GetState(), TransactionState::ABORTED);
+  txn_mgr_.Abort(&txn_young);
+  old_thread.join();
+
+  // the younger one waits for the older one and sees that it was aborted while it waited
+  Transaction txn_new(2, IsolationLevel::SERIALIZABLE);
+  txn_mgr_.Begin(&txn_new);
+  std::thread new_thread{[&] {
+    EXPECT_THROW(range_locks_.LockKey(&txn_new, Key(7), LockMode::EXCLUSIVE), TransactionAbortException);
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  txn_new.SetState(TransactionState::ABORTED);
+  lock_mgr_.WakeAborted({txn_new.GetTransactionId()});
+  new_thread.join();
+  txn_mgr_.Abort(&txn_new);
+  txn_mgr_.Commit(&txn_old);
+  EXPECT_EQ(range_locks_.GetNumLocks(), 0);
+
+  // the waits and the wound show up in the contention profile of the lock manager
+  LockContentionSnapshot snapshot = lock_mgr_.GetContentionSnapshot();
+  EXPECT_EQ(snapshot.num_waits_, 2);
+  EXPECT_EQ(snapshot.aborts_[AbortReason::DEADLOCK], 1);
+}
+
+// NOLINTNEXTLINE
+TEST_F(KeyRangeLockTest, DeadlockDetectionTest) {
+  LockManager lock_mgr{LockManager::DEFAULT_NUM_SHARDS, DeadlockPolicy::DETECTION};
+  TransactionManager txn_mgr{&lock_mgr};
+  KeyRangeLockTable<GenericKey<8>, GenericComparator<8>> range_locks{comparator_, &lock_mgr};
+  const RID rid{0, 0};
+  Transaction txn_old(0, IsolationLevel::SERIALIZABLE);
+  Transaction txn_young(1, IsolationLevel::SERIALIZABLE);
+  txn_mgr.Begin(&txn_old);
+  txn_mgr.Begin(&txn_young);
+
+  // the older writer waits for the range of the younger scanner instead of wounding it, the scanner waits for the
+  // row of the writer, and cycle detection finds the cycle through both kinds of locks
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn_old, rid));
+  GenericKey<8> low = Key(10);
+  GenericKey<8> high = Key(20);
+  EXPECT_TRUE(range_locks.LockRange(&txn_young, &low, &high, LockMode::SHARED));
+  std::thread old_thread{[&] { EXPECT_TRUE(range_locks.LockKey(&txn_old, Key(15), LockMode::EXCLUSIVE)); }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_NE(txn_young.GetState(), TransactionState::ABORTED);
+  EXPECT_THROW(lock_mgr.LockShared(&txn_young, rid), TransactionAbortException);
+  EXPECT_EQ(lock_mgr.GetNumDeadlockAborts(), 1);
+  txn_mgr.Abort(&txn_young);
+  old_thread.join();
+  txn_mgr.Commit(&txn_old);
+  EXPECT_EQ(range_locks.GetNumLocks(), 0);
+}
+
+// NOLINTNEXTLINE
+TEST_F(KeyRangeLockTest, IndexWriterTest) {
+  DiskManager disk_manager("key_range_lock_test.db");
+  BufferPoolManagerInstance bpm(10, &disk_manager);
+  Catalog catalog(&bpm, &lock_mgr_, nullptr);
+  Transaction creator(0);
+  ASSERT_NE(catalog.CreateTable(&creator, "table", *key_schema_), Catalog::NULL_TABLE_INFO);
+  auto *index_info = catalog.CreateBPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      &creator, "index", "table", *key_schema_, *key_schema_, {0}, 8);
+  ASSERT_NE(index_info, Catalog::NULL_INDEX_INFO);
+  Index *index = index_info->index_.get();
+  Tuple key{std::vector<Value>{ValueFactory::GetBigIntValue(15)}, key_schema_.get()};
+
+  Transaction scanner(1, IsolationLevel::SERIALIZABLE);
+  Transaction writer(2, IsolationLevel::READ_COMMITTED);
+  txn_mgr_.Begin(&scanner);
+  txn_mgr_.Begin(&writer);
+  std::vector<RID> result;
+  index->ScanRange(nullptr, nullptr, &result, &scanner);
+
+  // the writer locks its key although it is not SERIALIZABLE itself
+  std::atomic<bool> inserted{false};
+  std::thread writer_thread{[&] {
+    index->InsertEntry(key, RID(0, 0), &writer);
+    inserted = true;
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(inserted);
+  txn_mgr_.Commit(&scanner);
+  writer_thread.join();
+  EXPECT_TRUE(inserted);
+  EXPECT_EQ(writer.GetRangeLockSet()->size(), 1);
+  txn_mgr_.Commit(&writer);
+  EXPECT_TRUE(writer.GetRangeLockSet()->empty());
+
+  disk_manager.ShutDown();
+  remove("key_range_lock_test.db");
+}
+
+// NOLINTNEXTLINE
+TEST_F(KeyRangeLockTest, BoundedIndexScanTest) {
+  DiskManager disk_manager("key_range_lock_test.db");
+  BufferPoolManagerInstance bpm(10, &disk_manager);
+  Catalog catalog(&bpm, &lock_mgr_, nullptr);
+  Transaction creator(0);
+  ASSERT_NE(catalog.CreateTable(&creator, "table", *key_schema_), Catalog::NULL_TABLE_INFO);
+  auto *index_info = catalog.CreateBPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      &creator, "index", "table", *key_schema_, *key_schema_, {0}, 8);
+  ASSERT_NE(index_info, Catalog::NULL_INDEX_INFO);
+  Index *index = index_info->index_.get();
+  Tuple low{std::vector<Value>{ValueFactory::GetBigIntValue(10)}, key_schema_.get()};
+  Tuple high{std::vector<Value>{ValueFactory::GetBigIntValue(20)}, key_schema_.get()};
+  Tuple outside{std::vector<Value>{ValueFactory::GetBigIntValue(25)}, key_schema_.get()};
+  Tuple inside{std::vector<Value>{ValueFactory::GetBigIntValue(15)}, key_schema_.get()};
+
+  Transaction scanner(1, IsolationLevel::SERIALIZABLE);
+  Transaction writer(2, IsolationLevel::READ_COMMITTED);
+  txn_mgr_.Begin(&scanner);
+  txn_mgr_.Begin(&writer);
+  std::vector<RID> result;
+  index->ScanRange(&low, &high, &result, &scanner);
+
+  // an insert outside of the scanned keys goes on, one inside of them waits until the scanner is done
+  index->InsertEntry(outside, RID(0, 0), &writer);
+  std::atomic<bool> inserted{false};
+  std::thread writer_thread{[&] {
+    index->InsertEntry(inside, RID(0, 1), &writer);
+    inserted = true;
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(inserted);
+  txn_mgr_.Commit(&scanner);
+  writer_thread.join();
+  EXPECT_TRUE(inserted);
+  txn_mgr_.Commit(&writer);
+
+  disk_manager.ShutDown();
+  remove("key_range_lock_test.db");
+}
+
+}  // namespace bustub
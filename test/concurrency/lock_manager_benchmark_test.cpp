@@ -0,0 +1,223 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lock_manager_benchmark_test.cpp
+//
+// Identification: test/concurrency/lock_manager_benchmark_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cinttypes>
+#include <cstdio>
+#include <random>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "concurrency/lock_manager.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+/*
+ * LockThroughput: lock throughput with 1 to 16 threads, with a single lock table shard and with the default number of
+ * shards. Every transaction locks 8 random rows out of its own thread's 1024, half of them shared and half exclusive,
+ * and unlocks them again. The rows never conflict, so the difference between the two runs is the contention on the
+ * latches.
+ */
+static constexpr auto BENCHMARK_DURATION = std::chrono::seconds(1);
+static constexpr int LOCKS_PER_TXN = 8;
+static constexpr uint32_t ROWS_PER_THREAD = 1024;
+
+/*
+ * DeadlockPolicy: commits and aborts under wound-wait and under cycle detection. Every transaction locks 4 rows out
+ * of 64 shared ones, a quarter of them exclusively, in random order, with a short pause after each lock. Aborted
+ * transactions are retried as new ones. Detection runs every 50ms and every 5ms.
+ */
+static constexpr int CONTENDED_LOCKS_PER_TXN = 4;
+static constexpr uint32_t CONTENDED_ROWS = 64;
+static constexpr auto THINK_TIME = std::chrono::microseconds(20);
+
+/*
+ * HotRowHandoff: how fast an exclusive lock on a single row passes from one transaction to the next, with 2 to 16
+ * threads queued up on it. The handoff latency is the time from an Unlock to the grant of the next transaction.
+ */
+static int64_t NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// NOLINTNEXTLINE
+TEST(LockManagerBenchmark, DISABLED_LockThroughput) {
+  printf("shards,threads,lock_ops,lock_ops_per_sec\n");
+  for (size_t num_shards : {static_cast<size_t>(1), LockManager::DEFAULT_NUM_SHARDS}) {
+    for (int num_threads : {1, 2, 4, 8, 16}) {
+      LockManager lock_manager{num_shards};
+      std::atomic<bool> stop{false};
+      std::atomic<txn_id_t> next_txn_id{0};
+      std::atomic<uint64_t> lock_ops{0};
+      std::vector<std::thread> threads;
+      for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back([&, i] {
+          std::mt19937 generator(i);
+          std::uniform_int_distribution<uint32_t> slot(0, ROWS_PER_THREAD - 1);
+          uint64_t ops = 0;
+          std::vector<RID> rids;
+          while (!stop) {
+            Transaction txn(next_txn_id++);
+            rids.clear();
+            for (int j = 0; j < LOCKS_PER_TXN; j++) {
+              RID rid(i, slot(generator));
+              // the transaction keeps track of its own locks
+              if (txn.IsSharedLocked(rid) || txn.IsExclusiveLocked(rid)) {
+                continue;
+              }
+              EXPECT_TRUE(j % 2 == 0 ? lock_manager.LockShared(&txn, rid) : lock_manager.LockExclusive(&txn, rid));
+              rids.push_back(rid);
+            }
+            for (const RID &rid : rids) {
+              EXPECT_TRUE(lock_manager.Unlock(&txn, rid));
+            }
+            ops += rids.size();
+          }
+          lock_ops += ops;
+        });
+      }
+      std::this_thread::sleep_for(BENCHMARK_DURATION);
+      stop = true;
+      for (auto &thread : threads) {
+        thread.join();
+      }
+
+      uint64_t total = lock_ops;
+      EXPECT_GT(total, 0);
+      printf("%zu,%d,%" PRIu64 ",%.0f\n", num_shards, num_threads, total,
+             total / std::chrono::duration<double>(BENCHMARK_DURATION).count());
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(LockManagerBenchmark, DISABLED_DeadlockPolicy) {
+  auto saved_interval = cycle_detection_interval;
+  printf("policy,detection_interval_ms,threads,commits,aborts,abort_rate,commits_per_sec\n");
+  // (policy, detection interval)
+  std::vector<std::pair<DeadlockPolicy, std::chrono::milliseconds>> configs{
+      {DeadlockPolicy::WOUND_WAIT, std::chrono::milliseconds(0)},
+      {DeadlockPolicy::DETECTION, std::chrono::milliseconds(50)},
+      {DeadlockPolicy::DETECTION, std::chrono::milliseconds(5)}};
+  for (auto [policy, interval] : configs) {
+    for (int num_threads : {2, 4, 8, 16}) {
+      cycle_detection_interval = interval;
+      LockManager lock_manager{LockManager::DEFAULT_NUM_SHARDS, policy};
+      std::atomic<bool> stop{false};
+      std::atomic<txn_id_t> next_txn_id{0};
+      std::atomic<uint64_t> commits{0};
+      std::atomic<uint64_t> aborts{0};
+      std::vector<std::thread> threads;
+      for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back([&, i] {
+          std::mt19937 generator(i);
+          std::uniform_int_distribution<uint32_t> slot(0, CONTENDED_ROWS - 1);
+          while (!stop) {
+            Transaction txn(next_txn_id++);
+            bool granted = true;
+            try {
+              for (int j = 0; j < CONTENDED_LOCKS_PER_TXN && granted; j++) {
+                RID rid(0, slot(generator));
+                if (txn.IsSharedLocked(rid) || txn.IsExclusiveLocked(rid)) {
+                  continue;
+                }
+                granted = j % 4 == 0 ? lock_manager.LockExclusive(&txn, rid) : lock_manager.LockShared(&txn, rid);
+                std::this_thread::sleep_for(THINK_TIME);
+              }
+            } catch (TransactionAbortException &e) {
+              granted = false;
+            }
+            // a wounded transaction only finds out at its next lock call, it must not commit either
+            if (granted && txn.GetState() != TransactionState::ABORTED) {
+              commits++;
+            } else {
+              aborts++;
+            }
+            std::vector<RID> rids(txn.GetSharedLockSet()->begin(), txn.GetSharedLockSet()->end());
+            rids.insert(rids.end(), txn.GetExclusiveLockSet()->begin(), txn.GetExclusiveLockSet()->end());
+            for (const RID &rid : rids) {
+              lock_manager.Unlock(&txn, rid);
+            }
+          }
+        });
+      }
+      std::this_thread::sleep_for(BENCHMARK_DURATION);
+      stop = true;
+      for (auto &thread : threads) {
+        thread.join();
+      }
+
+      uint64_t total_commits = commits;
+      uint64_t total_aborts = aborts;
+      EXPECT_GT(total_commits, 0);
+      printf("%s,%" PRId64 ",%d,%" PRIu64 ",%" PRIu64 ",%.3f,%.0f\n",
+             policy == DeadlockPolicy::WOUND_WAIT ? "wound_wait" : "detection",
+             static_cast<int64_t>(interval.count()), num_threads, total_commits, total_aborts,
+             static_cast<double>(total_aborts) / (total_commits + total_aborts),
+             total_commits / std::chrono::duration<double>(BENCHMARK_DURATION).count());
+    }
+  }
+  cycle_detection_interval = saved_interval;
+}
+
+// NOLINTNEXTLINE
+TEST(LockManagerBenchmark, DISABLED_HotRowHandoff) {
+  printf("threads,handoffs,handoffs_per_sec,avg_handoff_us\n");
+  for (int num_threads : {2, 4, 8, 16}) {
+    LockManager lock_manager;
+    RID hot_row(0, 0);
+    std::atomic<bool> stop{false};
+    std::atomic<txn_id_t> next_txn_id{0};
+    std::atomic<int64_t> released_at{0};
+    std::atomic<uint64_t> handoffs{0};
+    std::atomic<int64_t> handoff_nanos{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([&] {
+        while (!stop) {
+          Transaction txn(next_txn_id++);
+          try {
+            if (!lock_manager.LockExclusive(&txn, hot_row)) {
+              continue;
+            }
+          } catch (TransactionAbortException &e) {
+            lock_manager.Unlock(&txn, hot_row);
+            continue;
+          }
+          int64_t released = released_at.exchange(0);
+          if (released != 0) {
+            handoff_nanos += NowNanos() - released;
+            handoffs++;
+          }
+          released_at = NowNanos();
+          lock_manager.Unlock(&txn, hot_row);
+        }
+      });
+    }
+    std::this_thread::sleep_for(BENCHMARK_DURATION);
+    stop = true;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    uint64_t total = handoffs;
+    EXPECT_GT(total, 0U);
+    printf("%d,%" PRIu64 ",%.0f,%.2f\n", num_threads, total,
+           total / std::chrono::duration<double>(BENCHMARK_DURATION).count(),
+           static_cast<double>(handoff_nanos) / total / 1000);
+  }
+}
+
+}  // namespace bustub
@@ -2,13 +2,18 @@
  * lock_manager_test.cpp
  */
 
+#include <atomic>
+#include <numeric>
 #include <random>
 #include <thread>  // NOLINT
 
+#include "buffer/buffer_pool_manager_instance.h"
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "gtest/gtest.h"
+#include "storage/table/table_heap.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -204,4 +209,317 @@ void WoundWaitBasicTest() {
 }
 TEST(LockManagerTest, DISABLED_WoundWaitBasicTest) { WoundWaitBasicTest(); }
 
+// A wounded transaction that waits for another row must wake up, or the older transaction waits for it forever.
+void WoundWaitingTest() {
+  LockManager lock_mgr{2};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid_a{0, 0};
+  RID rid_b{0, 1};
+
+  Transaction txn_old(0);
+  Transaction txn_hold(1);
+  Transaction txn_die(2);
+  txn_mgr.Begin(&txn_old);
+  txn_mgr.Begin(&txn_hold);
+  txn_mgr.Begin(&txn_die);
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn_die, rid_a));
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn_hold, rid_b));
+
+  std::thread die_thread{[&] {
+    // waits for the older txn_hold, until txn_old wounds it
+    EXPECT_THROW(lock_mgr.LockExclusive(&txn_die, rid_b), TransactionAbortException);
+    CheckAborted(&txn_die);
+    txn_mgr.Abort(&txn_die);
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn_old, rid_a));
+  die_thread.join();
+  CheckGrowing(&txn_old);
+  CheckGrowing(&txn_hold);
+  txn_mgr.Commit(&txn_hold);
+  txn_mgr.Commit(&txn_old);
+}
+TEST(LockManagerTest, WoundWaitingTest) { WoundWaitingTest(); }
+
+// NOLINTNEXTLINE
+TEST(LockManagerTest, TableLockModeTest) {
+  EXPECT_TRUE(LockManager::Covers(LockMode::SHARED_INTENTION_EXCLUSIVE, LockMode::SHARED));
+  EXPECT_TRUE(LockManager::Covers(LockMode::SHARED_INTENTION_EXCLUSIVE, LockMode::INTENTION_EXCLUSIVE));
+  EXPECT_TRUE(LockManager::Covers(LockMode::INTENTION_EXCLUSIVE, LockMode::INTENTION_SHARED));
+  EXPECT_FALSE(LockManager::Covers(LockMode::SHARED, LockMode::INTENTION_EXCLUSIVE));
+  EXPECT_FALSE(LockManager::Covers(LockMode::SHARED_INTENTION_EXCLUSIVE, LockMode::EXCLUSIVE));
+  EXPECT_TRUE(LockManager::Compatible(LockMode::INTENTION_SHARED, LockMode::SHARED_INTENTION_EXCLUSIVE));
+  EXPECT_TRUE(LockManager::Compatible(LockMode::INTENTION_EXCLUSIVE, LockMode::INTENTION_EXCLUSIVE));
+  EXPECT_FALSE(LockManager::Compatible(LockMode::INTENTION_EXCLUSIVE, LockMode::SHARED));
+  EXPECT_FALSE(LockManager::Compatible(LockMode::SHARED_INTENTION_EXCLUSIVE, LockMode::SHARED));
+
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t oid = 3;
+  Transaction txn_old(0);
+  Transaction txn_young(1);
+  txn_mgr.Begin(&txn_old);
+  txn_mgr.Begin(&txn_young);
+
+  EXPECT_TRUE(lock_mgr.LockTable(&txn_young, oid, LockMode::INTENTION_EXCLUSIVE));
+  EXPECT_TRUE(lock_mgr.LockTable(&txn_old, oid, LockMode::INTENTION_SHARED));
+  // S on top of IX is SIX, which still lets the IS holder be
+  EXPECT_TRUE(lock_mgr.LockTable(&txn_young, oid, LockMode::SHARED));
+  EXPECT_EQ(txn_young.GetTableLockSet()->at(oid), LockMode::SHARED_INTENTION_EXCLUSIVE);
+  EXPECT_TRUE(LockManager::IsTableLocked(&txn_young, oid, LockMode::SHARED));
+  EXPECT_FALSE(LockManager::IsTableLocked(&txn_old, oid, LockMode::SHARED));
+
+  // the older transaction's upgrade to IX conflicts with SIX and wounds the younger one
+  EXPECT_TRUE(lock_mgr.LockTable(&txn_old, oid, LockMode::INTENTION_EXCLUSIVE));
+  CheckAborted(&txn_young);
+  txn_mgr.Abort(&txn_young);
+  EXPECT_TRUE(txn_young.GetTableLockSet()->empty());
+
+  // a younger transaction waits for the older one's IX before it gets S
+  Transaction txn_reader(2);
+  txn_mgr.Begin(&txn_reader);
+  std::atomic<bool> granted{false};
+  std::thread reader{[&] {
+    EXPECT_TRUE(lock_mgr.LockTable(&txn_reader, oid, LockMode::SHARED));
+    granted = true;
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(granted);
+  txn_mgr.Commit(&txn_old);
+  reader.join();
+  EXPECT_TRUE(granted);
+  CheckGrowing(&txn_reader);
+  txn_mgr.Commit(&txn_reader);
+}
+
+// NOLINTNEXTLINE
+TEST(LockManagerTest, LockEscalationTest) {
+  size_t saved_threshold = lock_escalation_threshold;
+  lock_escalation_threshold = 10;
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t written = 1;
+  table_oid_t read = 2;
+  Transaction txn(0);
+  txn_mgr.Begin(&txn);
+
+  // the eleventh row lock in a table turns them into one table lock, the strongest mode among the rows
+  EXPECT_TRUE(lock_mgr.LockTable(&txn, written, LockMode::INTENTION_EXCLUSIVE));
+  for (uint32_t i = 0; i < 10; i++) {
+    EXPECT_TRUE(lock_mgr.LockShared(&txn, RID(0, i), written));
+  }
+  EXPECT_TRUE(lock_mgr.LockUpgrade(&txn, RID(0, 5), written));
+  CheckTxnLockSize(&txn, 9, 1);
+  EXPECT_EQ(lock_mgr.GetNumEscalations(), 0);
+  EXPECT_TRUE(lock_mgr.LockShared(&txn, RID(0, 10), written));
+  EXPECT_EQ(lock_mgr.GetNumEscalations(), 1);
+  CheckTxnLockSize(&txn, 0, 0);
+  EXPECT_EQ(txn.GetTableLockSet()->at(written), LockMode::EXCLUSIVE);
+  // rows of the table need no locks of their own anymore
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn, RID(0, 11), written));
+  CheckTxnLockSize(&txn, 0, 0);
+
+  for (uint32_t i = 0; i < 11; i++) {
+    EXPECT_TRUE(lock_mgr.LockShared(&txn, RID(1, i), read));
+  }
+  EXPECT_EQ(lock_mgr.GetNumEscalations(), 2);
+  EXPECT_EQ(txn.GetTableLockSet()->at(read), LockMode::SHARED);
+  CheckTxnLockSize(&txn, 0, 0);
+
+  // the released rows are free for others, the table is not
+  Transaction other(1);
+  txn_mgr.Begin(&other);
+  EXPECT_TRUE(lock_mgr.LockExclusive(&other, RID(1, 0)));
+  txn_mgr.Commit(&other);
+  txn_mgr.Commit(&txn);
+  EXPECT_TRUE(txn.GetTableLockSet()->empty());
+  lock_escalation_threshold = saved_threshold;
+}
+
+// NOLINTNEXTLINE
+TEST(LockManagerTest, DeferredLockEscalationTest) {
+  size_t saved_threshold = lock_escalation_threshold;
+  lock_escalation_threshold = 10;
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t oid = 1;
+  Transaction txn(0);
+  txn_mgr.Begin(&txn);
+
+  // under a page latch the row locks pile up, the table lock is only taken once the caller asks for it
+  EXPECT_TRUE(lock_mgr.LockTable(&txn, oid, LockMode::INTENTION_EXCLUSIVE));
+  for (uint32_t i = 0; i < 12; i++) {
+    EXPECT_TRUE(lock_mgr.LockExclusive(&txn, RID(0, i), oid, false));
+  }
+  EXPECT_EQ(lock_mgr.GetNumEscalations(), 0);
+  CheckTxnLockSize(&txn, 0, 12);
+  lock_mgr.EscalateIfDue(&txn, oid);
+  EXPECT_EQ(lock_mgr.GetNumEscalations(), 1);
+  CheckTxnLockSize(&txn, 0, 0);
+  EXPECT_EQ(txn.GetTableLockSet()->at(oid), LockMode::EXCLUSIVE);
+  lock_mgr.EscalateIfDue(&txn, oid);
+  EXPECT_EQ(lock_mgr.GetNumEscalations(), 1);
+  txn_mgr.Commit(&txn);
+  lock_escalation_threshold = saved_threshold;
+}
+
+// NOLINTNEXTLINE
+TEST(LockManagerTest, ScanLockEscalationTest) {
+  size_t saved_threshold = lock_escalation_threshold;
+  DiskManager disk_manager("lock_manager_test.db");
+  LogManager log_manager(&disk_manager);
+  BufferPoolManagerInstance bpm(10, &disk_manager, &log_manager);
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr, &log_manager};
+  log_manager.RunFlushThread();
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  table_oid_t oid = 1;
+
+  Transaction *creator = txn_mgr.Begin();
+  TableHeap table(&bpm, &lock_mgr, &log_manager, creator, oid);
+  for (int i = 0; i < 20; i++) {
+    RID rid;
+    ASSERT_TRUE(table.InsertTuple(Tuple{{ValueFactory::GetIntegerValue(i)}, &schema}, &rid, creator));
+  }
+  txn_mgr.Commit(creator);
+  lock_escalation_threshold = 10;
+
+  // the scan crosses the threshold while an older transaction holds the table, it waits for the table lock without
+  // the page latch, so the holder can still write to the page it scans
+  Transaction *holder = txn_mgr.Begin();
+  Transaction *scanner = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockTable(holder, oid, LockMode::INTENTION_EXCLUSIVE));
+  std::atomic<int> scanned{0};
+  std::thread scan_thread{[&] {
+    for (auto iter = table.Begin(scanner); iter != table.End(); ++iter) {
+      scanned++;
+    }
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_LE(scanned, 11);
+  RID rid;
+  EXPECT_TRUE(table.InsertTuple(Tuple{{ValueFactory::GetIntegerValue(20)}, &schema}, &rid, holder));
+  txn_mgr.Commit(holder);
+  scan_thread.join();
+  EXPECT_EQ(scanned, 21);
+  EXPECT_EQ(lock_mgr.GetNumEscalations(), 1);
+  EXPECT_EQ(scanner->GetTableLockSet()->at(oid), LockMode::SHARED);
+  txn_mgr.Commit(scanner);
+
+  log_manager.StopFlushThread();
+  disk_manager.ShutDown();
+  remove("lock_manager_test.db");
+  delete creator;
+  delete holder;
+  delete scanner;
+  lock_escalation_threshold = saved_threshold;
+}
+
+// NOLINTNEXTLINE
+TEST(LockManagerTest, WaitsForGraphTest) {
+  LockManager lock_mgr{};
+  lock_mgr.AddEdge(0, 1);
+  lock_mgr.AddEdge(1, 2);
+  lock_mgr.AddEdge(1, 2);
+  EXPECT_EQ(lock_mgr.GetEdgeList().size(), 2);
+  txn_id_t victim = INVALID_TXN_ID;
+  EXPECT_FALSE(lock_mgr.HasCycle(&victim));
+
+  // the youngest transaction of the cycle is the victim
+  lock_mgr.AddEdge(2, 0);
+  EXPECT_TRUE(lock_mgr.HasCycle(&victim));
+  EXPECT_EQ(victim, 2);
+  lock_mgr.RemoveEdge(2, 0);
+  EXPECT_FALSE(lock_mgr.HasCycle(&victim));
+  EXPECT_EQ(lock_mgr.GetEdgeList().size(), 2);
+}
+
+// Two transactions lock two rows in opposite order, cycle detection aborts the younger one.
+void DeadlockDetectionTest(bool upgrade) {
+  LockManager lock_mgr{LockManager::DEFAULT_NUM_SHARDS, DeadlockPolicy::DETECTION};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid_a{0, 0};
+  RID rid_b{0, 1};
+  Transaction txn_old(0);
+  Transaction txn_young(1);
+  txn_mgr.Begin(&txn_old);
+  txn_mgr.Begin(&txn_young);
+
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn_old, rid_a));
+  if (upgrade) {
+    EXPECT_TRUE(lock_mgr.LockShared(&txn_young, rid_b));
+    EXPECT_TRUE(lock_mgr.LockShared(&txn_old, rid_b));
+  } else {
+    EXPECT_TRUE(lock_mgr.LockExclusive(&txn_young, rid_b));
+  }
+  std::thread young_thread{[&] {
+    // without wound-wait the older transaction does not abort us, we wait for it
+    EXPECT_THROW(lock_mgr.LockShared(&txn_young, rid_a), TransactionAbortException);
+    CheckAborted(&txn_young);
+    txn_mgr.Abort(&txn_young);
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_TRUE(upgrade ? lock_mgr.LockUpgrade(&txn_old, rid_b) : lock_mgr.LockExclusive(&txn_old, rid_b));
+  young_thread.join();
+  CheckGrowing(&txn_old);
+  EXPECT_EQ(lock_mgr.GetNumDeadlockAborts(), 1);
+  txn_mgr.Commit(&txn_old);
+}
+TEST(LockManagerTest, DeadlockDetectionTest) {
+  DeadlockDetectionTest(false);
+  DeadlockDetectionTest(true);
+}
+
+// NOLINTNEXTLINE
+TEST(LockManagerTest, ContentionProfileTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid{0, 0};
+  table_oid_t oid = 7;
+  Transaction txn_old(0);
+  Transaction txn_young(1);
+  txn_mgr.Begin(&txn_old);
+  txn_mgr.Begin(&txn_young);
+
+  // the younger transaction waits for the row until the older one commits
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn_old, rid));
+  std::thread young_thread{[&] { EXPECT_TRUE(lock_mgr.LockShared(&txn_young, rid, oid)); }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  txn_mgr.Commit(&txn_old);
+  young_thread.join();
+  txn_mgr.Commit(&txn_young);
+
+  LockContentionSnapshot snapshot = lock_mgr.GetContentionSnapshot();
+  EXPECT_EQ(snapshot.num_requests_, 2);
+  EXPECT_EQ(snapshot.num_waits_, 1);
+  EXPECT_GE(snapshot.total_wait_us_, 10000);
+  ASSERT_EQ(snapshot.hot_rows_.size(), 1);
+  EXPECT_EQ(snapshot.hot_rows_[0].first, rid);
+  EXPECT_EQ(snapshot.hot_rows_[0].second, 1);
+  ASSERT_EQ(snapshot.hot_tables_.size(), 1);
+  EXPECT_EQ(snapshot.hot_tables_[0].first, oid);
+  EXPECT_EQ(std::accumulate(snapshot.wait_us_histogram_.begin(), snapshot.wait_us_histogram_.end(), uint64_t{0}), 1);
+  // one request found the queue empty, the other found one request before it
+  EXPECT_EQ(snapshot.queue_length_histogram_[0], 1);
+  EXPECT_EQ(snapshot.queue_length_histogram_[1], 1);
+  EXPECT_TRUE(snapshot.aborts_.empty());
+
+  // a shrinking transaction that locks again is counted by its reason
+  Transaction txn_shrinking(2);
+  txn_mgr.Begin(&txn_shrinking);
+  txn_shrinking.SetState(TransactionState::SHRINKING);
+  EXPECT_THROW(lock_mgr.LockShared(&txn_shrinking, rid), TransactionAbortException);
+  txn_mgr.Abort(&txn_shrinking);
+  snapshot = lock_mgr.GetContentionSnapshot();
+  EXPECT_EQ(snapshot.aborts_[AbortReason::LOCK_ON_SHRINKING], 1);
+  EXPECT_FALSE(snapshot.ToString().empty());
+
+  lock_mgr.ResetContention();
+  snapshot = lock_mgr.GetContentionSnapshot();
+  EXPECT_EQ(snapshot.num_requests_, 0);
+  EXPECT_TRUE(snapshot.hot_rows_.empty());
+  EXPECT_TRUE(snapshot.aborts_.empty());
+}
+
 }  // namespace bustub
@@ -0,0 +1,172 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// optimistic_transaction_test.cpp
+//
+// Identification: test/concurrency/optimistic_transaction_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "storage/table/table_heap.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+class OptimisticTransactionTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    ::testing::Test::SetUp();
+    disk_manager_ = std::make_unique<DiskManager>("optimistic_transaction_test.db");
+    bpm_ = std::make_unique<BufferPoolManagerInstance>(50, disk_manager_.get());
+    lock_manager_ = std::make_unique<LockManager>();
+    txn_mgr_ = std::make_unique<TransactionManager>(lock_manager_.get());
+
+    // three committed rows 0, 1 and 2
+    Transaction *txn = txn_mgr_->Begin();
+    table_ = std::make_unique<TableHeap>(bpm_.get(), lock_manager_.get(), nullptr, txn);
+    for (int i = 0; i < 3; i++) {
+      RID rid;
+      ASSERT_TRUE(table_->InsertTuple(MakeTuple(i), &rid, txn));
+      rids_.push_back(rid);
+    }
+    txn_mgr_->Commit(txn);
+    delete txn;
+  }
+
+  void TearDown() override {
+    disk_manager_->ShutDown();
+    remove("optimistic_transaction_test.db");
+  }
+
+  Transaction *BeginOptimistic() {
+    return txn_mgr_->Begin(nullptr, IsolationLevel::REPEATABLE_READ, ConcurrencyControl::OPTIMISTIC);
+  }
+
+  Tuple MakeTuple(int value) { return Tuple{{ValueFactory::GetIntegerValue(value)}, &schema_}; }
+
+  /** @return the value of the row as txn sees it, -1 if it does not see the row */
+  int Read(const RID &rid, Transaction *txn) {
+    Tuple tuple;
+    return table_->GetTuple(rid, &tuple, txn) ? tuple.GetValue(&schema_, 0).GetAs<int32_t>() : -1;
+  }
+
+  /** @return the values of all rows txn sees, sorted */
+  std::vector<int> Scan(Transaction *txn) {
+    std::vector<int> values;
+    for (auto iter = table_->Begin(txn); iter != table_->End(); ++iter) {
+      values.push_back(iter->GetValue(&schema_, 0).GetAs<int32_t>());
+    }
+    std::sort(values.begin(), values.end());
+    return values;
+  }
+
+  Schema schema_{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  std::unique_ptr<DiskManager> disk_manager_;
+  std::unique_ptr<BufferPoolManagerInstance> bpm_;
+  std::unique_ptr<LockManager> lock_manager_;
+  std::unique_ptr<TransactionManager> txn_mgr_;
+  std::unique_ptr<TableHeap> table_;
+  std::vector<RID> rids_;
+};
+
+// NOLINTNEXTLINE
+TEST_F(OptimisticTransactionTest, BufferedWriteTest) {
+  Transaction *txn = BeginOptimistic();
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100), rids_[0], txn));
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(101), rids_[0], txn));
+  ASSERT_TRUE(table_->MarkDelete(rids_[1], txn));
+  EXPECT_FALSE(table_->MarkDelete(rids_[1], txn));
+
+  // the transaction sees its own writes, nobody else does before the commit
+  EXPECT_EQ(101, Read(rids_[0], txn));
+  EXPECT_EQ(-1, Read(rids_[1], txn));
+  EXPECT_EQ((std::vector<int>{2, 101}), Scan(txn));
+  Transaction *reader = txn_mgr_->Begin();
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), Scan(reader));
+  txn_mgr_->Commit(reader);
+
+  // nothing was locked before the commit
+  EXPECT_TRUE(txn->GetSharedLockSet()->empty());
+  EXPECT_TRUE(txn->GetExclusiveLockSet()->empty());
+  EXPECT_EQ(3, txn->GetBufferedWriteSet()->size());
+
+  EXPECT_TRUE(txn_mgr_->Commit(txn));
+  EXPECT_EQ(TransactionState::COMMITTED, txn->GetState());
+  EXPECT_TRUE(txn->GetExclusiveLockSet()->empty());
+  Transaction *new_reader = txn_mgr_->Begin();
+  EXPECT_EQ((std::vector<int>{2, 101}), Scan(new_reader));
+  txn_mgr_->Commit(new_reader);
+
+  delete txn;
+  delete reader;
+  delete new_reader;
+}
+
+// NOLINTNEXTLINE
+TEST_F(OptimisticTransactionTest, ValidationTest) {
+  // row 0 changes after the optimistic transaction read it
+  Transaction *txn = BeginOptimistic();
+  EXPECT_EQ(0, Read(rids_[0], txn));
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100), rids_[1], txn));
+  Transaction *writer = txn_mgr_->Begin();
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(200), rids_[0], writer));
+  txn_mgr_->Commit(writer);
+
+  EXPECT_FALSE(txn_mgr_->Commit(txn));
+  EXPECT_EQ(TransactionState::ABORTED, txn->GetState());
+  EXPECT_TRUE(txn->GetExclusiveLockSet()->empty());
+  Transaction *reader = txn_mgr_->Begin();
+  EXPECT_EQ((std::vector<int>{1, 2, 200}), Scan(reader));
+  txn_mgr_->Commit(reader);
+
+  // row 0 did not change yet, but somebody holds the lock to change it
+  Transaction *retry = BeginOptimistic();
+  EXPECT_EQ(200, Read(rids_[0], retry));
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100), rids_[1], retry));
+  Transaction *locker = txn_mgr_->Begin();
+  ASSERT_TRUE(lock_manager_->LockExclusive(locker, rids_[0]));
+  EXPECT_FALSE(txn_mgr_->Commit(retry));
+  txn_mgr_->Commit(locker);
+
+  delete txn;
+  delete writer;
+  delete reader;
+  delete retry;
+  delete locker;
+}
+
+// NOLINTNEXTLINE
+TEST_F(OptimisticTransactionTest, WriteSkewTest) {
+  // both read rows 0 and 1 and write one of them, serially the second would have seen the write of the first
+  Transaction *txn1 = BeginOptimistic();
+  Transaction *txn2 = BeginOptimistic();
+  for (Transaction *txn : {txn1, txn2}) {
+    EXPECT_EQ(0, Read(rids_[0], txn));
+    EXPECT_EQ(1, Read(rids_[1], txn));
+  }
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(10), rids_[0], txn1));
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(11), rids_[1], txn2));
+
+  EXPECT_TRUE(txn_mgr_->Commit(txn1));
+  EXPECT_FALSE(txn_mgr_->Commit(txn2));
+  Transaction *reader = txn_mgr_->Begin();
+  EXPECT_EQ((std::vector<int>{1, 2, 10}), Scan(reader));
+  txn_mgr_->Commit(reader);
+
+  delete txn1;
+  delete txn2;
+  delete reader;
+}
+
+}  // namespace bustub
@@ -0,0 +1,137 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// transaction_benchmark_test.cpp
+//
+// Identification: test/concurrency/transaction_benchmark_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "catalog/table_generator.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "storage/table/table_heap.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+/*
+ * OptimisticVsLocking: commits and aborts of optimistic transactions and of two-phase locking ones. Every transaction
+ * reads 8 of 1024 rows and increments 2 of them, with a short pause after each access. The rows come from a uniform
+ * distribution, and from a Zipf distribution with theta 0.99 under which a few rows take most of the accesses.
+ * Aborted transactions are retried as new ones.
+ */
+static constexpr auto BENCHMARK_DURATION = std::chrono::seconds(1);
+static constexpr uint32_t NUM_ROWS = 1024;
+static constexpr int READS_PER_TXN = 8;
+static constexpr int WRITES_PER_TXN = 2;
+static constexpr uint32_t KEYS_PER_THREAD = 1 << 16;
+static constexpr auto THINK_TIME = std::chrono::microseconds(20);
+
+// NOLINTNEXTLINE
+TEST(TransactionBenchmark, DISABLED_OptimisticVsLocking) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  printf("concurrency_control,dist,threads,commits,aborts,abort_rate,commits_per_sec\n");
+  for (auto concurrency_control : {ConcurrencyControl::TWO_PHASE_LOCKING, ConcurrencyControl::OPTIMISTIC}) {
+    for (auto dist : {TableGenerator::Dist::Uniform, TableGenerator::Dist::Zipf_99}) {
+      for (int num_threads : {1, 2, 4, 8}) {
+        DiskManager disk_manager("transaction_benchmark_test.db");
+        BufferPoolManagerInstance bpm(64, &disk_manager);
+        LockManager lock_manager;
+        TransactionManager txn_mgr(&lock_manager);
+        std::vector<RID> rids;
+        Transaction *setup = txn_mgr.Begin();
+        TableHeap table(&bpm, &lock_manager, nullptr, setup);
+        for (uint32_t i = 0; i < NUM_ROWS; i++) {
+          RID rid;
+          ASSERT_TRUE(table.InsertTuple(Tuple{{ValueFactory::GetIntegerValue(0)}, &schema}, &rid, setup));
+          rids.push_back(rid);
+        }
+        txn_mgr.Commit(setup);
+        delete setup;
+
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> commits{0};
+        std::atomic<uint64_t> aborts{0};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_threads; i++) {
+          threads.emplace_back([&, i] {
+            std::vector<uint64_t> keys = TableGenerator::GenerateKeys(dist, NUM_ROWS, KEYS_PER_THREAD, i + 1);
+            size_t next_key = 0;
+            while (!stop) {
+              Transaction *txn = txn_mgr.Begin(nullptr, IsolationLevel::REPEATABLE_READ, concurrency_control);
+              bool locking = concurrency_control == ConcurrencyControl::TWO_PHASE_LOCKING;
+              bool ok = true;
+              try {
+                std::vector<std::pair<RID, int>> read;
+                for (int j = 0; j < READS_PER_TXN && ok; j++) {
+                  RID rid = rids[keys[next_key++ % keys.size()]];
+                  ok = !locking || txn->IsSharedLocked(rid) || txn->IsExclusiveLocked(rid) ||
+                       lock_manager.LockShared(txn, rid);
+                  Tuple tuple;
+                  ok = ok && table.GetTuple(rid, &tuple, txn);
+                  read.emplace_back(rid, ok ? tuple.GetValue(&schema, 0).GetAs<int32_t>() : 0);
+                  std::this_thread::sleep_for(THINK_TIME);
+                }
+                for (int j = 0; j < WRITES_PER_TXN && ok; j++) {
+                  const auto &row = read[j];
+                  ok = !locking || txn->IsExclusiveLocked(row.first) || lock_manager.LockUpgrade(txn, row.first);
+                  ok = ok && table.UpdateTuple(Tuple{{ValueFactory::GetIntegerValue(row.second + 1)}, &schema},
+                                               row.first, txn);
+                  std::this_thread::sleep_for(THINK_TIME);
+                }
+              } catch (TransactionAbortException &e) {
+                ok = false;
+              }
+              // a wounded transaction only finds out at its next lock call, it must not commit either, and an
+              // optimistic one that fails validation is aborted by Commit()
+              if (ok && txn->GetState() != TransactionState::ABORTED) {
+                if (txn_mgr.Commit(txn)) {
+                  commits++;
+                } else {
+                  aborts++;
+                }
+              } else {
+                txn_mgr.Abort(txn);
+                aborts++;
+              }
+              delete txn;
+            }
+          });
+        }
+        std::this_thread::sleep_for(BENCHMARK_DURATION);
+        stop = true;
+        for (auto &thread : threads) {
+          thread.join();
+        }
+        disk_manager.ShutDown();
+        remove("transaction_benchmark_test.db");
+
+        uint64_t total_commits = commits;
+        uint64_t total_aborts = aborts;
+        EXPECT_GT(total_commits, 0U);
+        printf("%s,%s,%d,%" PRIu64 ",%" PRIu64 ",%.3f,%.0f\n",
+               concurrency_control == ConcurrencyControl::OPTIMISTIC ? "optimistic" : "two_phase_locking",
+               dist == TableGenerator::Dist::Uniform ? "uniform" : "zipf_99", num_threads, total_commits,
+               total_aborts, static_cast<double>(total_aborts) / (total_commits + total_aborts),
+               total_commits / std::chrono::duration<double>(BENCHMARK_DURATION).count());
+      }
+    }
+  }
+}
+
+}  // namespace bustub
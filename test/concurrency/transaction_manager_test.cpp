@@ -0,0 +1,102 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// transaction_manager_test.cpp
+//
+// Identification: test/concurrency/transaction_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <memory>
+#include <thread>  // NOLINT
+#include <unordered_set>
+#include <vector>
+
+#include "concurrency/lock_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(TransactionManagerTest, RegistryTest) {
+  static constexpr int NUM_THREADS = 4;
+  static constexpr int TXNS_PER_THREAD = 100;
+  LockManager lock_mgr{LockManager::DEFAULT_NUM_SHARDS, DeadlockPolicy::DETECTION};
+  TransactionManager txn_mgr{&lock_mgr};
+
+  // the threads take the ids in batches, they are unique all the same
+  std::vector<std::vector<Transaction *>> txns(NUM_THREADS);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < NUM_THREADS; i++) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < TXNS_PER_THREAD; j++) {
+        txns[i].push_back(txn_mgr.Begin());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::unordered_set<txn_id_t> txn_ids;
+  for (const auto &thread_txns : txns) {
+    for (size_t j = 0; j < thread_txns.size(); j++) {
+      txn_ids.insert(thread_txns[j]->GetTransactionId());
+      EXPECT_EQ(TransactionManager::GetTransaction(thread_txns[j]->GetTransactionId()), thread_txns[j]);
+      // the transactions of one thread get growing ids
+      if (j > 0) {
+        EXPECT_LT(thread_txns[j - 1]->GetTransactionId(), thread_txns[j]->GetTransactionId());
+      }
+    }
+  }
+  EXPECT_EQ(txn_ids.size(), NUM_THREADS * TXNS_PER_THREAD);
+  EXPECT_EQ(TransactionManager::txn_registry.Size(), NUM_THREADS * TXNS_PER_THREAD);
+
+  // finished transactions leave the registry
+  for (const auto &thread_txns : txns) {
+    for (size_t j = 0; j < thread_txns.size(); j++) {
+      if (j % 2 == 0) {
+        txn_mgr.Commit(thread_txns[j]);
+      } else {
+        txn_mgr.Abort(thread_txns[j]);
+      }
+      delete thread_txns[j];
+    }
+  }
+  EXPECT_EQ(TransactionManager::txn_registry.Size(), 0);
+
+  // a batch of this thread does not carry over to a new transaction manager
+  TransactionManager new_txn_mgr{&lock_mgr};
+  Transaction *txn = new_txn_mgr.Begin();
+  Transaction *next_txn = new_txn_mgr.Begin();
+  EXPECT_EQ(txn->GetTransactionId(), 0);
+  EXPECT_EQ(next_txn->GetTransactionId(), 1);
+  new_txn_mgr.Commit(txn);
+  new_txn_mgr.Commit(next_txn);
+  delete txn;
+  delete next_txn;
+}
+
+// NOLINTNEXTLINE
+TEST(TransactionManagerTest, WoundWaitAgeTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+
+  // wound-wait takes the id for the age, so the ids follow the order in which the transactions began on any thread
+  Transaction *first = txn_mgr.Begin();
+  Transaction *second = nullptr;
+  std::thread thread{[&] { second = txn_mgr.Begin(); }};
+  thread.join();
+  Transaction *third = txn_mgr.Begin();
+  EXPECT_LT(first->GetTransactionId(), second->GetTransactionId());
+  EXPECT_LT(second->GetTransactionId(), third->GetTransactionId());
+  for (Transaction *txn : {first, second, third}) {
+    txn_mgr.Commit(txn);
+    delete txn;
+  }
+}
+
+}  // namespace bustub
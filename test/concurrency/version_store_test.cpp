@@ -0,0 +1,215 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store_test.cpp
+//
+// Identification: test/concurrency/version_store_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "concurrency/transaction_manager.h"
+#include "concurrency/version_store.h"
+#include "gtest/gtest.h"
+#include "storage/table/table_heap.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+class VersionStoreTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    ::testing::Test::SetUp();
+    disk_manager_ = std::make_unique<DiskManager>("version_store_test.db");
+    bpm_ = std::make_unique<BufferPoolManagerInstance>(50, disk_manager_.get());
+    lock_manager_ = std::make_unique<LockManager>();
+    txn_mgr_ = std::make_unique<TransactionManager>(lock_manager_.get());
+
+    // three committed rows 0, 1 and 2
+    Transaction *txn = txn_mgr_->Begin();
+    table_ = std::make_unique<TableHeap>(bpm_.get(), lock_manager_.get(), nullptr, txn);
+    for (int i = 0; i < 3; i++) {
+      rids_.push_back(Insert(i, txn));
+    }
+    txn_mgr_->Commit(txn);
+    delete txn;
+    // no snapshot is running, so the inserts keep no versions
+    ASSERT_EQ(0, txn_mgr_->GetVersionStore()->GetNumVersions());
+  }
+
+  void TearDown() override {
+    disk_manager_->ShutDown();
+    remove("version_store_test.db");
+  }
+
+  RID Insert(int value, Transaction *txn) {
+    RID rid;
+    EXPECT_TRUE(table_->InsertTuple(MakeTuple(value), &rid, txn));
+    return rid;
+  }
+
+  Tuple MakeTuple(int value) { return Tuple{{ValueFactory::GetIntegerValue(value)}, &schema_}; }
+
+  /** @return the value of the row as txn sees it, -1 if it does not see the row */
+  int Read(const RID &rid, Transaction *txn) {
+    Tuple tuple;
+    return table_->GetTuple(rid, &tuple, txn) ? tuple.GetValue(&schema_, 0).GetAs<int32_t>() : -1;
+  }
+
+  /** @return the values of all rows txn sees, sorted */
+  std::vector<int> Scan(Transaction *txn) {
+    std::vector<int> values;
+    for (auto iter = table_->Begin(txn); iter != table_->End(); ++iter) {
+      values.push_back(iter->GetValue(&schema_, 0).GetAs<int32_t>());
+    }
+    std::sort(values.begin(), values.end());
+    return values;
+  }
+
+  Schema schema_{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  std::unique_ptr<DiskManager> disk_manager_;
+  std::unique_ptr<BufferPoolManagerInstance> bpm_;
+  std::unique_ptr<LockManager> lock_manager_;
+  std::unique_ptr<TransactionManager> txn_mgr_;
+  std::unique_ptr<TableHeap> table_;
+  std::vector<RID> rids_;
+};
+
+// NOLINTNEXTLINE
+TEST_F(VersionStoreTest, SnapshotReadTest) {
+  Transaction *reader = txn_mgr_->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  Transaction *writer = txn_mgr_->Begin();
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100), rids_[0], writer));
+  ASSERT_TRUE(table_->MarkDelete(rids_[1], writer));
+  RID inserted = Insert(3, writer);
+
+  // the uncommitted writes are invisible, the writer sees its own
+  EXPECT_EQ(0, Read(rids_[0], reader));
+  EXPECT_EQ(1, Read(rids_[1], reader));
+  EXPECT_EQ(-1, Read(inserted, reader));
+  EXPECT_EQ(100, Read(rids_[0], writer));
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), Scan(reader));
+
+  // the commit removes row 1 from its page, the snapshot still sees it
+  txn_mgr_->Commit(writer);
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), Scan(reader));
+  Transaction *new_reader = txn_mgr_->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  EXPECT_EQ((std::vector<int>{2, 3, 100}), Scan(new_reader));
+
+  // nothing was locked for reading
+  EXPECT_TRUE(reader->GetSharedLockSet()->empty());
+  EXPECT_TRUE(new_reader->GetSharedLockSet()->empty());
+
+  // once the old snapshot is gone nobody needs the versions
+  EXPECT_EQ(3, txn_mgr_->GetVersionStore()->GetNumVersions());
+  txn_mgr_->Commit(reader);
+  txn_mgr_->Commit(new_reader);
+  txn_mgr_->GetVersionStore()->GarbageCollect();
+  EXPECT_EQ(0, txn_mgr_->GetVersionStore()->GetNumVersions());
+
+  delete reader;
+  delete new_reader;
+  delete writer;
+}
+
+// NOLINTNEXTLINE
+TEST_F(VersionStoreTest, WriteConflictTest) {
+  Transaction *old_snapshot = txn_mgr_->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  Transaction *writer = txn_mgr_->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100), rids_[0], writer));
+  txn_mgr_->Commit(writer);
+
+  // first committer wins, the row changed after the snapshot was taken
+  bool aborted = false;
+  try {
+    table_->UpdateTuple(MakeTuple(200), rids_[0], old_snapshot);
+  } catch (TransactionAbortException &e) {
+    aborted = true;
+    EXPECT_EQ(AbortReason::WRITE_CONFLICT, e.GetAbortReason());
+  }
+  EXPECT_TRUE(aborted);
+  EXPECT_EQ(TransactionState::ABORTED, old_snapshot->GetState());
+  txn_mgr_->Abort(old_snapshot);
+
+  // rows that did not change can be written, and so can the changed row by a newer snapshot
+  Transaction *new_snapshot = txn_mgr_->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  EXPECT_TRUE(table_->UpdateTuple(MakeTuple(300), rids_[0], new_snapshot));
+  EXPECT_TRUE(table_->MarkDelete(rids_[1], new_snapshot));
+  txn_mgr_->Commit(new_snapshot);
+
+  Transaction *reader = txn_mgr_->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  EXPECT_EQ((std::vector<int>{2, 300}), Scan(reader));
+  txn_mgr_->Commit(reader);
+
+  delete old_snapshot;
+  delete writer;
+  delete new_snapshot;
+  delete reader;
+}
+
+// NOLINTNEXTLINE
+TEST_F(VersionStoreTest, AbortTest) {
+  Transaction *reader = txn_mgr_->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  Transaction *writer = txn_mgr_->Begin();
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100), rids_[0], writer));
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(101), rids_[0], writer));
+  ASSERT_TRUE(table_->MarkDelete(rids_[2], writer));
+  EXPECT_EQ(0, Read(rids_[0], reader));
+
+  // the rollback takes the versions back, the pages hold the old rows again
+  txn_mgr_->Abort(writer);
+  EXPECT_EQ(0, txn_mgr_->GetVersionStore()->GetNumVersions());
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), Scan(reader));
+  txn_mgr_->Commit(reader);
+
+  delete reader;
+  delete writer;
+}
+
+// NOLINTNEXTLINE
+TEST_F(VersionStoreTest, NoSnapshotTest) {
+  // without a snapshot the writes keep no versions
+  Transaction *writer = txn_mgr_->Begin();
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100), rids_[0], writer));
+  ASSERT_TRUE(table_->MarkDelete(rids_[1], writer));
+  Insert(3, writer);
+  EXPECT_EQ(0, txn_mgr_->GetVersionStore()->GetNumVersions());
+
+  // so a snapshot cannot begin before the writer is done
+  std::atomic<bool> began{false};
+  Transaction *reader = nullptr;
+  std::thread reader_thread{[&] {
+    reader = txn_mgr_->Begin(nullptr, IsolationLevel::SNAPSHOT);
+    began = true;
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(began);
+  txn_mgr_->Commit(writer);
+  reader_thread.join();
+  EXPECT_EQ((std::vector<int>{2, 3, 100}), Scan(reader));
+
+  // while it runs, the writes keep versions again
+  Transaction *new_writer = txn_mgr_->Begin();
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(200), rids_[0], new_writer));
+  EXPECT_EQ(1, txn_mgr_->GetVersionStore()->GetNumVersions());
+  EXPECT_EQ(100, Read(rids_[0], reader));
+  txn_mgr_->Commit(new_writer);
+  txn_mgr_->Commit(reader);
+
+  delete reader;
+  delete new_writer;
+  delete writer;
+}
+
+}  // namespace bustub
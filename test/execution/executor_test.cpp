@@ -31,6 +31,7 @@
 #include "execution/plans/delete_plan.h"
 #include "execution/plans/distinct_plan.h"
 #include "execution/plans/hash_join_plan.h"
+#include "execution/plans/index_scan_plan.h"
 #include "execution/plans/limit_plan.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "execution/plans/update_plan.h"
@@ -269,6 +270,42 @@ TEST_F(ExecutorTest, DISABLED_SimpleRawInsertWithIndexTest) {
   }
 }
 
+// SELECT col_a, col_b FROM test_1 WHERE col_a < 500, through an index on col_a
+TEST_F(ExecutorTest, DISABLED_SerializableIndexScanRangeTest) {
+  // The index is built by a transaction of its own, its writes lock their keys until it commits
+  TableInfo *table_info = GetCatalog()->GetTable("test_1");
+  const Schema &schema = table_info->schema_;
+  auto key_schema = ParseCreateStatement("a bigint");
+  Transaction *creator = GetTxnManager()->Begin();
+  auto *index_info = GetCatalog()->CreateBPlusTreeIndex<KeyType, ValueType, ComparatorType>(
+      creator, "index1", "test_1", schema, *key_schema, {schema.GetColIdx("colA")}, 8);
+  GetTxnManager()->Commit(creator);
+  delete creator;
+
+  auto *col_a = MakeColumnValueExpression(schema, 0, "colA");
+  auto *col_b = MakeColumnValueExpression(schema, 0, "colB");
+  auto *const500 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(500));
+  auto *predicate = MakeComparisonExpression(col_a, const500, ComparisonType::LessThan);
+  auto *out_schema = MakeOutputSchema({{"colA", col_a}, {"colB", col_b}});
+  IndexScanPlanNode plan{out_schema, predicate, index_info->index_oid_};
+
+  Transaction *scanner = GetTxnManager()->Begin(nullptr, IsolationLevel::SERIALIZABLE);
+  ExecutorContext exec_ctx{scanner, GetCatalog(), GetBPM(), GetTxnManager(), GetLockManager()};
+  std::vector<Tuple> result_set{};
+  GetExecutionEngine()->Execute(&plan, &result_set, scanner, &exec_ctx);
+  ASSERT_EQ(result_set.size(), 500);
+
+  // The scan locked only the keys below 500, an insert above them does not wait for it
+  Transaction *writer = GetTxnManager()->Begin(nullptr, IsolationLevel::READ_COMMITTED);
+  Tuple key{std::vector<Value>{ValueFactory::GetBigIntValue(1000)}, key_schema.get()};
+  index_info->index_->InsertEntry(key, RID(0, 0), writer);
+  EXPECT_EQ(writer->GetState(), TransactionState::GROWING);
+  GetTxnManager()->Commit(writer);
+  GetTxnManager()->Commit(scanner);
+  delete writer;
+  delete scanner;
+}
+
 // UPDATE test_3 SET colB = colB + 1;
 TEST_F(ExecutorTest, DISABLED_SimpleUpdateTest) {
   // Construct a sequential scan of the table
@@ -0,0 +1,192 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// group_commit_benchmark_test.cpp
+//
+// Identification: test/recovery/group_commit_benchmark_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "concurrency/lock_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "recovery/log_manager.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/*
+ * Commit throughput with 1 to 64 committing threads. Every transaction appends one 128 byte INSERT record and commits,
+ * which waits until its COMMIT record is persistent. With group commit the number of log writes grows much slower
+ * than the number of commits, see the commits_per_flush column. With 8 or more threads it also runs with one log
+ * partition per four threads, where each commit only waits for the partition of its transaction.
+ */
+static constexpr auto BENCHMARK_DURATION = std::chrono::seconds(1);
+
+static void RemoveFiles() {
+  remove("test.db");
+  for (const auto &entry : std::filesystem::directory_iterator(".")) {
+    if (entry.path().filename().string().rfind("test.log", 0) == 0) {
+      std::filesystem::remove(entry.path());
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(GroupCommitBenchmark, DISABLED_CommitThroughput) {
+  Column col{"payload", TypeId::VARCHAR, 128};
+  Schema schema{std::vector<Column>{col}};
+  const Tuple tuple{{Value(TypeId::VARCHAR, std::string(128 - sizeof(uint32_t) - 1, 'x'))}, &schema};
+
+  printf("partitions,threads,commits,commits_per_sec,log_flushes,commits_per_flush,avg_commit_latency_us\n");
+  // (partitions, threads)
+  std::vector<std::pair<int, int>> configs;
+  for (int num_threads : {1, 2, 4, 8, 16, 32, 64}) {
+    configs.emplace_back(1, num_threads);
+  }
+  for (int num_threads : {8, 16, 32, 64}) {
+    configs.emplace_back(num_threads / 4, num_threads);
+  }
+  for (auto [num_partitions, num_threads] : configs) {
+    RemoveFiles();
+    auto *disk_manager = new DiskManager("test.db");
+    auto *log_manager = new LogManager(disk_manager, num_partitions);
+    auto *lock_manager = new LockManager();
+    auto *txn_mgr = new TransactionManager(lock_manager, log_manager);
+    log_manager->RunFlushThread();
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> commits{0};
+    std::atomic<uint64_t> commit_nanos{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([&] {
+        while (!stop) {
+          Transaction *txn = txn_mgr->Begin();
+          LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::INSERT, RID(0, 0), tuple);
+          txn->SetPrevLSN(log_manager->AppendLogRecord(&log_record));
+          auto start = std::chrono::steady_clock::now();
+          txn_mgr->Commit(txn);
+          commit_nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                              .count();
+          commits++;
+          delete txn;
+        }
+      });
+    }
+    std::this_thread::sleep_for(BENCHMARK_DURATION);
+    stop = true;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    log_manager->StopFlushThread();
+
+    uint64_t total = commits;
+    int flushes = disk_manager->GetNumFlushes();
+    EXPECT_GT(total, 0);
+    EXPECT_EQ(log_manager->GetPersistentLSN(), log_manager->GetNextLSN() - 1);
+    printf("%d,%d,%" PRIu64 ",%.0f,%d,%.1f,%.1f\n", num_partitions, num_threads, total,
+           total / std::chrono::duration<double>(BENCHMARK_DURATION).count(), flushes,
+           static_cast<double>(total) / flushes, commit_nanos / 1000.0 / total);
+
+    disk_manager->ShutDown();
+    delete txn_mgr;
+    delete lock_manager;
+    delete log_manager;
+    delete disk_manager;
+  }
+  RemoveFiles();
+}
+
+/*
+ * Commit throughput of transactions that update one of a few hot rows, with and without early lock release. Every
+ * transaction locks its row EXCLUSIVE, appends one UPDATE record and commits. Without early lock release the
+ * row stays locked until the COMMIT record is persistent, so the commits of a row are serialized by the log flushes.
+ * With it the row is free once the COMMIT record is in the log buffer, and the commits of a row share log flushes.
+ */
+// NOLINTNEXTLINE
+TEST(GroupCommitBenchmark, DISABLED_HotRowThroughput) {
+  static constexpr int NUM_THREADS = 16;
+  Column col{"payload", TypeId::VARCHAR, 128};
+  Schema schema{std::vector<Column>{col}};
+  const Tuple tuple{{Value(TypeId::VARCHAR, std::string(128 - sizeof(uint32_t) - 1, 'x'))}, &schema};
+
+  printf("early_lock_release,hot_rows,commits,commits_per_sec,aborts,log_flushes,commits_per_flush\n");
+  for (bool early_lock_release : {false, true}) {
+    for (int num_hot_rows : {1, 4}) {
+      RemoveFiles();
+      auto *disk_manager = new DiskManager("test.db");
+      auto *log_manager = new LogManager(disk_manager);
+      auto *lock_manager = new LockManager();
+      auto *txn_mgr = new TransactionManager(lock_manager, log_manager);
+      txn_mgr->SetEarlyLockRelease(early_lock_release);
+      log_manager->RunFlushThread();
+
+      std::atomic<bool> stop{false};
+      std::atomic<uint64_t> commits{0};
+      std::atomic<uint64_t> aborts{0};
+      std::vector<std::thread> threads;
+      for (int i = 0; i < NUM_THREADS; i++) {
+        threads.emplace_back([&, i] {
+          const RID rid{0, static_cast<uint32_t>(i % num_hot_rows)};
+          while (!stop) {
+            Transaction *txn = txn_mgr->Begin();
+            bool locked = false;
+            try {
+              locked = lock_manager->LockExclusive(txn, rid);
+            } catch (TransactionAbortException &) {
+            }
+            if (!locked) {
+              // wounded by an older transaction
+              txn_mgr->Abort(txn);
+              aborts++;
+              delete txn;
+              continue;
+            }
+            LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::UPDATE, rid, tuple, tuple);
+            txn->SetPrevLSN(log_manager->AppendLogRecord(&log_record));
+            txn_mgr->Commit(txn);
+            commits++;
+            delete txn;
+          }
+        });
+      }
+      std::this_thread::sleep_for(BENCHMARK_DURATION);
+      stop = true;
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      log_manager->StopFlushThread();
+
+      uint64_t total = commits;
+      int flushes = disk_manager->GetNumFlushes();
+      EXPECT_GT(total, 0);
+      EXPECT_EQ(log_manager->GetPersistentLSN(), log_manager->GetNextLSN() - 1);
+      printf("%d,%d,%" PRIu64 ",%.0f,%" PRIu64 ",%d,%.1f\n", early_lock_release, num_hot_rows, total,
+             total / std::chrono::duration<double>(BENCHMARK_DURATION).count(), aborts.load(), flushes,
+             static_cast<double>(total) / flushes);
+
+      disk_manager->ShutDown();
+      delete txn_mgr;
+      delete lock_manager;
+      delete log_manager;
+      delete disk_manager;
+    }
+  }
+  RemoveFiles();
+}
+
+}  // namespace bustub
@@ -0,0 +1,362 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_manager_test.cpp
+//
+// Identification: test/recovery/log_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "concurrency/lock_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "recovery/log_manager.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+class LogManagerTest : public ::testing::Test {
+ protected:
+  // This function is called before every test.
+  void SetUp() override { RemoveFiles(); }
+
+  // This function is called after every test.
+  void TearDown() override { RemoveFiles(); };
+
+  void RemoveFiles() {
+    remove("test.db");
+    // the log segments of all partitions
+    for (const auto &entry : std::filesystem::directory_iterator(".")) {
+      if (entry.path().filename().string().rfind("test.log", 0) == 0) {
+        std::filesystem::remove(entry.path());
+      }
+    }
+  }
+
+  struct ParsedRecord {
+    lsn_t lsn_;
+    txn_id_t txn_id_;
+    int32_t size_;
+    RID rid_;
+  };
+
+  /** Parse the INSERT records of a log partition in file order. */
+  static std::vector<ParsedRecord> ReadPartition(DiskManager *disk_manager, int partition) {
+    std::vector<ParsedRecord> records;
+    std::vector<char> buffer(LOG_BUFFER_SIZE);
+    int64_t offset = 0;
+    while (disk_manager->ReadLog(buffer.data(), LOG_BUFFER_SIZE, offset, partition)) {
+      int pos = 0;
+      while (pos + 20 <= LOG_BUFFER_SIZE) {
+        ParsedRecord record;
+        memcpy(&record.size_, buffer.data() + pos, sizeof(int32_t));
+        if (record.size_ == 0 || pos + record.size_ > LOG_BUFFER_SIZE) {
+          break;
+        }
+        memcpy(&record.lsn_, buffer.data() + pos + 4, sizeof(lsn_t));
+        memcpy(&record.txn_id_, buffer.data() + pos + 8, sizeof(txn_id_t));
+        memcpy(&record.rid_, buffer.data() + pos + 20, sizeof(RID));
+        records.push_back(record);
+        pos += record.size_;
+      }
+      if (pos == 0) {
+        break;
+      }
+      offset += pos;
+    }
+    return records;
+  }
+
+  /** Every thread appends records_per_thread INSERT records as transaction i, with RID(i, j) for the j-th record. */
+  static void AppendConcurrently(LogManager *log_manager, int num_threads, int records_per_thread) {
+    Column col{"payload", TypeId::VARCHAR, 64};
+    Schema schema{std::vector<Column>{col}};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([&, i] {
+        // a different record size per thread, so that buffers fill up at odd offsets
+        const Tuple tuple{{Value(TypeId::VARCHAR, std::string(i * 7 + 1, 'a' + i))}, &schema};
+        lsn_t prev_lsn = INVALID_LSN;
+        for (int j = 0; j < records_per_thread; j++) {
+          LogRecord log_record(i, prev_lsn, LogRecordType::INSERT, RID(i, j), tuple);
+          lsn_t lsn = log_manager->AppendLogRecord(&log_record);
+          EXPECT_GT(lsn, prev_lsn);
+          prev_lsn = lsn;
+        }
+        log_manager->FlushUntil(prev_lsn);
+        EXPECT_GE(log_manager->GetPersistentLSN(), prev_lsn);
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+};
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, ConcurrentAppendTest) {
+  const int num_threads = 8;
+  const int records_per_thread = 2000;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  log_manager->RunFlushThread();
+
+  AppendConcurrently(log_manager, num_threads, records_per_thread);
+  log_manager->StopFlushThread();
+  EXPECT_EQ(log_manager->GetPersistentLSN(), log_manager->GetNextLSN() - 1);
+
+  // the log file holds every record exactly once, in LSN order
+  std::vector<int> next_slot(num_threads, 0);
+  lsn_t last_lsn = INVALID_LSN;
+  auto records = ReadPartition(disk_manager, 0);
+  for (const auto &record : records) {
+    EXPECT_GT(record.lsn_, last_lsn);
+    EXPECT_EQ(record.size_ % 4, 0);
+    EXPECT_EQ(record.rid_.GetPageId(), record.txn_id_);
+    EXPECT_EQ(record.rid_.GetSlotNum(), next_slot[record.txn_id_]++);
+    last_lsn = record.lsn_;
+  }
+  EXPECT_EQ(records.size(), num_threads * records_per_thread);
+
+  disk_manager->ShutDown();
+  delete log_manager;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, PartitionedAppendTest) {
+  const int num_partitions = 4;
+  const int num_threads = 8;
+  const int records_per_thread = 2000;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager, num_partitions);
+  EXPECT_EQ(disk_manager->GetNumLogPartitions(), num_partitions);
+  log_manager->RunFlushThread();
+
+  AppendConcurrently(log_manager, num_threads, records_per_thread);
+  log_manager->StopFlushThread();
+  EXPECT_EQ(log_manager->GetPersistentLSN(), log_manager->GetNextLSN() - 1);
+
+  // every partition is sorted by LSN and holds all records of its transactions, LSNs are unique across partitions
+  std::vector<int> next_slot(num_threads, 0);
+  std::vector<lsn_t> lsns;
+  for (int partition = 0; partition < num_partitions; partition++) {
+    lsn_t last_lsn = INVALID_LSN;
+    for (const auto &record : ReadPartition(disk_manager, partition)) {
+      EXPECT_GT(record.lsn_, last_lsn);
+      EXPECT_EQ(record.txn_id_ % num_partitions, partition);
+      EXPECT_EQ(record.rid_.GetSlotNum(), next_slot[record.txn_id_]++);
+      last_lsn = record.lsn_;
+      lsns.push_back(record.lsn_);
+    }
+  }
+  EXPECT_EQ(lsns.size(), num_threads * records_per_thread);
+  std::sort(lsns.begin(), lsns.end());
+  EXPECT_EQ(std::adjacent_find(lsns.begin(), lsns.end()), lsns.end());
+  EXPECT_LT(lsns.back(), log_manager->GetNextLSN());
+
+  disk_manager->ShutDown();
+  delete log_manager;
+  delete disk_manager;
+
+  // reopening the db finds all partitions
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(disk_manager->GetNumLogPartitions(), num_partitions);
+  disk_manager->ShutDown();
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, ReservedAppendTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  Column col{"payload", TypeId::VARCHAR, 64};
+  Schema schema{std::vector<Column>{col}};
+  const Tuple tuple{{Value(TypeId::VARCHAR, std::string(30, 'a'))}, &schema};
+  const Tuple same_size{{Value(TypeId::VARCHAR, std::string(10, 'a') + "bb" + std::string(18, 'a'))}, &schema};
+  const Tuple longer{{Value(TypeId::VARCHAR, std::string(41, 'c'))}, &schema};
+  const Tuple empty;
+  const RID rid(3, 7);
+
+  // every record is appended twice, once from a LogRecord and once straight from the tuple bytes
+  lsn_t prev_lsn = 0;
+  LogRecord insert(0, prev_lsn, LogRecordType::INSERT, rid, tuple);
+  log_manager->AppendLogRecord(&insert);
+  log_manager->AppendTupleLogRecord(0, prev_lsn, LogRecordType::INSERT, rid, tuple.GetData(), tuple.GetLength());
+  LogRecord mark_delete(0, prev_lsn, LogRecordType::MARKDELETE, rid, empty);
+  log_manager->AppendLogRecord(&mark_delete);
+  log_manager->AppendTupleLogRecord(0, prev_lsn, LogRecordType::MARKDELETE, rid, nullptr, 0);
+  LogRecord update(0, prev_lsn, LogRecordType::UPDATE, rid, tuple, longer);
+  log_manager->AppendLogRecord(&update);
+  log_manager->AppendUpdateLogRecord(0, prev_lsn, rid, tuple.GetData(), tuple.GetLength(), longer.GetData(),
+                                     longer.GetLength());
+  LogRecord delta_update(0, prev_lsn, LogRecordType::DELTAUPDATE, rid, tuple, same_size);
+  log_manager->AppendLogRecord(&delta_update);
+  log_manager->AppendUpdateLogRecord(0, prev_lsn, rid, tuple.GetData(), tuple.GetLength(), same_size.GetData(),
+                                     same_size.GetLength());
+  log_manager->RunFlushThread();
+  log_manager->StopFlushThread();
+
+  std::vector<char> buffer(LOG_BUFFER_SIZE);
+  ASSERT_TRUE(disk_manager->ReadLog(buffer.data(), LOG_BUFFER_SIZE, 0));
+  int pos = 0;
+  for (int i = 0; i < 4; i++) {
+    int32_t size;
+    memcpy(&size, buffer.data() + pos, sizeof(int32_t));
+    int32_t other_size;
+    memcpy(&other_size, buffer.data() + pos + size, sizeof(int32_t));
+    ASSERT_EQ(size, other_size);
+    // the records only differ in their LSN
+    lsn_t lsn;
+    lsn_t other_lsn;
+    memcpy(&lsn, buffer.data() + pos + 4, sizeof(lsn_t));
+    memcpy(&other_lsn, buffer.data() + pos + size + 4, sizeof(lsn_t));
+    EXPECT_EQ(other_lsn, lsn + 1);
+    EXPECT_EQ(memcmp(buffer.data() + pos + 8, buffer.data() + pos + size + 8, size - 8), 0);
+    pos += 2 * size;
+  }
+
+  disk_manager->ShutDown();
+  delete log_manager;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, AsyncCommitTest) {
+  const auto default_delay = async_commit_delay;
+  async_commit_delay = std::chrono::milliseconds(20);
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  auto *lock_manager = new LockManager();
+  auto *txn_mgr = new TransactionManager(lock_manager, log_manager);
+  log_manager->RunFlushThread();
+
+  // the flush thread writes the COMMIT record long before the log timeout of one second
+  Transaction *txn0 = txn_mgr->Begin();
+  txn0->SetAsyncCommit(true);
+  txn_mgr->Commit(txn0);
+  auto start = std::chrono::steady_clock::now();
+  while (log_manager->GetPersistentLSN() < txn0->GetPrevLSN()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+
+  log_manager->StopFlushThread();
+  disk_manager->ShutDown();
+  delete txn0;
+  delete txn_mgr;
+  delete lock_manager;
+  delete log_manager;
+  delete disk_manager;
+  async_commit_delay = default_delay;
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, AsyncCommitDependencyTest) {
+  const auto default_delay = async_commit_delay;
+  async_commit_delay = std::chrono::seconds(10);
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager, 2);
+  auto *lock_manager = new LockManager();
+  auto *txn_mgr = new TransactionManager(lock_manager, log_manager);
+  log_manager->RunFlushThread();
+
+  // txn0 and txn1 log into different partitions. txn1 may have read what txn0 wrote, so its synchronous commit also
+  // waits for the asynchronous COMMIT record of txn0.
+  Transaction *txn0 = txn_mgr->Begin();
+  Transaction *txn1 = txn_mgr->Begin();
+  txn_mgr->SetAsyncCommit(true);
+  txn_mgr->Commit(txn0);
+  txn_mgr->SetAsyncCommit(false);
+  txn_mgr->Commit(txn1);
+  EXPECT_GE(log_manager->GetPersistentLSN(), txn0->GetPrevLSN());
+  EXPECT_GE(log_manager->GetPersistentLSN(), txn1->GetPrevLSN());
+
+  log_manager->StopFlushThread();
+  disk_manager->ShutDown();
+  delete txn0;
+  delete txn1;
+  delete txn_mgr;
+  delete lock_manager;
+  delete log_manager;
+  delete disk_manager;
+  async_commit_delay = default_delay;
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, EarlyLockReleaseTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager, 2);
+  auto *lock_manager = new LockManager();
+  auto *txn_mgr = new TransactionManager(lock_manager, log_manager);
+  txn_mgr->SetEarlyLockRelease(true);
+  log_manager->RunFlushThread();
+  const RID rid{0, 0};
+
+  // txn1 waits for the row txn0 wrote. It gets it once the COMMIT record of txn0 is in the log buffer, and depends on
+  // that record, so its own commit only returns when both records are persistent.
+  Transaction *txn0 = txn_mgr->Begin();
+  Transaction *txn1 = txn_mgr->Begin();
+  EXPECT_TRUE(lock_manager->LockExclusive(txn0, rid));
+  std::thread waiter{[&] { EXPECT_TRUE(lock_manager->LockExclusive(txn1, rid)); }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  txn_mgr->Commit(txn0);
+  waiter.join();
+  EXPECT_EQ(txn1->GetCommitDependency(), txn0->GetPrevLSN());
+  txn_mgr->Commit(txn1);
+  EXPECT_GE(log_manager->GetPersistentLSN(), txn0->GetPrevLSN());
+  // the other partitions only have to get as far as the COMMIT record of txn0
+  auto records = ReadPartition(disk_manager, log_manager->GetPartitionIndex(txn1->GetTransactionId()));
+  EXPECT_TRUE(std::any_of(records.begin(), records.end(),
+                          [&](const ParsedRecord &record) { return record.lsn_ == txn1->GetPrevLSN(); }));
+
+  // without early lock release the locks outlive the flush, txn3 depends on a COMMIT record that is written already
+  txn_mgr->SetEarlyLockRelease(false);
+  Transaction *txn2 = txn_mgr->Begin();
+  Transaction *txn3 = txn_mgr->Begin();
+  EXPECT_TRUE(lock_manager->LockExclusive(txn2, rid));
+  std::thread late_waiter{[&] { EXPECT_TRUE(lock_manager->LockExclusive(txn3, rid)); }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  txn_mgr->Commit(txn2);
+  late_waiter.join();
+  EXPECT_EQ(txn3->GetCommitDependency(), txn2->GetPrevLSN());
+  txn_mgr->Commit(txn3);
+
+  // a table lock the holder could write under counts as well, a SHARED table lock reads its rows without row locks
+  Transaction *txn4 = txn_mgr->Begin();
+  Transaction *txn5 = txn_mgr->Begin();
+  EXPECT_TRUE(lock_manager->LockTable(txn4, 0, LockMode::INTENTION_EXCLUSIVE));
+  std::thread reader{[&] { EXPECT_TRUE(lock_manager->LockTable(txn5, 0, LockMode::SHARED)); }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  txn_mgr->Commit(txn4);
+  reader.join();
+  EXPECT_EQ(txn5->GetCommitDependency(), txn4->GetPrevLSN());
+  txn_mgr->Commit(txn5);
+
+  log_manager->StopFlushThread();
+  disk_manager->ShutDown();
+  delete txn0;
+  delete txn1;
+  delete txn2;
+  delete txn3;
+  delete txn4;
+  delete txn5;
+  delete txn_mgr;
+  delete lock_manager;
+  delete log_manager;
+  delete disk_manager;
+}
+
+}  // namespace bustub
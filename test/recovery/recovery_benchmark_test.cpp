@@ -0,0 +1,138 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// recovery_benchmark_test.cpp
+//
+// Identification: test/recovery/recovery_benchmark_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "recovery/log_manager.h"
+#include "recovery/log_recovery.h"
+#include "storage/disk/disk_manager.h"
+#include "storage/page/table_page.h"
+
+namespace bustub {
+
+/*
+ * Recovery time as the log grows. The log is written directly through the LogManager: every page is created by a
+ * NEWPAGE record, then the INSERT records go round robin over all pages in transactions of 100 records. The last
+ * transaction does not commit, so there is something to undo. No page reaches the db file before the crash, so redo
+ * replays every record, once on a single thread and once with 4 redo threads.
+ */
+static constexpr int RECORDS_PER_TXN = 100;
+static constexpr size_t RECOVERY_POOL_SIZE = 1024;
+
+static void RemoveLogFiles() {
+  for (const auto &entry : std::filesystem::directory_iterator(".")) {
+    if (entry.path().filename().string().rfind("test.log", 0) == 0) {
+      std::filesystem::remove(entry.path());
+    }
+  }
+}
+
+/** @return the size of the log in bytes */
+static size_t WriteLog(int num_records, const Tuple &tuple) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  log_manager->RunFlushThread();
+
+  const int tuples_per_page = PAGE_SIZE / (tuple.GetLength() + 16);
+  const int num_pages = (num_records + tuples_per_page - 1) / tuples_per_page;
+  size_t log_size = 0;
+  txn_id_t txn_id = 0;
+  lsn_t prev_lsn = INVALID_LSN;
+  auto append = [&](LogRecord *log_record) {
+    prev_lsn = log_manager->AppendLogRecord(log_record);
+    log_size += log_record->GetSize();
+  };
+
+  LogRecord begin_record(txn_id, prev_lsn, LogRecordType::BEGIN);
+  append(&begin_record);
+  for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+    LogRecord log_record(txn_id, prev_lsn, LogRecordType::NEWPAGE, INVALID_PAGE_ID, page_id);
+    append(&log_record);
+  }
+  for (int i = 0; i < num_records; i++) {
+    if (i % RECORDS_PER_TXN == 0) {
+      LogRecord commit_record(txn_id, prev_lsn, LogRecordType::COMMIT);
+      append(&commit_record);
+      txn_id++;
+      prev_lsn = INVALID_LSN;
+      LogRecord log_record(txn_id, prev_lsn, LogRecordType::BEGIN);
+      append(&log_record);
+    }
+    LogRecord log_record(txn_id, prev_lsn, LogRecordType::INSERT, RID(i % num_pages, i / num_pages), tuple);
+    append(&log_record);
+  }
+
+  log_manager->StopFlushThread();
+  disk_manager->ShutDown();
+  delete log_manager;
+  delete disk_manager;
+  return log_size;
+}
+
+// NOLINTNEXTLINE
+TEST(RecoveryBenchmark, DISABLED_RecoveryTime) {
+  Column col{"payload", TypeId::VARCHAR, 64};
+  Schema schema{std::vector<Column>{col}};
+  const Tuple tuple{{Value(TypeId::VARCHAR, std::string(64 - sizeof(uint32_t) - 1, 'x'))}, &schema};
+
+  printf("records,log_mb,redo_threads,redo_ms,undo_ms,redo_records_per_sec\n");
+  for (int num_records : {50000, 100000, 200000, 400000}) {
+    remove("test.db");
+    RemoveLogFiles();
+    size_t log_size = WriteLog(num_records, tuple);
+
+    for (int num_redo_threads : {1, 4}) {
+      remove("test.db");
+      auto *disk_manager = new DiskManager("test.db");
+      auto *bpm = new BufferPoolManagerInstance(RECOVERY_POOL_SIZE, disk_manager);
+      auto *log_recovery = new LogRecovery(disk_manager, bpm, num_redo_threads);
+
+      auto start = std::chrono::steady_clock::now();
+      log_recovery->Redo();
+      auto redo_end = std::chrono::steady_clock::now();
+      log_recovery->Undo();
+      auto undo_end = std::chrono::steady_clock::now();
+
+      // the first record of the committed transactions is there, the uncommitted last one was rolled back
+      auto *page = reinterpret_cast<TablePage *>(bpm->FetchPage(0));
+      Tuple result;
+      EXPECT_TRUE(page->GetTuple(RID(0, 0), &result, nullptr, nullptr));
+      bpm->UnpinPage(0, false);
+      const int tuples_per_page = PAGE_SIZE / (tuple.GetLength() + 16);
+      const int num_pages = (num_records + tuples_per_page - 1) / tuples_per_page;
+      const int last = num_records - 1;
+      page = reinterpret_cast<TablePage *>(bpm->FetchPage(last % num_pages));
+      EXPECT_FALSE(page->GetTuple(RID(last % num_pages, last / num_pages), &result, nullptr, nullptr));
+      bpm->UnpinPage(last % num_pages, false);
+
+      double redo_ms = std::chrono::duration<double, std::milli>(redo_end - start).count();
+      double undo_ms = std::chrono::duration<double, std::milli>(undo_end - redo_end).count();
+      printf("%d,%.1f,%d,%.1f,%.1f,%.0f\n", num_records, log_size / 1048576.0, num_redo_threads, redo_ms, undo_ms,
+             num_records / redo_ms * 1000);
+
+      disk_manager->ShutDown();
+      delete log_recovery;
+      delete bpm;
+      delete disk_manager;
+    }
+  }
+  remove("test.db");
+  RemoveLogFiles();
+}
+
+}  // namespace bustub
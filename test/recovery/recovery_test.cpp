@@ -10,15 +10,21 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <chrono>  // NOLINT
+#include <filesystem>
 #include <string>
+#include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
+#include "buffer/buffer_pool_manager_instance.h"
 #include "common/bustub_instance.h"
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "gtest/gtest.h"
 #include "logging/common.h"
+#include "recovery/checkpoint_manager.h"
 #include "recovery/log_recovery.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/table_iterator.h"
@@ -29,17 +35,23 @@ namespace bustub {
 class RecoveryTest : public ::testing::Test {
  protected:
   // This function is called before every test.
-  void SetUp() override {
-    remove("test.db");
-    remove("test.log");
-  }
+  void SetUp() override { RemoveFiles(); }
 
   // This function is called after every test.
   void TearDown() override {
     LOG_INFO("Tearing down the system..");
-    remove("test.db");
-    remove("test.log");
+    RemoveFiles();
   };
+
+  void RemoveFiles() {
+    remove("test.db");
+    // the log segments of all partitions and the master record
+    for (const auto &entry : std::filesystem::directory_iterator(".")) {
+      if (entry.path().filename().string().rfind("test.log", 0) == 0) {
+        std::filesystem::remove(entry.path());
+      }
+    }
+  }
 };
 
 // NOLINTNEXTLINE
@@ -314,4 +326,580 @@ TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
   LOG_INFO("Shutdown System");
   delete bustub_instance;
 }
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, PartitionedLogRecoveryTest) {
+  const int num_partitions = 4;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  auto *log_manager = new LogManager(disk_manager, num_partitions);
+  auto *lock_manager = new LockManager();
+  auto *txn_mgr = new TransactionManager(lock_manager, log_manager);
+  log_manager->RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  Schema schema{std::vector<Column>{col1, col2}};
+
+  // one transaction per partition, their inserts interleave on the same pages, so redo must merge the partitions
+  std::vector<Transaction *> txns;
+  for (int i = 0; i < num_partitions; i++) {
+    txns.push_back(txn_mgr->Begin());
+  }
+  auto *table = new TableHeap(bpm, lock_manager, log_manager, txns[0]);
+  page_id_t first_page_id = table->GetFirstPageId();
+  std::vector<std::vector<std::pair<RID, Tuple>>> inserted(num_partitions);
+  for (int round = 0; round < 50; round++) {
+    for (int i = 0; i < num_partitions; i++) {
+      Tuple tuple = ConstructTuple(&schema);
+      RID rid;
+      ASSERT_TRUE(table->InsertTuple(tuple, &rid, txns[i]));
+      inserted[i].emplace_back(rid, tuple);
+    }
+  }
+  // the last transaction never commits, its records reach the disk with the others
+  for (int i = 0; i < num_partitions - 1; i++) {
+    txn_mgr->Commit(txns[i]);
+  }
+  log_manager->FlushUntil(log_manager->GetNextLSN() - 1);
+  log_manager->StopFlushThread();
+
+  // crash: no page has been written
+  disk_manager->ShutDown();
+  delete table;
+  delete txn_mgr;
+  delete lock_manager;
+  delete log_manager;
+  delete bpm;
+  delete disk_manager;
+  for (auto *txn : txns) {
+    delete txn;
+  }
+
+  disk_manager = new DiskManager("test.db");
+  ASSERT_EQ(disk_manager->GetNumLogPartitions(), num_partitions);
+  bpm = new BufferPoolManagerInstance(50, disk_manager);
+  auto *log_recovery = new LogRecovery(disk_manager, bpm);
+  log_recovery->Redo();
+  log_recovery->Undo();
+
+  table = new TableHeap(bpm, nullptr, nullptr, first_page_id);
+  for (int i = 0; i < num_partitions; i++) {
+    for (const auto &[rid, tuple] : inserted[i]) {
+      Tuple recovered;
+      if (i < num_partitions - 1) {
+        ASSERT_TRUE(table->GetTuple(rid, &recovered, nullptr));
+        ASSERT_EQ(recovered.GetValue(&schema, 0).CompareEquals(tuple.GetValue(&schema, 0)), CmpBool::CmpTrue);
+        ASSERT_EQ(recovered.GetValue(&schema, 1).CompareEquals(tuple.GetValue(&schema, 1)), CmpBool::CmpTrue);
+      } else {
+        ASSERT_FALSE(table->GetTuple(rid, &recovered, nullptr));
+      }
+    }
+  }
+
+  disk_manager->ShutDown();
+  delete table;
+  delete log_recovery;
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, PartitionedPageDependencyTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager, 2);
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager, log_manager);
+  auto *lock_manager = new LockManager();
+  auto *txn_mgr = new TransactionManager(lock_manager, log_manager);
+  // no flush thread, so that nothing is written unless a commit waits for it
+  enable_logging = true;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  Schema schema{std::vector<Column>{col1, col2}};
+  auto insert = [&](TableHeap *table, Transaction *txn, int count, std::vector<std::pair<RID, Tuple>> *inserted) {
+    for (int i = 0; i < count; i++) {
+      Tuple tuple = ConstructTuple(&schema);
+      RID rid;
+      ASSERT_TRUE(table->InsertTuple(tuple, &rid, txn));
+      inserted->emplace_back(rid, tuple);
+    }
+  };
+
+  // txn1 logs into another partition than txn0 and inserts behind its tuples on the same page, so its commit also
+  // writes the records of txn0, or redo would put the tuples of txn1 into the slots of those of txn0
+  std::vector<std::pair<RID, Tuple>> committed;
+  std::vector<std::pair<RID, Tuple>> rolled_back;
+  Transaction *txn0 = txn_mgr->Begin();
+  Transaction *txn1 = txn_mgr->Begin();
+  ASSERT_NE(log_manager->GetPartitionIndex(txn0->GetTransactionId()),
+            log_manager->GetPartitionIndex(txn1->GetTransactionId()));
+  auto *table = new TableHeap(bpm, lock_manager, log_manager, txn0);
+  page_id_t first_page_id = table->GetFirstPageId();
+  insert(table, txn0, 10, &rolled_back);
+  insert(table, txn1, 10, &committed);
+  txn_mgr->Commit(txn1);
+  EXPECT_EQ(committed[0].first.GetPageId(), rolled_back.back().first.GetPageId());
+  EXPECT_GE(txn1->GetCommitDependency(), txn0->GetPrevLSN());
+  EXPECT_GE(log_manager->GetPersistentLSN(), txn0->GetPrevLSN());
+  enable_logging = false;
+
+  // crash: txn0 never finished
+  disk_manager->ShutDown();
+  delete table;
+  delete txn_mgr;
+  delete lock_manager;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  delete txn0;
+  delete txn1;
+
+  disk_manager = new DiskManager("test.db");
+  bpm = new BufferPoolManagerInstance(50, disk_manager);
+  auto *log_recovery = new LogRecovery(disk_manager, bpm);
+  log_recovery->Redo();
+  log_recovery->Undo();
+
+  table = new TableHeap(bpm, nullptr, nullptr, first_page_id);
+  for (const auto &[rid, tuple] : committed) {
+    Tuple recovered;
+    ASSERT_TRUE(table->GetTuple(rid, &recovered, nullptr));
+    ASSERT_EQ(recovered.GetValue(&schema, 0).CompareEquals(tuple.GetValue(&schema, 0)), CmpBool::CmpTrue);
+  }
+  for (const auto &[rid, tuple] : rolled_back) {
+    Tuple recovered;
+    ASSERT_FALSE(table->GetTuple(rid, &recovered, nullptr));
+  }
+
+  disk_manager->ShutDown();
+  delete table;
+  delete log_recovery;
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, EarlyLockReleaseDeleteTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager, log_manager);
+  auto *lock_manager = new LockManager();
+  auto *txn_mgr = new TransactionManager(lock_manager, log_manager);
+  txn_mgr->SetEarlyLockRelease(true);
+  log_manager->RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  Schema schema{std::vector<Column>{col1, col2}};
+  Transaction *txn0 = txn_mgr->Begin();
+  auto *table = new TableHeap(bpm, lock_manager, log_manager, txn0);
+  Tuple tuple = ConstructTuple(&schema);
+  RID rid;
+  ASSERT_TRUE(table->InsertTuple(tuple, &rid, txn0));
+  ASSERT_TRUE(table->MarkDelete(rid, txn0));
+
+  // the commit of txn0 deletes the row before it logs its COMMIT record, txn1 gets the row only after that record and
+  // depends on it rather than on the delete
+  Transaction *txn1 = txn_mgr->Begin();
+  std::thread waiter{[&] { EXPECT_TRUE(lock_manager->LockShared(txn1, rid)); }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  txn_mgr->Commit(txn0);
+  waiter.join();
+  EXPECT_EQ(txn1->GetCommitDependency(), txn0->GetPrevLSN());
+  txn_mgr->Commit(txn1);
+
+  log_manager->StopFlushThread();
+  disk_manager->ShutDown();
+  delete table;
+  delete txn_mgr;
+  delete lock_manager;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  delete txn0;
+  delete txn1;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, MissingLogRecordTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager, log_manager);
+  auto *lock_manager = new LockManager();
+  auto *txn_mgr = new TransactionManager(lock_manager, log_manager);
+  enable_logging = true;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  Schema schema{std::vector<Column>{col1, col2}};
+  Transaction *txn = txn_mgr->Begin();
+  auto *table = new TableHeap(bpm, lock_manager, log_manager, txn);
+  Tuple tuple = ConstructTuple(&schema);
+  RID rid;
+  ASSERT_TRUE(table->InsertTuple(tuple, &rid, txn));
+  // as if the insert into the slot before had been lost
+  RID next_rid(rid.GetPageId(), rid.GetSlotNum() + 2);
+  txn->SetPrevLSN(log_manager->AppendTupleLogRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::INSERT,
+                                                    next_rid, tuple.GetData(), tuple.GetLength()));
+  txn_mgr->Commit(txn);
+  enable_logging = false;
+
+  disk_manager->ShutDown();
+  delete table;
+  delete txn_mgr;
+  delete lock_manager;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  delete txn;
+
+  // redo stops instead of giving the tuple another RID than the log, on the reading thread and on the redo threads
+  for (int num_redo_threads : {1, 4}) {
+    disk_manager = new DiskManager("test.db");
+    bpm = new BufferPoolManagerInstance(50, disk_manager);
+    auto *log_recovery = new LogRecovery(disk_manager, bpm, num_redo_threads);
+    EXPECT_THROW(log_recovery->Redo(), Exception);
+
+    disk_manager->ShutDown();
+    delete log_recovery;
+    delete bpm;
+    delete disk_manager;
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, FuzzyCheckpointTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager, log_manager);
+  auto *lock_manager = new LockManager();
+  auto *txn_mgr = new TransactionManager(lock_manager, log_manager);
+  auto *checkpoint_mgr = new CheckpointManager(txn_mgr, log_manager, bpm);
+  log_manager->RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  Schema schema{std::vector<Column>{col1, col2}};
+  auto insert = [&](TableHeap *table, Transaction *txn, int count, std::vector<std::pair<RID, Tuple>> *inserted) {
+    for (int i = 0; i < count; i++) {
+      Tuple tuple = ConstructTuple(&schema);
+      RID rid;
+      ASSERT_TRUE(table->InsertTuple(tuple, &rid, txn));
+      inserted->emplace_back(rid, tuple);
+    }
+  };
+
+  std::vector<std::pair<RID, Tuple>> committed;
+  std::vector<std::pair<RID, Tuple>> uncommitted;
+  Transaction *txn0 = txn_mgr->Begin();
+  auto *table = new TableHeap(bpm, lock_manager, log_manager, txn0);
+  page_id_t first_page_id = table->GetFirstPageId();
+  insert(table, txn0, 100, &committed);
+  txn_mgr->Commit(txn0);
+  checkpoint_mgr->BeginCheckpoint();
+  checkpoint_mgr->EndCheckpoint();
+
+  // the second checkpoint is taken while txn1 is running, the first one wrote every page txn0 changed
+  Transaction *txn1 = txn_mgr->Begin();
+  insert(table, txn1, 20, &uncommitted);
+  checkpoint_mgr->BeginCheckpoint();
+  Transaction *txn2 = txn_mgr->Begin();
+  insert(table, txn2, 30, &committed);
+  txn_mgr->Commit(txn2);
+  insert(table, txn1, 10, &uncommitted);
+  checkpoint_mgr->EndCheckpoint();
+  log_manager->FlushUntil(log_manager->GetNextLSN() - 1);
+  log_manager->StopFlushThread();
+
+  // redo starts behind the records of txn0
+  std::vector<char> data;
+  CheckpointMasterRecord master_record;
+  ASSERT_TRUE(disk_manager->ReadMasterRecord(&data));
+  ASSERT_TRUE(master_record.Deserialize(data));
+  EXPECT_GT(master_record.redo_offsets_[0], 0);
+  EXPECT_LT(master_record.redo_offsets_[0], master_record.checkpoint_offsets_[0]);
+  EXPECT_GT(master_record.end_lsn_, master_record.begin_lsn_);
+
+  // crash: nothing is written after the second checkpoint
+  disk_manager->ShutDown();
+  delete checkpoint_mgr;
+  delete table;
+  delete txn_mgr;
+  delete lock_manager;
+  delete log_manager;
+  delete bpm;
+  delete disk_manager;
+  delete txn0;
+  delete txn1;
+  delete txn2;
+
+  disk_manager = new DiskManager("test.db");
+  bpm = new BufferPoolManagerInstance(50, disk_manager);
+  auto *log_recovery = new LogRecovery(disk_manager, bpm);
+  log_recovery->Redo();
+  log_recovery->Undo();
+
+  table = new TableHeap(bpm, nullptr, nullptr, first_page_id);
+  for (const auto &[rid, tuple] : committed) {
+    Tuple recovered;
+    ASSERT_TRUE(table->GetTuple(rid, &recovered, nullptr));
+    ASSERT_EQ(recovered.GetValue(&schema, 0).CompareEquals(tuple.GetValue(&schema, 0)), CmpBool::CmpTrue);
+    ASSERT_EQ(recovered.GetValue(&schema, 1).CompareEquals(tuple.GetValue(&schema, 1)), CmpBool::CmpTrue);
+  }
+  for (const auto &[rid, tuple] : uncommitted) {
+    Tuple recovered;
+    ASSERT_FALSE(table->GetTuple(rid, &recovered, nullptr));
+  }
+
+  disk_manager->ShutDown();
+  delete table;
+  delete log_recovery;
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, LogSegmentTest) {
+  // small segments, so that the log spans several of them
+  const int64_t default_segment_size = log_segment_size;
+  log_segment_size = 64 * 1024;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager, log_manager);
+  auto *lock_manager = new LockManager();
+  auto *txn_mgr = new TransactionManager(lock_manager, log_manager);
+  auto *checkpoint_mgr = new CheckpointManager(txn_mgr, log_manager, bpm);
+  log_manager->RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  Schema schema{std::vector<Column>{col1, col2}};
+  auto insert = [&](TableHeap *table, Transaction *txn, int count, std::vector<std::pair<RID, Tuple>> *inserted) {
+    for (int i = 0; i < count; i++) {
+      Tuple tuple = ConstructTuple(&schema);
+      RID rid;
+      ASSERT_TRUE(table->InsertTuple(tuple, &rid, txn));
+      inserted->emplace_back(rid, tuple);
+    }
+  };
+
+  std::vector<std::pair<RID, Tuple>> committed;
+  std::vector<std::pair<RID, Tuple>> uncommitted;
+  std::vector<Transaction *> txns;
+  txns.push_back(txn_mgr->Begin());
+  auto *table = new TableHeap(bpm, lock_manager, log_manager, txns.back());
+  page_id_t first_page_id = table->GetFirstPageId();
+  txn_mgr->Commit(txns.back());
+  for (int round = 0; round < 60; round++) {
+    txns.push_back(txn_mgr->Begin());
+    insert(table, txns.back(), 100, &committed);
+    txn_mgr->Commit(txns.back());
+    if (round % 10 == 9) {
+      checkpoint_mgr->BeginCheckpoint();
+      checkpoint_mgr->EndCheckpoint();
+    }
+  }
+  txns.push_back(txn_mgr->Begin());
+  insert(table, txns.back(), 100, &uncommitted);
+  log_manager->FlushUntil(log_manager->GetNextLSN() - 1);
+  log_manager->StopFlushThread();
+
+  // the segments before the last checkpoint were recycled instead of growing the log
+  EXPECT_GT(disk_manager->GetNumRecycledLogSegments(0), 0);
+
+  // crash: the pages written since the last checkpoint are lost
+  disk_manager->ShutDown();
+  delete checkpoint_mgr;
+  delete table;
+  delete txn_mgr;
+  delete lock_manager;
+  delete log_manager;
+  delete bpm;
+  delete disk_manager;
+  for (auto *txn : txns) {
+    delete txn;
+  }
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_GT(disk_manager->GetLogBegin(0), 0);
+  bpm = new BufferPoolManagerInstance(50, disk_manager);
+  auto *log_recovery = new LogRecovery(disk_manager, bpm);
+  log_recovery->Redo();
+  log_recovery->Undo();
+
+  table = new TableHeap(bpm, nullptr, nullptr, first_page_id);
+  for (const auto &[rid, tuple] : committed) {
+    Tuple recovered;
+    ASSERT_TRUE(table->GetTuple(rid, &recovered, nullptr));
+    ASSERT_EQ(recovered.GetValue(&schema, 0).CompareEquals(tuple.GetValue(&schema, 0)), CmpBool::CmpTrue);
+    ASSERT_EQ(recovered.GetValue(&schema, 1).CompareEquals(tuple.GetValue(&schema, 1)), CmpBool::CmpTrue);
+  }
+  for (const auto &[rid, tuple] : uncommitted) {
+    Tuple recovered;
+    ASSERT_FALSE(table->GetTuple(rid, &recovered, nullptr));
+  }
+
+  disk_manager->ShutDown();
+  delete table;
+  delete log_recovery;
+  delete bpm;
+  delete disk_manager;
+  log_segment_size = default_segment_size;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, AsyncCommitTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager, log_manager);
+  auto *lock_manager = new LockManager();
+  auto *txn_mgr = new TransactionManager(lock_manager, log_manager);
+  // no flush thread, so that nothing is written unless a commit waits for it
+  enable_logging = true;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  Schema schema{std::vector<Column>{col1, col2}};
+  auto insert = [&](TableHeap *table, Transaction *txn, int count, std::vector<std::pair<RID, Tuple>> *inserted) {
+    for (int i = 0; i < count; i++) {
+      Tuple tuple = ConstructTuple(&schema);
+      RID rid;
+      ASSERT_TRUE(table->InsertTuple(tuple, &rid, txn));
+      inserted->emplace_back(rid, tuple);
+    }
+  };
+
+  std::vector<std::pair<RID, Tuple>> durable;
+  std::vector<std::pair<RID, Tuple>> lost;
+  Transaction *txn0 = txn_mgr->Begin();
+  auto *table = new TableHeap(bpm, lock_manager, log_manager, txn0);
+  page_id_t first_page_id = table->GetFirstPageId();
+  insert(table, txn0, 20, &durable);
+  txn0->SetAsyncCommit(true);
+  txn_mgr->Commit(txn0);
+  // the synchronous commit writes the asynchronous one before it as well
+  Transaction *txn1 = txn_mgr->Begin();
+  insert(table, txn1, 20, &durable);
+  txn_mgr->Commit(txn1);
+  // the last commit returns before its record is written
+  Transaction *txn2 = txn_mgr->Begin();
+  insert(table, txn2, 20, &lost);
+  txn2->SetAsyncCommit(true);
+  txn_mgr->Commit(txn2);
+  EXPECT_LT(log_manager->GetPersistentLSN(), txn2->GetPrevLSN());
+  enable_logging = false;
+
+  // crash: the COMMIT record of txn2 is lost together with the pages
+  disk_manager->ShutDown();
+  delete table;
+  delete txn_mgr;
+  delete lock_manager;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  delete txn0;
+  delete txn1;
+  delete txn2;
+
+  disk_manager = new DiskManager("test.db");
+  bpm = new BufferPoolManagerInstance(50, disk_manager);
+  auto *log_recovery = new LogRecovery(disk_manager, bpm);
+  log_recovery->Redo();
+  log_recovery->Undo();
+
+  table = new TableHeap(bpm, nullptr, nullptr, first_page_id);
+  for (const auto &[rid, tuple] : durable) {
+    Tuple recovered;
+    ASSERT_TRUE(table->GetTuple(rid, &recovered, nullptr));
+    ASSERT_EQ(recovered.GetValue(&schema, 0).CompareEquals(tuple.GetValue(&schema, 0)), CmpBool::CmpTrue);
+  }
+  for (const auto &[rid, tuple] : lost) {
+    Tuple recovered;
+    ASSERT_FALSE(table->GetTuple(rid, &recovered, nullptr));
+  }
+
+  disk_manager->ShutDown();
+  delete table;
+  delete log_recovery;
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, DeltaUpdateTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager, log_manager);
+  auto *lock_manager = new LockManager();
+  auto *txn_mgr = new TransactionManager(lock_manager, log_manager);
+  log_manager->RunFlushThread();
+
+  Column col1{"payload", TypeId::VARCHAR, 200};
+  Column col2{"counter", TypeId::INTEGER};
+  Schema schema{std::vector<Column>{col1, col2}};
+  auto make_tuple = [&](int counter) {
+    return Tuple{{Value(TypeId::VARCHAR, std::string(150, 'x')), Value(TypeId::INTEGER, counter)}, &schema};
+  };
+  const int num_tuples = 20;
+
+  Transaction *txn0 = txn_mgr->Begin();
+  auto *table = new TableHeap(bpm, lock_manager, log_manager, txn0);
+  page_id_t first_page_id = table->GetFirstPageId();
+  std::vector<RID> rids(num_tuples);
+  for (int i = 0; i < num_tuples; i++) {
+    ASSERT_TRUE(table->InsertTuple(make_tuple(i), &rids[i], txn0));
+  }
+  txn_mgr->Commit(txn0);
+
+  // changing the counter only logs its four bytes instead of both images of the tuple
+  int64_t log_size = disk_manager->GetLogEnd(0);
+  Transaction *txn1 = txn_mgr->Begin();
+  for (int i = 0; i < num_tuples; i++) {
+    ASSERT_TRUE(table->UpdateTuple(make_tuple(i + 100), rids[i], txn1));
+  }
+  txn_mgr->Commit(txn1);
+  EXPECT_LT(disk_manager->GetLogEnd(0) - log_size, num_tuples * static_cast<int>(make_tuple(0).GetLength()));
+
+  // the second update never commits
+  Transaction *txn2 = txn_mgr->Begin();
+  for (int i = 0; i < num_tuples / 2; i++) {
+    ASSERT_TRUE(table->UpdateTuple(make_tuple(i + 200), rids[i], txn2));
+  }
+  log_manager->FlushUntil(log_manager->GetNextLSN() - 1);
+  log_manager->StopFlushThread();
+
+  // crash: no page has been written
+  disk_manager->ShutDown();
+  delete table;
+  delete txn_mgr;
+  delete lock_manager;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  delete txn0;
+  delete txn1;
+  delete txn2;
+
+  disk_manager = new DiskManager("test.db");
+  bpm = new BufferPoolManagerInstance(50, disk_manager);
+  auto *log_recovery = new LogRecovery(disk_manager, bpm);
+  log_recovery->Redo();
+  log_recovery->Undo();
+
+  table = new TableHeap(bpm, nullptr, nullptr, first_page_id);
+  for (int i = 0; i < num_tuples; i++) {
+    Tuple recovered;
+    ASSERT_TRUE(table->GetTuple(rids[i], &recovered, nullptr));
+    EXPECT_EQ(recovered.GetValue(&schema, 1).GetAs<int32_t>(), i + 100);
+    EXPECT_EQ(recovered.GetValue(&schema, 0).ToString(), std::string(150, 'x'));
+  }
+
+  disk_manager->ShutDown();
+  delete table;
+  delete log_recovery;
+  delete bpm;
+  delete disk_manager;
+}
+
 }  // namespace bustub
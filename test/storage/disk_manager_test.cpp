@@ -11,26 +11,34 @@
 //===----------------------------------------------------------------------===//
 
 #include <cstring>
+#include <filesystem>
+#include <random>
+#include <vector>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
 #include "storage/disk/disk_manager.h"
+#include "storage/disk/page_compressor.h"
 
 namespace bustub {
 
 class DiskManagerTest : public ::testing::Test {
  protected:
   // This function is called before every test.
-  void SetUp() override {
-    remove("test.db");
-    remove("test.log");
-  }
+  void SetUp() override { RemoveFiles(); }
 
   // This function is called after every test.
-  void TearDown() override {
+  void TearDown() override { RemoveFiles(); };
+
+  void RemoveFiles() {
     remove("test.db");
-    remove("test.log");
-  };
+    // the log segments
+    for (const auto &entry : std::filesystem::directory_iterator(".")) {
+      if (entry.path().filename().string().rfind("test.log", 0) == 0) {
+        std::filesystem::remove(entry.path());
+      }
+    }
+  }
 };
 
 // NOLINTNEXTLINE
@@ -72,6 +80,161 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LogSegmentTest) {
+  const int64_t default_segment_size = log_segment_size;
+  log_segment_size = 64 * 1024;
+  // two writes do not fit into one segment, so every write starts a new one
+  const int write_size = LOG_BUFFER_SIZE;
+  std::vector<std::vector<char>> buffers(2, std::vector<char>(write_size));
+  std::vector<char> buf(write_size);
+  auto *dm = new DiskManager("test.db");
+
+  std::vector<int64_t> offsets;
+  for (int i = 0; i < 6; i++) {
+    std::vector<char> &data = buffers[i % 2];
+    std::fill(data.begin(), data.end(), static_cast<char>('a' + i));
+    dm->WriteLog(data.data(), write_size);
+    offsets.push_back(dm->GetLogEnd(0) - write_size);
+  }
+  for (int i = 0; i < 6; i++) {
+    ASSERT_TRUE(dm->ReadLog(buf.data(), write_size, offsets[i]));
+    EXPECT_EQ(buf[0], 'a' + i);
+    EXPECT_EQ(buf[write_size - 1], 'a' + i);
+  }
+  // the rest of a segment reads as the end of its records
+  ASSERT_TRUE(dm->ReadLog(buf.data(), write_size, offsets[0] + write_size));
+  EXPECT_EQ(buf[0], 0);
+  EXPECT_EQ(dm->GetNextLogSegmentOffset(offsets[0] + write_size), dm->GetNextLogSegmentOffset(offsets[0]));
+  EXPECT_FALSE(dm->ReadLog(buf.data(), write_size, dm->GetLogEnd(0)));
+
+  // a mapped segment holds the same bytes, up to the end of the log
+  int64_t begin;
+  int64_t size;
+  const char *data = dm->MapLogSegment(offsets[5] + 1, 0, &begin, &size);
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(begin, offsets[5]);
+  EXPECT_EQ(size, write_size);
+  EXPECT_EQ(data[0], 'a' + 5);
+  EXPECT_EQ(data[write_size - 1], 'a' + 5);
+  dm->UnmapLogSegment(data, size);
+  EXPECT_EQ(dm->MapLogSegment(dm->GetLogEnd(0), 0, &begin, &size), nullptr);
+
+  // the first four segments are recycled, three of them are reused by the next writes
+  dm->TruncateLog(0, offsets[4]);
+  EXPECT_EQ(dm->GetLogBegin(0), offsets[4]);
+  EXPECT_FALSE(dm->ReadLog(buf.data(), write_size, offsets[3]));
+  for (int i = 6; i < 9; i++) {
+    dm->WriteLog(buffers[i % 2].data(), write_size);
+    offsets.push_back(dm->GetLogEnd(0) - write_size);
+  }
+  EXPECT_EQ(dm->GetNumRecycledLogSegments(0), 3);
+  dm->ShutDown();
+  delete dm;
+
+  // reopening finds the live segments, a recycled one that still holds old records is not one of them
+  dm = new DiskManager("test.db");
+  EXPECT_EQ(dm->GetLogBegin(0), offsets[4]);
+  for (int i = 4; i < 9; i++) {
+    ASSERT_TRUE(dm->ReadLog(buf.data(), write_size, offsets[i]));
+  }
+  EXPECT_FALSE(dm->ReadLog(buf.data(), write_size, dm->GetNextLogSegmentOffset(offsets[8])));
+  dm->ShutDown();
+  delete dm;
+  log_segment_size = default_segment_size;
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, PageCompressorTest) {
+  char page[PAGE_SIZE] = {0};
+  char compressed[PAGE_SIZE] = {0};
+  char buf[PAGE_SIZE] = {0};
+
+  // all zeros
+  size_t size = PageCompressor::Compress(page, PAGE_SIZE, compressed, sizeof(compressed));
+  EXPECT_GT(size, 0);
+  EXPECT_LT(size, PAGE_SIZE / 16);
+  EXPECT_TRUE(PageCompressor::Decompress(compressed, size, buf, PAGE_SIZE));
+  EXPECT_EQ(std::memcmp(buf, page, sizeof(buf)), 0);
+
+  // repeated text
+  for (int i = 0; i < PAGE_SIZE; i++) {
+    page[i] = "A test string."[i % 14];
+  }
+  size = PageCompressor::Compress(page, PAGE_SIZE, compressed, sizeof(compressed));
+  EXPECT_GT(size, 0);
+  EXPECT_TRUE(PageCompressor::Decompress(compressed, size, buf, PAGE_SIZE));
+  EXPECT_EQ(std::memcmp(buf, page, sizeof(buf)), 0);
+
+  // random bytes do not fit into less than a page
+  std::mt19937 gen(15445);
+  for (auto &c : page) {
+    c = static_cast<char>(gen());
+  }
+  EXPECT_EQ(PageCompressor::Compress(page, PAGE_SIZE, compressed, sizeof(compressed) - 1), 0);
+
+  // truncated input is rejected
+  std::memset(page, 'x', sizeof(page));
+  size = PageCompressor::Compress(page, PAGE_SIZE, compressed, sizeof(compressed));
+  EXPECT_FALSE(PageCompressor::Decompress(compressed, size - 1, buf, PAGE_SIZE));
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, CompressedReadWritePageTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  char random_data[PAGE_SIZE] = {0};
+  std::mt19937 gen(15445);
+  for (auto &c : random_data) {
+    c = static_cast<char>(gen());
+  }
+  std::string db_file("test.db");
+  {
+    auto dm = DiskManager(db_file, true);
+    std::strncpy(data, "A test string.", sizeof(data));
+
+    dm.ReadPage(0, buf);  // tolerate empty read
+
+    dm.WritePage(0, data);
+    dm.ReadPage(0, buf);
+    EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+    EXPECT_LT(dm.GetNumBytesWritten(), PAGE_SIZE / 4);
+    EXPECT_LT(dm.GetNumBytesRead(), PAGE_SIZE / 4);
+
+    // page 1 grows out of its slot, page 5 stays uncompressed
+    dm.WritePage(1, data);
+    dm.WritePage(1, random_data);
+    dm.WritePage(5, random_data);
+    dm.WritePage(2, data);
+    dm.ReadPage(1, buf);
+    EXPECT_EQ(std::memcmp(buf, random_data, sizeof(buf)), 0);
+    dm.ReadPage(5, buf);
+    EXPECT_EQ(std::memcmp(buf, random_data, sizeof(buf)), 0);
+    dm.ReadPage(2, buf);
+    EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+
+    dm.ShutDown();
+  }
+
+  // the mapping table is rebuilt from the file
+  auto dm = DiskManager(db_file, true);
+  dm.ReadPage(0, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  dm.ReadPage(1, buf);
+  EXPECT_EQ(std::memcmp(buf, random_data, sizeof(buf)), 0);
+  dm.ReadPage(2, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  dm.ReadPage(5, buf);
+  EXPECT_EQ(std::memcmp(buf, random_data, sizeof(buf)), 0);
+  dm.ShutDown();
+
+  // a raw page in place of the first slot header
+  auto raw_dm = DiskManager(db_file);
+  raw_dm.WritePage(0, data);
+  raw_dm.ShutDown();
+  EXPECT_THROW(DiskManager(db_file, true), Exception);
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
@@ -0,0 +1,101 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_size_benchmark_test.cpp
+//
+// Identification: test/storage/page_size_benchmark_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cinttypes>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/table/table_heap.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/*
+ * Measures insert, sequential scan and point lookup throughput of a TableHeap for the PAGE_SIZE this binary was built
+ * with. The buffer pool gets the same number of bytes for every page size, so that the table does not fit in memory
+ * and page I/O is part of the measurement. The table is kept small because TableHeap::InsertTuple walks the page
+ * chain from the first page on every insert. Every configuration runs with and without page compression in the
+ * DiskManager. Run build_support/run_page_size_benchmark.sh to get the full matrix.
+ */
+static constexpr size_t BENCHMARK_BUFFER_BYTES = 256 << 10;
+static constexpr size_t BENCHMARK_TABLE_BYTES = 2 << 20;
+
+static double ElapsedSeconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// NOLINTNEXTLINE
+TEST(PageSizeBenchmark, DISABLED_TableHeapThroughput) {
+  const size_t pool_size = BENCHMARK_BUFFER_BYTES / PAGE_SIZE;
+  printf(
+      "page_size,compression,row_width,rows,insert_ops_per_sec,scan_rows_per_sec,lookup_ops_per_sec,page_writes,"
+      "bytes_written,bytes_read\n");
+
+  for (bool compression : {false, true}) {
+    for (uint32_t row_width : {32U, 128U, 512U, 2048U}) {
+      remove("test.db");
+      remove("test.log");
+      auto *disk_manager = new DiskManager("test.db", compression);
+      auto *bpm = new BufferPoolManagerInstance(pool_size, disk_manager);
+      auto *txn = new Transaction(0);
+      auto *table = new TableHeap(bpm, nullptr, nullptr, txn);
+
+      Column col{"payload", TypeId::VARCHAR, row_width};
+      Schema schema{std::vector<Column>{col}};
+      const Tuple row{{Value(TypeId::VARCHAR, std::string(row_width - sizeof(uint32_t) - 1, 'x'))}, &schema};
+      const size_t num_rows = BENCHMARK_TABLE_BYTES / row.GetLength();
+
+      std::vector<RID> rids(num_rows);
+      auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < num_rows; i++) {
+        ASSERT_TRUE(table->InsertTuple(row, &rids[i], txn));
+      }
+      double insert_secs = ElapsedSeconds(start);
+
+      size_t scanned = 0;
+      start = std::chrono::steady_clock::now();
+      for (auto iter = table->Begin(txn); iter != table->End(); ++iter) {
+        scanned++;
+      }
+      double scan_secs = ElapsedSeconds(start);
+      EXPECT_EQ(num_rows, scanned);
+
+      std::shuffle(rids.begin(), rids.end(), std::mt19937(15445));
+      Tuple result;
+      start = std::chrono::steady_clock::now();
+      for (const auto &rid : rids) {
+        ASSERT_TRUE(table->GetTuple(rid, &result, txn));
+      }
+      double lookup_secs = ElapsedSeconds(start);
+
+      printf("%d,%d,%u,%zu,%.0f,%.0f,%.0f,%d,%" PRIu64 ",%" PRIu64 "\n", PAGE_SIZE, compression, row_width, num_rows,
+             num_rows / insert_secs, scanned / scan_secs, num_rows / lookup_secs, disk_manager->GetNumWrites(),
+             disk_manager->GetNumBytesWritten(), disk_manager->GetNumBytesRead());
+
+      disk_manager->ShutDown();
+      delete table;
+      delete txn;
+      delete bpm;
+      delete disk_manager;
+    }
+  }
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub